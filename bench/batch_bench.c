@@ -0,0 +1,80 @@
+/**
+ * @brief  Compares batched lookups with a loop over `ht_find`.
+ * @details Fills a table of each capacity policy, then looks random keys
+ *  up in requests of 32, 64, 128 and 256 keys, once with one `ht_find`
+ *  per key and once with `ht_find_batch`. Use a key count well above the
+ *  last level cache to see the effect of prefetching.
+ *  Prints nanoseconds per key.
+ *  usage: batch_bench [keys] [lookups]   (default 4194304 4000000)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 1 << 22;
+    const int lookups = argc > 2 ? atoi(argv[2]) : 4000000;
+    const int batch_sizes[4] = {32, 64, 128, 256};
+    const char *policy_names[2] = {"prime", "pow2"};
+
+    char **keys = malloc(sizeof(char *) * (size_t)count);
+    for (int i = 0; i < count; i++)
+    {
+        keys[i] = malloc(32);
+        snprintf(keys[i], 32, "user:%08d", i);
+    }
+    const char **requests = malloc(sizeof(char *) * (size_t)lookups);
+    for (int i = 0; i < lookups; i++)
+        requests[i] = keys[rand() % count];
+    char *values[256];
+
+    printf("%-8s %-6s %10s %10s %8s   (ns/key)\n", "policy", "batch", "ht_find", "batch", "speedup");
+    for (int policy = 0; policy < 2; policy++)
+    {
+        TableConfig config = {.capacity_policy = policy};
+        Table *table = ht_new_with_config(&config);
+        table = ht_insert_batch(table, (const char **)keys, (const char **)keys, count);
+        for (int b = 0; b < 4; b++)
+        {
+            const int batch = batch_sizes[b];
+            const int requests_run = lookups / batch;
+            volatile size_t sink = 0;
+
+            double start = now_ns();
+            for (int r = 0; r < requests_run; r++)
+            {
+                for (int i = 0; i < batch; i++)
+                    values[i] = ht_find(table, requests[r * batch + i]);
+                sink += (size_t)values[batch - 1];
+            }
+            const double loop_ns = (now_ns() - start) / ((double)requests_run * batch);
+
+            start = now_ns();
+            for (int r = 0; r < requests_run; r++)
+            {
+                ht_find_batch(table, requests + r * batch, batch, values);
+                sink += (size_t)values[batch - 1];
+            }
+            const double batch_ns = (now_ns() - start) / ((double)requests_run * batch);
+            (void)sink;
+            printf("%-8s %-6d %10.1f %10.1f %7.2fx\n", policy_names[policy], batch, loop_ns, batch_ns, loop_ns / batch_ns);
+        }
+        delete_Table(table);
+    }
+    for (int i = 0; i < count; i++)
+        free(keys[i]);
+    free(keys);
+    free(requests);
+    return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @brief  Loading a large file: growing inserts, presized inserts, bulk load.
+ * @details Writes `keys` TSV records to a file, then builds a table from
+ *  them three ways: `ht_insert` into `ht_new()` (one resize per doubling),
+ *  `ht_insert` into `ht_new_with_capacity()`, and `ht_bulk_load` with 1,
+ *  2, 4 and 8 threads. Insert timings exclude reading the file.
+ *  usage: bulk_load_bench [keys] [file]   (default 4194304 bulk_load_bench.tsv)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+#include "../lib/bulk-load.h"
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 22;
+    const char *path = argc > 2 ? argv[2] : "bulk_load_bench.tsv";
+    char **names = malloc(sizeof(char *) * (size_t)keys);
+    FILE *file = fopen(path, "w");
+    if (names == NULL || file == NULL)
+    {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    for (int i = 0; i < keys; i++)
+    {
+        names[i] = malloc(32);
+        snprintf(names[i], 32, "user:%08d", i);
+        fprintf(file, "%s\tsession-%d\n", names[i], i);
+    }
+    fclose(file);
+
+    printf("%-26s %10s\n", "loader", "ms");
+    for (int presized = 0; presized < 2; presized++)
+    {
+        const double start = now_ms();
+        Table *table = presized ? ht_new_with_capacity(keys) : ht_new();
+        for (int i = 0; i < keys; i++)
+            table = ht_insert(table, names[i], "session");
+        printf("%-26s %10.1f\n", presized ? "ht_new_with_capacity" : "ht_new + ht_insert", now_ms() - start);
+        delete_Table(table);
+    }
+    for (int threads = 1; threads <= 8; threads *= 2)
+    {
+        const BulkLoadOptions options = {.format = HT_BULK_TSV, .threads = threads};
+        const double start = now_ms();
+        Table *table = ht_bulk_load(path, NULL, &options);
+        const double elapsed = now_ms() - start;
+        char label[32];
+        snprintf(label, sizeof(label), "ht_bulk_load %d threads", threads);
+        printf("%-26s %10.1f  (%d keys)\n", label, elapsed, table != NULL ? table->count : -1);
+        if (table != NULL)
+            delete_Table(table);
+    }
+    for (int i = 0; i < keys; i++)
+        free(names[i]);
+    free(names);
+    remove(path);
+    return 0;
+}
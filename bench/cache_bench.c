@@ -0,0 +1,228 @@
+/**
+ * @brief  Hit rate and throughput of cache tables against a linked-list LRU.
+ * @details Replays `requests` lookups of keys drawn from a Zipf distribution
+ *  over `keys` keys against caches holding `percent` of them. A miss
+ *  inserts the key (cache aside). The baseline is the classic LRU: a
+ *  chained hash index over nodes of a doubly linked list, every hit
+ *  relinks its node at the head and a miss evicts the tail. Heap bytes
+ *  per cached entry come from mallinfo2 once the trace is replayed.
+ *  usage: cache_bench [keys] [requests] [percent] [zipf s]
+ *         (default 1048576 4000000 10 0.99)
+ *  */
+#include <malloc.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+struct lru_node
+{
+    struct lru_node *prev, *next, *chain;
+    char *key;
+    char *value;
+};
+
+/**
+ * @brief linked-list LRU baseline, one malloc per entry
+ * */
+struct lru
+{
+    struct lru_node **buckets;
+    size_t mask;
+    struct lru_node head;
+    int count, capacity;
+};
+
+static void lru_unlink(struct lru_node *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+}
+
+static void lru_push_front(struct lru *lru, struct lru_node *node)
+{
+    node->next = lru->head.next;
+    node->prev = &lru->head;
+    lru->head.next->prev = node;
+    lru->head.next = node;
+}
+
+static struct lru_node **lru_slot(struct lru *lru, const char *key)
+{
+    struct lru_node **slot = &lru->buckets[ht_hash_wy(key, strlen(key), 0) & lru->mask];
+    while (*slot != NULL && strcmp((*slot)->key, key) != 0)
+        slot = &(*slot)->chain;
+    return slot;
+}
+
+static char *lru_find(struct lru *lru, const char *key)
+{
+    struct lru_node *node = *lru_slot(lru, key);
+    if (node == NULL)
+        return NULL;
+    lru_unlink(node);
+    lru_push_front(lru, node);
+    return node->value;
+}
+
+static void lru_insert(struct lru *lru, const char *key, const char *value)
+{
+    if (lru->count == lru->capacity)
+    {
+        struct lru_node *tail = lru->head.prev;
+        lru_unlink(tail);
+        *lru_slot(lru, tail->key) = tail->chain;
+        free(tail->key);
+        free(tail->value);
+        free(tail);
+        lru->count--;
+    }
+    struct lru_node *node = malloc(sizeof(*node));
+    node->key = strdup(key);
+    node->value = strdup(value);
+    node->chain = NULL;
+    *lru_slot(lru, key) = node;
+    lru_push_front(lru, node);
+    lru->count++;
+}
+
+static struct lru *lru_new(const int capacity)
+{
+    struct lru *lru = calloc(1, sizeof(*lru));
+    size_t buckets = 1;
+    while (buckets < (size_t)capacity)
+        buckets <<= 1;
+    lru->buckets = calloc(buckets, sizeof(struct lru_node *));
+    lru->mask = buckets - 1;
+    lru->head.next = lru->head.prev = &lru->head;
+    lru->capacity = capacity;
+    return lru;
+}
+
+static void lru_free(struct lru *lru)
+{
+    for (struct lru_node *node = lru->head.next, *next; node != &lru->head; node = next)
+    {
+        next = node->next;
+        free(node->key);
+        free(node->value);
+        free(node);
+    }
+    free(lru->buckets);
+    free(lru);
+}
+
+/**
+ * @brief key ranks drawn from a Zipf distribution by inverting its CDF,
+ * scattered so popular keys do not share a prefix
+ * */
+static int *zipf_trace(const int keys, const int requests, const double s)
+{
+    double *cdf = malloc((size_t)keys * sizeof(double));
+    double sum = 0;
+    for (int i = 0; i < keys; i++)
+        cdf[i] = sum += 1.0 / pow(i + 1, s);
+    int *trace = malloc((size_t)requests * sizeof(int));
+    uint64_t rng = 88172645463325252ull;
+    for (int r = 0; r < requests; r++)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        const double u = (double)(rng >> 11) / 9007199254740992.0 * sum;
+        int lo = 0, hi = keys - 1;
+        while (lo < hi)
+        {
+            const int mid = (lo + hi) / 2;
+            if (cdf[mid] < u)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        trace[r] = (int)(((unsigned)lo * 2654435761u) % (unsigned)keys);
+    }
+    free(cdf);
+    return trace;
+}
+
+static const char VALUE[] = "cached-response-body-of-about-sixty-four-bytes-0123456789abcdef";
+
+static size_t heap_in_use(void)
+{
+    return mallinfo2().uordblks;
+}
+
+static void report(const char *label, const int hits, const int requests, const double ms, const size_t heap, const int entries)
+{
+    printf("%-12s hit rate %6.2f%%  %8.1f ns/request  %6.2f Mreq/s  %6.1f heap B/entry\n", label,
+           100.0 * hits / requests, ms * 1e6 / requests, requests / ms / 1e3, (double)heap / entries);
+}
+
+static void run_table(const char *label, const int policy, const int capacity_policy, const int capacity, const int *trace, const int requests)
+{
+    const TableConfig config = {.eviction = policy, .max_entries = capacity, .capacity_policy = capacity_policy};
+    const size_t heap = heap_in_use();
+    Table *cache = ht_new_with_config(&config);
+    char key[32];
+    int hits = 0;
+    const double start = now_ms();
+    for (int r = 0; r < requests; r++)
+    {
+        snprintf(key, sizeof(key), "object:%08d", trace[r]);
+        if (ht_find(cache, key) != NULL)
+            hits++;
+        else
+            cache = ht_insert(cache, key, VALUE);
+    }
+    const double ms = now_ms() - start;
+    report(label, hits, requests, ms, heap_in_use() - heap, cache->count);
+    delete_Table(cache);
+}
+
+static void run_lru(const int capacity, const int *trace, const int requests)
+{
+    const size_t heap = heap_in_use();
+    struct lru *lru = lru_new(capacity);
+    char key[32];
+    int hits = 0;
+    const double start = now_ms();
+    for (int r = 0; r < requests; r++)
+    {
+        snprintf(key, sizeof(key), "object:%08d", trace[r]);
+        if (lru_find(lru, key) != NULL)
+            hits++;
+        else
+            lru_insert(lru, key, VALUE);
+    }
+    const double ms = now_ms() - start;
+    report("linked LRU", hits, requests, ms, heap_in_use() - heap, lru->count);
+    lru_free(lru);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    const int requests = argc > 2 ? atoi(argv[2]) : 4000000;
+    const int percent = argc > 3 ? atoi(argv[3]) : 10;
+    const double s = argc > 4 ? atof(argv[4]) : 0.99;
+    const int capacity = (int)((int64_t)keys * percent / 100);
+    int *trace = zipf_trace(keys, requests, s);
+    printf("%d keys, %d requests, zipf %.2f, cache holds %d\n", keys, requests, s, capacity);
+    run_lru(capacity, trace, requests);
+    run_table("clock", HT_EVICT_CLOCK, HT_CAPACITY_PRIME, capacity, trace, requests);
+    run_table("sampled LRU", HT_EVICT_SAMPLED_LRU, HT_CAPACITY_PRIME, capacity, trace, requests);
+    run_table("clock pow2", HT_EVICT_CLOCK, HT_CAPACITY_POW2, capacity, trace, requests);
+    run_table("LRU pow2", HT_EVICT_SAMPLED_LRU, HT_CAPACITY_POW2, capacity, trace, requests);
+    free(trace);
+    return 0;
+}
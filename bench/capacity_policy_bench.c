@@ -0,0 +1,119 @@
+/**
+ * @brief  Compares the prime and power-of-two capacity policies.
+ * @details Runs the same insert / hit / miss / churn workload against a
+ *  table of each policy and prints nanoseconds per operation.
+ *  usage: capacity_policy_bench [keys]   (default 1000000)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+struct bench_result
+{
+    double insert_ns;
+    double hit_ns;
+    double miss_ns;
+    double churn_ns;
+    int size;
+};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief builds `count` keys of the form "prefix:%08d"
+ * */
+static char **make_keys(const char *prefix, int count)
+{
+    char **keys = malloc(sizeof(char *) * (size_t)count);
+    for (int i = 0; i < count; i++)
+    {
+        keys[i] = malloc(32);
+        snprintf(keys[i], 32, "%s:%08d", prefix, i);
+    }
+    return keys;
+}
+
+static void shuffle(char **keys, int count)
+{
+    for (int i = count - 1; i > 0; i--)
+    {
+        const int j = rand() % (i + 1);
+        char *tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+static struct bench_result run(int policy, char **keys, char **missing, int count)
+{
+    struct bench_result result;
+    TableConfig config = {.capacity_policy = policy};
+    Table *table = ht_new_with_config(&config);
+    volatile size_t sink = 0;
+
+    double start = now_ns();
+    for (int i = 0; i < count; i++)
+        table = ht_insert(table, keys[i], "value");
+    result.insert_ns = (now_ns() - start) / count;
+
+    shuffle(keys, count);
+    start = now_ns();
+    for (int i = 0; i < count; i++)
+        sink += (size_t)ht_find(table, keys[i]);
+    result.hit_ns = (now_ns() - start) / count;
+
+    start = now_ns();
+    for (int i = 0; i < count; i++)
+        sink += (size_t)ht_find(table, missing[i]);
+    result.miss_ns = (now_ns() - start) / count;
+
+    // delete and reinsert a tenth of the keys per round
+    const int slice = count / 10 > 0 ? count / 10 : 1;
+    start = now_ns();
+    for (int round = 0; round < 10; round++)
+    {
+        for (int i = 0; i < slice; i++)
+            ht_delete(table, keys[(round * slice + i) % count]);
+        for (int i = 0; i < slice; i++)
+            table = ht_insert(table, keys[(round * slice + i) % count], "value");
+    }
+    result.churn_ns = (now_ns() - start) / (20.0 * slice);
+    result.size = table->size;
+    (void)sink;
+    delete_Table(table);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    char **keys = make_keys("user", count);
+    char **missing = make_keys("miss", count);
+    const char *names[2] = {"prime", "pow2"};
+    const int policies[2] = {HT_CAPACITY_PRIME, HT_CAPACITY_POW2};
+
+    printf("%-8s %10s %10s %10s %10s %12s\n", "policy", "insert", "hit", "miss", "churn", "buckets");
+    for (int i = 0; i < 2; i++)
+    {
+        srand(42);
+        const struct bench_result r = run(policies[i], keys, missing, count);
+        printf("%-8s %8.1fns %8.1fns %8.1fns %8.1fns %12d\n",
+               names[i], r.insert_ns, r.hit_ns, r.miss_ns, r.churn_ns, r.size);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        free(keys[i]);
+        free(missing[i]);
+    }
+    free(keys);
+    free(missing);
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * @brief  Lookup latency of every engine over long insert/delete churn.
+ * @details Fills each engine with `keys` live keys out of a universe of
+ *  twice as many, then runs rounds of `keys` churn operations (delete a
+ *  live key, insert a dead one). After every round it times single
+ *  lookups, half hits and half misses, and prints their p50 and p99.
+ *  Tombstones make the double hashing and swiss latencies drift between
+ *  resizes, robin hood deletes by backward shift and should stay flat.
+ *  Latencies include the cost of reading the clock.
+ *  usage: churn_bench [keys] [rounds]   (default 262144 16)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+#define BENCH_SAMPLES 200000
+
+static inline double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 18;
+    const int rounds = argc > 2 ? atoi(argv[2]) : 16;
+    const char *engine_names[5] = {"double-hash", "double-hash-pow2", "swiss", "robin-hood", "cuckoo"};
+    const TableConfig configs[5] = {
+        {.engine = HT_ENGINE_DOUBLE_HASH},
+        {.engine = HT_ENGINE_DOUBLE_HASH, .capacity_policy = HT_CAPACITY_POW2},
+        {.engine = HT_ENGINE_SWISS},
+        {.engine = HT_ENGINE_ROBIN_HOOD},
+        {.engine = HT_ENGINE_CUCKOO},
+    };
+
+    // order[0, keys) are live, order[keys, 2 * keys) are not
+    char **names = malloc(sizeof(char *) * (size_t)keys * 2);
+    int *order = malloc(sizeof(int) * (size_t)keys * 2);
+    double *samples = malloc(sizeof(double) * BENCH_SAMPLES);
+    for (int i = 0; i < keys * 2; i++)
+    {
+        names[i] = malloc(32);
+        snprintf(names[i], 32, "user:%08d", i);
+    }
+
+    printf("%-17s %5s %9s %9s %8s   (lookup ns)\n", "engine", "round", "p50", "p99", "size");
+    for (int e = 0; e < 5; e++)
+    {
+        srand(42);
+        for (int i = 0; i < keys * 2; i++)
+            order[i] = i;
+        Table *table = ht_new_with_config(&configs[e]);
+        for (int i = 0; i < keys; i++)
+            table = ht_insert(table, names[order[i]], "value");
+        for (int round = 0; round <= rounds; round++)
+        {
+            if (round > 0)
+            {
+                for (int op = 0; op < keys; op++)
+                {
+                    const int live = rand() % keys;
+                    const int dead = keys + rand() % keys;
+                    ht_delete(table, names[order[live]]);
+                    table = ht_insert(table, names[order[dead]], "value");
+                    const int tmp = order[live];
+                    order[live] = order[dead];
+                    order[dead] = tmp;
+                }
+            }
+            volatile size_t sink = 0;
+            for (int s = 0; s < BENCH_SAMPLES; s++)
+            {
+                const char *key = names[order[rand() % (keys * 2)]];
+                const double start = now_ns();
+                sink += (size_t)ht_find(table, key);
+                samples[s] = now_ns() - start;
+            }
+            (void)sink;
+            qsort(samples, BENCH_SAMPLES, sizeof(double), compare_double);
+            if (round == 0 || (round & (round - 1)) == 0 || round == rounds)
+                printf("%-17s %5d %9.1f %9.1f %8d\n", engine_names[e], round,
+                       samples[BENCH_SAMPLES / 2], samples[BENCH_SAMPLES * 99 / 100], table->size);
+        }
+        delete_Table(table);
+    }
+    for (int i = 0; i < keys * 2; i++)
+        free(names[i]);
+    free(names);
+    free(order);
+    free(samples);
+    return 0;
+}
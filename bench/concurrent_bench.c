@@ -0,0 +1,188 @@
+/**
+ * @brief  Throughput of the sharded table from 1 to 64 threads.
+ * @details Compares one `Table` behind a global mutex with a
+ *  `ConcurrentTable` using rwlock and spinlock shards, under a
+ *  read-mostly (95% find) and a write-heavy (50% find, 50% delete +
+ *  reinsert) mix. Prints millions of operations per second.
+ *  usage: concurrent_bench [keys] [ms per run]   (default 1048576 500)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../lib/hash-table.h"
+#include "../lib/concurrent-table.h"
+
+#define BENCH_SHARDS 64
+
+enum bench_mode
+{
+    BENCH_GLOBAL_MUTEX,
+    BENCH_SHARDED_RWLOCK,
+    BENCH_SHARDED_SPIN,
+};
+
+struct bench_shared
+{
+    int mode;
+    int write_percent;
+    int keys;
+    char **key_names;
+    Table *table;
+    pthread_mutex_t mutex;
+    ConcurrentTable *ct;
+    volatile int stop;
+};
+
+struct bench_worker
+{
+    struct bench_shared *shared;
+    unsigned seed;
+    unsigned long ops;
+};
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static inline unsigned next_random(unsigned *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void *bench_thread(void *arg)
+{
+    struct bench_worker *worker = arg;
+    struct bench_shared *shared = worker->shared;
+    char value[32];
+    unsigned long ops = 0;
+    while (!shared->stop)
+    {
+        const unsigned r = next_random(&worker->seed);
+        const char *key = shared->key_names[r % (unsigned)shared->keys];
+        const int write = (int)((r >> 20) % 100) < shared->write_percent;
+        switch (shared->mode)
+        {
+        case BENCH_GLOBAL_MUTEX:
+            pthread_mutex_lock(&shared->mutex);
+            if (write)
+            {
+                ht_delete(shared->table, key);
+                ht_insert(shared->table, key, "value");
+            }
+            else
+            {
+                const char *found = ht_find(shared->table, key);
+                if (found != NULL)
+                    strcpy(value, found);
+            }
+            pthread_mutex_unlock(&shared->mutex);
+            break;
+        default:
+            if (write)
+            {
+                ct_delete(shared->ct, key);
+                ct_insert(shared->ct, key, "value");
+            }
+            else
+                ct_find(shared->ct, key, value, sizeof(value));
+            break;
+        }
+        ops++;
+    }
+    worker->ops = ops;
+    return NULL;
+}
+
+static double run(struct bench_shared *shared, int threads, int duration_ms)
+{
+    pthread_t ids[64];
+    struct bench_worker workers[64];
+    shared->stop = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].shared = shared;
+        workers[t].seed = 0x9e3779b9u * (unsigned)(t + 1);
+        pthread_create(&ids[t], NULL, bench_thread, &workers[t]);
+    }
+    const double start = now_ms();
+    struct timespec pause = {duration_ms / 1000, (long)(duration_ms % 1000) * 1000000L};
+    nanosleep(&pause, NULL);
+    shared->stop = 1;
+    unsigned long total = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(ids[t], NULL);
+        total += workers[t].ops;
+    }
+    return (double)total / ((now_ms() - start) * 1e3);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    const int duration_ms = argc > 2 ? atoi(argv[2]) : 500;
+    const char *mode_names[3] = {"global-mutex", "sharded-rwlock", "sharded-spin"};
+    const int mixes[2] = {5, 50};
+    const int thread_counts[7] = {1, 2, 4, 8, 16, 32, 64};
+
+    struct bench_shared shared;
+    shared.keys = keys;
+    shared.key_names = malloc(sizeof(char *) * (size_t)keys);
+    for (int i = 0; i < keys; i++)
+    {
+        shared.key_names[i] = malloc(24);
+        snprintf(shared.key_names[i], 24, "user:%08d", i);
+    }
+    pthread_mutex_init(&shared.mutex, NULL);
+
+    printf("%-15s %-12s", "mode", "mix");
+    for (int t = 0; t < 7; t++)
+        printf(" %7dT", thread_counts[t]);
+    printf("   (Mops/s)\n");
+    for (int mode = 0; mode < 3; mode++)
+    {
+        for (int m = 0; m < 2; m++)
+        {
+            shared.mode = mode;
+            shared.write_percent = mixes[m];
+            shared.table = NULL;
+            shared.ct = NULL;
+            if (mode == BENCH_GLOBAL_MUTEX)
+            {
+                shared.table = ht_new();
+                for (int i = 0; i < keys; i++)
+                    shared.table = ht_insert(shared.table, shared.key_names[i], "value");
+            }
+            else
+            {
+                shared.ct = ct_new(BENCH_SHARDS, mode == BENCH_SHARDED_SPIN ? CT_LOCK_SPIN : CT_LOCK_RWLOCK, NULL);
+                for (int i = 0; i < keys; i++)
+                    ct_insert(shared.ct, shared.key_names[i], "value");
+            }
+            printf("%-15s %-12s", mode_names[mode], m == 0 ? "read-mostly" : "write-heavy");
+            for (int t = 0; t < 7; t++)
+            {
+                printf(" %8.2f", run(&shared, thread_counts[t], duration_ms));
+                fflush(stdout);
+            }
+            printf("\n");
+            if (shared.table != NULL)
+                delete_Table(shared.table);
+            if (shared.ct != NULL)
+                delete_ConcurrentTable(shared.ct);
+        }
+    }
+    for (int i = 0; i < keys; i++)
+        free(shared.key_names[i]);
+    free(shared.key_names);
+    return 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * @brief  Occupancy, memory and lookup latency tail of every engine.
+ * @details Inserts `keys` keys (by default enough to fill a cuckoo table to
+ *  93%) and times every one of `lookups` finds on its own, half of them
+ *  hits and half misses, to report the median, the 99th and 99.9th
+ *  percentiles and the slowest. The load is the one each engine settled
+ *  at for the same keys, the bytes count slots, nodes and strings.
+ *  usage: cuckoo_bench [keys] [lookups]   (default 3900000 2000000)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void run(const char *label, const TableConfig *config, const int keys, const int lookups, uint32_t *latency)
+{
+    Table *table = ht_new_with_config(config);
+    char key[32];
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "user:%08d", i);
+        table = ht_insert(table, key, "v");
+    }
+    uint64_t rng = 88172645463325252ull;
+    size_t hits = 0;
+    for (int i = 0; i < lookups; i++)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        // odd lookups ask for keys that were never inserted
+        snprintf(key, sizeof(key), "user:%08d", (int)(rng % (uint64_t)keys) + (i & 1) * keys);
+        const uint64_t start = now_ns();
+        hits += ht_find(table, key) != NULL;
+        latency[i] = (uint32_t)(now_ns() - start);
+    }
+    if (hits != (size_t)(lookups + 1) / 2)
+        exit(1);
+    qsort(latency, (size_t)lookups, sizeof(uint32_t), compare_u32);
+    TableStats stats;
+    ht_stats(table, &stats);
+    const size_t bytes = stats.slot_bytes + stats.node_bytes + stats.key_bytes + stats.value_bytes;
+    printf("%-12s load %5.1f%%  %5.1f B/entry  find p50 %5u  p99 %6u  p99.9 %6u  max %7u ns\n", label,
+           100.0 * stats.load_factor, (double)bytes / keys, latency[lookups / 2], latency[(size_t)lookups * 99 / 100],
+           latency[(size_t)lookups * 999 / 1000], latency[lookups - 1]);
+    delete_Table(table);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 3900000;
+    const int lookups = argc > 2 ? atoi(argv[2]) : 2000000;
+    uint32_t *latency = malloc((size_t)lookups * sizeof(uint32_t));
+    const TableConfig prime = {0};
+    const TableConfig pow2 = {.capacity_policy = HT_CAPACITY_POW2};
+    const TableConfig swiss = {.engine = HT_ENGINE_SWISS};
+    const TableConfig robin_hood = {.engine = HT_ENGINE_ROBIN_HOOD};
+    const TableConfig cuckoo = {.engine = HT_ENGINE_CUCKOO};
+    run("prime", &prime, keys, lookups, latency);
+    run("pow2", &pow2, keys, lookups, latency);
+    run("swiss", &swiss, keys, lookups, latency);
+    run("robin-hood", &robin_hood, keys, lookups, latency);
+    run("cuckoo", &cuckoo, keys, lookups, latency);
+    free(latency);
+    return 0;
+}
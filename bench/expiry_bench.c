@@ -0,0 +1,108 @@
+/**
+ * @brief  Cost of per-key TTLs: memory, lookups and reclaiming a bulk expiry.
+ * @details Inserts `keys` sessions with and without a TTL and compares
+ *  bytes per entry and lookup time. Then every TTL runs out at once and
+ *  the timer wheel reclaims them with `ht_expire` slices of `budget`,
+ *  timing the longest slice, against the sweep that deletes every key
+ *  with `ht_delete` in one go. The table clock is driven by the bench.
+ *  usage: expiry_bench [keys] [budget]   (default 1048576 1000)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+static uint64_t bench_now = 1;
+
+static uint64_t bench_clock(void)
+{
+    return bench_now;
+}
+
+static inline double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static Table *fill(const bool ttl, const int keys)
+{
+    const TableConfig config = {.clock = bench_clock};
+    Table *table = ht_new_with_config(&config);
+    char key[32];
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "session:%08d", i);
+        // TTLs spread over ten minutes, one millisecond apart at most
+        table = ttl ? ht_insert_with_ttl(table, key, "user=42;cart=3", 600000 + (uint64_t)(i % 1000))
+                    : ht_insert(table, key, "user=42;cart=3");
+    }
+    return table;
+}
+
+static double find_ns(Table *table, const int keys)
+{
+    char key[32];
+    size_t hits = 0;
+    const double start = now_us();
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "session:%08d", (int)(((unsigned)i * 40503u) % (unsigned)keys));
+        hits += ht_find(table, key) != NULL;
+    }
+    const double ns = (now_us() - start) * 1e3 / keys;
+    if (hits != (size_t)keys)
+        exit(1);
+    return ns;
+}
+
+static void report(const char *label, Table *table, const int keys)
+{
+    TableStats stats;
+    ht_stats(table, &stats);
+    printf("%-8s %7.1f B/entry (nodes %5.1f)  find %6.1f ns\n", label,
+           (double)(stats.slot_bytes + stats.arena_bytes) / keys, (double)stats.node_bytes / keys,
+           find_ns(table, keys));
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    const int budget = argc > 2 ? atoi(argv[2]) : 1000;
+
+    Table *plain = fill(false, keys);
+    report("no TTL", plain, keys);
+    Table *timed = fill(true, keys);
+    report("TTL", timed, keys);
+
+    char key[32];
+    double start = now_us();
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "session:%08d", i);
+        ht_delete(plain, key);
+    }
+    printf("sweep    %8.1f ms in one pass\n", (now_us() - start) / 1e3);
+    delete_Table(plain);
+
+    bench_now += 700000;
+    long calls = 0;
+    double max_us = 0;
+    start = now_us();
+    while (timed->count > 0)
+    {
+        const double call = now_us();
+        ht_expire(timed, budget);
+        const double took = now_us() - call;
+        if (took > max_us)
+            max_us = took;
+        calls++;
+    }
+    const double total_us = now_us() - start;
+    printf("wheel    %8.1f ms in %ld slices of %d, mean %.1f us, longest %.1f us\n", total_us / 1e3, calls, budget,
+           total_us / calls, max_us);
+    delete_Table(timed);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @brief  Mostly missing lookups with and without the negative lookup filter.
+ * @details Fills a table with `keys` keys, then churns it by deleting and
+ *  reinserting a quarter of them, and times `lookups` finds of stored keys
+ *  and as many of keys that were never inserted, best of three passes
+ *  each; the mix weighs them 40/60. The filter's false positive rate is
+ *  the estimate `ht_stats` works out from its counters, and the one
+ *  measured over the misses when the library is built with HT_STATS.
+ *  usage: filter_bench [keys] [lookups]   (default 2000000 1000000)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief ns per find of the given keys, best of three passes
+ * */
+static double time_finds(Table *table, char (*keys)[32], const int n, const size_t expected)
+{
+    double best = 0;
+    for (int pass = 0; pass < 3; pass++)
+    {
+        size_t hits = 0;
+        const double start = now_ms();
+        for (int i = 0; i < n; i++)
+            hits += ht_find(table, keys[i]) != NULL;
+        const double ms = now_ms() - start;
+        if (hits != expected)
+            exit(1);
+        if (pass == 0 || ms < best)
+            best = ms;
+    }
+    return best * 1e6 / n;
+}
+
+static void run(const char *label, const TableConfig *config, const int keys, char (*present)[32], char (*absent)[32],
+                const int lookups)
+{
+    Table *table = ht_new_with_config(config);
+    char key[32];
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "user:%08d", i);
+        table = ht_insert(table, key, "v");
+    }
+    for (int i = 0; i < keys; i += 4)
+    {
+        snprintf(key, sizeof(key), "user:%08d", i);
+        ht_delete(table, key);
+        table = ht_insert(table, key, "v");
+    }
+    const double hit_ns = time_finds(table, present, lookups, (size_t)lookups);
+    ht_stats_reset(table);
+    const double miss_ns = time_finds(table, absent, lookups, 0);
+    TableStats stats;
+    ht_stats(table, &stats);
+    printf("%-13s hit %6.1f  miss %6.1f  60%% misses %6.1f ns/find  slots %5.1f MB  filter %5.1f MB  fp est %5.3f%%",
+           label, hit_ns, miss_ns, 0.4 * hit_ns + 0.6 * miss_ns, (double)stats.slot_bytes / (1 << 20),
+           (double)stats.filter_bytes / (1 << 20), 100 * stats.filter_fp_rate);
+    const uint64_t filtered = stats.filter_rejects + stats.filter_false_positives;
+    if (stats.counters_enabled && filtered > 0)
+        printf("  measured %5.3f%%\n", 100.0 * (double)stats.filter_false_positives / (double)filtered);
+    else
+        printf("  measured n/a\n");
+    delete_Table(table);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 2000000;
+    const int lookups = argc > 2 ? atoi(argv[2]) : 1000000;
+    char (*present)[32] = malloc((size_t)lookups * sizeof(*present));
+    char (*absent)[32] = malloc((size_t)lookups * sizeof(*absent));
+    uint64_t rng = 88172645463325252ull;
+    for (int i = 0; i < lookups; i++)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        snprintf(present[i], sizeof(present[i]), "user:%08d", (int)(rng % (uint64_t)keys));
+        // keys past the inserted ones were never stored
+        snprintf(absent[i], sizeof(absent[i]), "user:%08d", (int)(rng % (uint64_t)keys) + keys);
+    }
+    const TableConfig prime = {0};
+    const TableConfig prime_filter = {.lookup_filter = true};
+    const TableConfig pow2 = {.capacity_policy = HT_CAPACITY_POW2};
+    const TableConfig pow2_filter = {.capacity_policy = HT_CAPACITY_POW2, .lookup_filter = true};
+    run("prime", &prime, keys, present, absent, lookups);
+    run("prime+filter", &prime_filter, keys, present, absent, lookups);
+    run("pow2", &pow2, keys, present, absent, lookups);
+    run("pow2+filter", &pow2_filter, keys, present, absent, lookups);
+    free(present);
+    free(absent);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @brief  Lookups in a table larger than the TLB reach, on 4 KB and huge pages.
+ * @details Fills a HT_CAPACITY_POW2 table of `keys` keys under every page
+ *  policy and times `lookups` finds of random keys. dTLB load misses per
+ *  lookup come from a perf event counting this thread in user space
+ *  ("n/a" where perf events are not allowed, see
+ *  /proc/sys/kernel/perf_event_paranoid); the huge page bytes the kernel
+ *  granted come from AnonHugePages and Private_Hugetlb of smaps_rollup.
+ *  usage: huge_page_bench [keys] [lookups]   (default 8388608 4000000)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../lib/hash-table.h"
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief opens a disabled counter of dTLB read misses, -1 when refused
+ * */
+static int dtlb_counter(void)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * @brief kB of huge pages backing the process, transparent and hugetlbfs
+ * */
+static long huge_kb(void)
+{
+    FILE *file = fopen("/proc/self/smaps_rollup", "r");
+    if (file == NULL)
+        return -1;
+    char line[256];
+    long total = 0, kb;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1 || sscanf(line, "Private_Hugetlb: %ld kB", &kb) == 1)
+            total += kb;
+    }
+    fclose(file);
+    return total;
+}
+
+static void run(const char *label, const int pages, const int keys, const int lookups)
+{
+    const long huge_before = huge_kb();
+    const TableConfig config = {.capacity_policy = HT_CAPACITY_POW2, .pages = pages};
+    Table *table = ht_new_with_config(&config);
+    table = ht_reserve(table, keys);
+    char key[32];
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "user:%08d", i);
+        table = ht_insert(table, key, "v");
+    }
+    const long huge = huge_kb() - huge_before;
+
+    const int counter = dtlb_counter();
+    uint64_t rng = 88172645463325252ull;
+    size_t hits = 0;
+    if (counter >= 0)
+    {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    const double start = now_ms();
+    for (int i = 0; i < lookups; i++)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        snprintf(key, sizeof(key), "user:%08d", (int)(rng % (uint64_t)keys));
+        hits += ht_find(table, key) != NULL;
+    }
+    const double ms = now_ms() - start;
+    uint64_t misses = 0;
+    if (counter >= 0)
+    {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter, &misses, sizeof(misses)) != sizeof(misses))
+            misses = 0;
+        close(counter);
+    }
+    if (hits != (size_t)lookups)
+        exit(1);
+    printf("%-12s %7.1f ns/find  slots %5.0f MB  huge pages %6ld MB  ", label, ms * 1e6 / lookups,
+           (double)table->size * sizeof(Item *) / (1 << 20), huge / 1024);
+    if (counter >= 0)
+        printf("dTLB misses %.2f/find\n", (double)misses / lookups);
+    else
+        printf("dTLB misses n/a\n");
+    delete_Table(table);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 23;
+    const int lookups = argc > 2 ? atoi(argv[2]) : 4000000;
+    run("4 KB pages", HT_PAGES_DEFAULT, keys, lookups);
+    run("transparent", HT_PAGES_TRANSPARENT, keys, lookups);
+    run("hugetlb", HT_PAGES_HUGETLB, keys, lookups);
+    return 0;
+}
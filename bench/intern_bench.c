@@ -0,0 +1,72 @@
+/**
+ * @brief  Memory and insert cost of interned values against plain copies.
+ * @details Loads `keys` entries whose values are drawn from `distinct`
+ *  status/region strings into a plain table and an interning one, then
+ *  repeats with every value distinct, the worst case for the pool.
+ *  Bytes per entry count the slot array, the table arena (nodes, keys,
+ *  values and pool entries) and the pool index.
+ *  usage: intern_bench [keys] [distinct]   (default 1048576 64)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+#include "../lib/intern-pool.h"
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static void run(const char *label, const bool intern, const int keys, const int distinct)
+{
+    TableConfig config = {.intern_values = intern};
+    char key[32], value[64];
+    double start = now_ms();
+    Table *table = ht_new_with_config(&config);
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "customer:%08d", i);
+        const int v = distinct > 0 ? (int)(((unsigned)i * 2654435761u) % (unsigned)distinct) : i;
+        snprintf(value, sizeof(value), "region=eu-west-%d;status=active", v);
+        table = ht_insert(table, key, value);
+    }
+    const double insert_ms = now_ms() - start;
+
+    start = now_ms();
+    size_t hits = 0;
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "customer:%08d", (int)(((unsigned)i * 40503u) % (unsigned)keys));
+        hits += ht_find(table, key) != NULL;
+    }
+    const double find_ms = now_ms() - start;
+
+    TableStats stats;
+    ht_stats(table, &stats);
+    size_t bytes = sizeof(Table) + stats.slot_bytes + stats.arena_bytes;
+    if (table->values != NULL)
+        bytes += sizeof(InternPool) + (table->values->mask + 1) * sizeof(void *);
+    printf("%-10s %-7s %10.1f %10.1f %10.1f %10zu\n", label, intern ? "intern" : "plain",
+           (double)bytes / keys, insert_ms * 1e6 / keys, find_ms * 1e6 / keys,
+           table->values != NULL ? table->values->count : (size_t)0);
+    delete_Table(table);
+    if (hits != (size_t)keys)
+        exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    const int distinct = argc > 2 ? atoi(argv[2]) : 64;
+    printf("%d keys\n%-10s %-7s %10s %10s %10s %10s\n", keys, "values", "table", "B/entry", "insert ns", "find ns", "pooled");
+    run("repeated", false, keys, distinct);
+    run("repeated", true, keys, distinct);
+    run("distinct", false, keys, 0);
+    run("distinct", true, keys, 0);
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * @brief  Memory per entry and lookup cost of the default engine over a
+ *  mix of key and value lengths.
+ * @details Key and value lengths are drawn from the histograms below,
+ *  which follow the sampled session/feature store: most keys are short
+ *  IDs, a tail are composite keys, values are mostly counters and flags.
+ *  Replace them with another sample to measure another workload. Bytes
+ *  per entry count the slot array, the table arena (nodes, keys, values
+ *  and what the size classes round up) and the Table itself.
+ *  usage: item_layout_bench [keys]   (default 1048576)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/arena.h"
+#include "../lib/hash-table.h"
+
+#define LAYOUT_MAX_LEN 96
+
+struct length_bucket
+{
+    int len;
+    int weight;
+};
+
+static const struct length_bucket KEY_LENGTHS[] = {
+    {6, 10}, {8, 20}, {10, 20}, {12, 15}, {14, 10}, {20, 10}, {32, 10}, {64, 5},
+};
+
+static const struct length_bucket VALUE_LENGTHS[] = {
+    {1, 25}, {4, 25}, {8, 20}, {12, 10}, {24, 10}, {48, 5}, {90, 5},
+};
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int pick_length(const struct length_bucket *buckets, const int n)
+{
+    int total = 0;
+    for (int i = 0; i < n; i++)
+        total += buckets[i].weight;
+    int r = rand() % total;
+    for (int i = 0; i < n; i++)
+    {
+        if (r < buckets[i].weight)
+            return buckets[i].len;
+        r -= buckets[i].weight;
+    }
+    return buckets[n - 1].len;
+}
+
+/**
+ * @brief writes a unique key of `len` bytes (at least the hex digits of i)
+ * */
+static int make_key(char *out, const int i, const int len)
+{
+    int n = snprintf(out, LAYOUT_MAX_LEN, "%x", i);
+    for (; n < len; n++)
+        out[n] = (char)('a' + n % 26);
+    out[n] = '\0';
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    const int n_key = sizeof(KEY_LENGTHS) / sizeof(KEY_LENGTHS[0]);
+    const int n_value = sizeof(VALUE_LENGTHS) / sizeof(VALUE_LENGTHS[0]);
+    char **names = malloc((size_t)keys * sizeof(char *));
+    char value[LAYOUT_MAX_LEN + 1];
+    if (names == NULL)
+        return 1;
+    memset(value, 'v', LAYOUT_MAX_LEN);
+    srand(42);
+
+    size_t key_total = 0, value_total = 0;
+    Table *table = ht_new();
+    for (int i = 0; i < keys; i++)
+    {
+        char key[LAYOUT_MAX_LEN + 1];
+        const int key_len = make_key(key, i, pick_length(KEY_LENGTHS, n_key));
+        const int value_len = pick_length(VALUE_LENGTHS, n_value);
+        names[i] = strdup(key);
+        table = ht_insert_bytes(table, key, (size_t)key_len, value, (size_t)value_len);
+        key_total += (size_t)key_len;
+        value_total += (size_t)value_len;
+    }
+
+    const double start = now_ms();
+    size_t hits = 0;
+    for (int round = 0; round < 4; round++)
+        for (int i = 0; i < keys; i++)
+            hits += ht_find(table, names[(int)(((unsigned)i * 2654435761u) % (unsigned)keys)]) != NULL;
+    const double find_ms = now_ms() - start;
+
+    TableStats stats;
+    ht_stats(table, &stats);
+    const double total = (double)(sizeof(Table) + stats.slot_bytes + stats.arena_bytes);
+    printf("%d keys, mean key %.1f B, mean value %.1f B, sizeof(Item) %zu\n", keys,
+           (double)key_total / keys, (double)value_total / keys, sizeof(Item));
+    printf("bytes/entry      %8.1f (slots %.1f, arena reserved %.1f, arena in use %.1f)\n",
+           total / keys, (double)stats.slot_bytes / keys, (double)stats.arena_bytes / keys,
+           (double)table->arena->bytes_in_use / keys);
+    printf("find ns/op       %8.1f\n", find_ms * 1e6 / (4.0 * keys));
+
+    for (int i = 0; i < keys; i++)
+        free(names[i]);
+    free(names);
+    delete_Table(table);
+    return hits != (size_t)keys * 4;
+}
@@ -0,0 +1,187 @@
+/**
+ * @brief  Reader throughput of the lock-free table from 1 to 64 readers.
+ * @details One writer thread keeps deleting and reinserting keys while
+ *  the readers look keys up, once against a `LockFreeTable` (epoch read
+ *  sections, no locks) and once against a `ConcurrentTable` with rwlock
+ *  shards. Prints millions of reader lookups per second.
+ *  usage: lockfree_bench [keys] [ms per run]   (default 1048576 500)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../lib/lockfree-table.h"
+#include "../lib/concurrent-table.h"
+
+#define BENCH_SHARDS 64
+
+enum bench_mode
+{
+    BENCH_LOCKFREE,
+    BENCH_SHARDED_RWLOCK,
+};
+
+struct bench_shared
+{
+    int mode;
+    int keys;
+    char **key_names;
+    LockFreeTable *lf;
+    ConcurrentTable *ct;
+    int stop;
+};
+
+struct bench_worker
+{
+    struct bench_shared *shared;
+    unsigned seed;
+    unsigned long ops;
+};
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static inline unsigned next_random(unsigned *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void *reader_thread(void *arg)
+{
+    struct bench_worker *worker = arg;
+    struct bench_shared *shared = worker->shared;
+    LfReader *reader = shared->mode == BENCH_LOCKFREE ? lf_register_reader(shared->lf) : NULL;
+    char value[32];
+    unsigned long ops = 0;
+    while (!__atomic_load_n(&shared->stop, __ATOMIC_RELAXED))
+    {
+        const char *key = shared->key_names[next_random(&worker->seed) % (unsigned)shared->keys];
+        if (shared->mode == BENCH_LOCKFREE)
+        {
+            lf_read_lock(shared->lf, reader);
+            const char *found = lf_find(shared->lf, key);
+            if (found != NULL)
+                strcpy(value, found);
+            lf_read_unlock(reader);
+        }
+        else
+            ct_find(shared->ct, key, value, sizeof(value));
+        ops++;
+    }
+    if (reader != NULL)
+        lf_unregister_reader(reader);
+    worker->ops = ops;
+    return NULL;
+}
+
+static void *writer_thread(void *arg)
+{
+    struct bench_worker *worker = arg;
+    struct bench_shared *shared = worker->shared;
+    while (!__atomic_load_n(&shared->stop, __ATOMIC_RELAXED))
+    {
+        const char *key = shared->key_names[next_random(&worker->seed) % (unsigned)shared->keys];
+        if (shared->mode == BENCH_LOCKFREE)
+        {
+            lf_delete(shared->lf, key);
+            lf_insert(shared->lf, key, "value");
+        }
+        else
+        {
+            ct_delete(shared->ct, key);
+            ct_insert(shared->ct, key, "value");
+        }
+    }
+    return NULL;
+}
+
+static double run(struct bench_shared *shared, int readers, int duration_ms)
+{
+    pthread_t ids[64], writer;
+    struct bench_worker workers[64];
+    struct bench_worker writer_worker = {shared, 0x85ebca6bu, 0};
+    shared->stop = 0;
+    pthread_create(&writer, NULL, writer_thread, &writer_worker);
+    for (int t = 0; t < readers; t++)
+    {
+        workers[t].shared = shared;
+        workers[t].seed = 0x9e3779b9u * (unsigned)(t + 1);
+        pthread_create(&ids[t], NULL, reader_thread, &workers[t]);
+    }
+    const double start = now_ms();
+    struct timespec pause = {duration_ms / 1000, (long)(duration_ms % 1000) * 1000000L};
+    nanosleep(&pause, NULL);
+    __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+    unsigned long total = 0;
+    for (int t = 0; t < readers; t++)
+    {
+        pthread_join(ids[t], NULL);
+        total += workers[t].ops;
+    }
+    pthread_join(writer, NULL);
+    return (double)total / ((now_ms() - start) * 1e3);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    const int duration_ms = argc > 2 ? atoi(argv[2]) : 500;
+    const char *mode_names[2] = {"lockfree", "sharded-rwlock"};
+    const int reader_counts[7] = {1, 2, 4, 8, 16, 32, 64};
+
+    struct bench_shared shared;
+    shared.keys = keys;
+    shared.key_names = malloc(sizeof(char *) * (size_t)keys);
+    for (int i = 0; i < keys; i++)
+    {
+        shared.key_names[i] = malloc(24);
+        snprintf(shared.key_names[i], 24, "user:%08d", i);
+    }
+
+    printf("%-15s", "mode");
+    for (int t = 0; t < 7; t++)
+        printf(" %7dR", reader_counts[t]);
+    printf("   (Mops/s, 1 writer)\n");
+    for (int mode = 0; mode < 2; mode++)
+    {
+        shared.mode = mode;
+        shared.lf = NULL;
+        shared.ct = NULL;
+        if (mode == BENCH_LOCKFREE)
+        {
+            shared.lf = lf_new(NULL, 0);
+            for (int i = 0; i < keys; i++)
+                lf_insert(shared.lf, shared.key_names[i], "value");
+        }
+        else
+        {
+            shared.ct = ct_new(BENCH_SHARDS, CT_LOCK_RWLOCK, NULL);
+            for (int i = 0; i < keys; i++)
+                ct_insert(shared.ct, shared.key_names[i], "value");
+        }
+        printf("%-15s", mode_names[mode]);
+        for (int t = 0; t < 7; t++)
+        {
+            printf(" %8.2f", run(&shared, reader_counts[t], duration_ms));
+            fflush(stdout);
+        }
+        printf("\n");
+        if (shared.lf != NULL)
+            delete_LockFreeTable(shared.lf);
+        if (shared.ct != NULL)
+            delete_ConcurrentTable(shared.ct);
+    }
+    for (int i = 0; i < keys; i++)
+        free(shared.key_names[i]);
+    free(shared.key_names);
+    return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * @brief  Time of one large `ht_reserve` by number of rehash threads.
+ * @details Fills a HT_CAPACITY_POW2 table with `keys` keys, then reserves
+ *  room for four times as many, which moves every item once into a slot
+ *  array eight times larger. The serial rehash of a table filled the
+ *  same way is the baseline, and every parallel layout is checked
+ *  against it slot by slot.
+ *  usage: rehash_bench [keys] [max threads]   (default 4194304 8)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static Table *fill(const int threads, const int keys)
+{
+    const TableConfig config = {.capacity_policy = HT_CAPACITY_POW2, .rehash_threads = threads};
+    Table *table = ht_new_with_config(&config);
+    table = ht_reserve(table, keys);
+    char key[32];
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "user:%08d", i);
+        table = ht_insert(table, key, "v");
+    }
+    return table;
+}
+
+static double reserve_ms(Table *table, const int keys)
+{
+    const double start = now_ms();
+    ht_reserve(table, keys * 4);
+    return now_ms() - start;
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 22;
+    const int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+    Table *serial = fill(1, keys);
+    const double serial_ms = reserve_ms(serial, keys);
+    printf("serial     %8.1f ms  %d slots\n", serial_ms, serial->size);
+    for (int threads = 2; threads <= max_threads; threads *= 2)
+    {
+        Table *table = fill(threads, keys);
+        const double ms = reserve_ms(table, keys);
+        int same = 1;
+        for (int idx = 0; idx < table->size && same; idx++)
+            same = (table->items[idx] == NULL) == (serial->items[idx] == NULL) &&
+                   (table->items[idx] == NULL || table->items[idx]->hash == serial->items[idx]->hash);
+        printf("%2d threads %8.1f ms  speedup %.2fx  layout %s\n", threads, ms, serial_ms / ms, same ? "same" : "DIFFERS");
+        delete_Table(table);
+    }
+    delete_Table(serial);
+    return 0;
+}
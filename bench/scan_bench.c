@@ -0,0 +1,73 @@
+/**
+ * @brief  Pause per call of an incremental `ht_scan` against one full walk.
+ * @details Fills a table, then visits every item once with a budget large
+ *  enough to finish in one call and once per budget below, timing each
+ *  call. A background task interleaving scan calls with requests blocks
+ *  them for the longest call, not for the whole walk.
+ *  usage: scan_bench [keys]   (default 1048576)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+static inline double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static void count_item(const Item *item, void *ctx)
+{
+    *(size_t *)ctx += item->value_len;
+}
+
+static void run(const char *label, const TableConfig *config, const int keys)
+{
+    char key[32];
+    Table *table = ht_new_with_config(config);
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "user:%08d", i);
+        table = ht_insert(table, key, "v");
+    }
+    const int budgets[] = {1 << 30, 10000, 1000, 100};
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++)
+    {
+        size_t visited = 0;
+        long calls = 0;
+        double max_us = 0;
+        const double start = now_us();
+        uint64_t cursor = 0;
+        do
+        {
+            const double call = now_us();
+            cursor = ht_scan(table, cursor, count_item, &visited, budgets[b]);
+            const double took = now_us() - call;
+            if (took > max_us)
+                max_us = took;
+            calls++;
+        } while (cursor != 0);
+        printf("%-12s budget %-10d calls %8ld  total %8.1f ms  max pause %9.1f us  visited %zu\n",
+               label, budgets[b], calls, (now_us() - start) / 1e3, max_us, visited);
+    }
+    delete_Table(table);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    const TableConfig prime = {0};
+    const TableConfig pow2 = {.capacity_policy = HT_CAPACITY_POW2};
+    const TableConfig swiss = {.engine = HT_ENGINE_SWISS};
+    const TableConfig robin_hood = {.engine = HT_ENGINE_ROBIN_HOOD};
+    const TableConfig cuckoo = {.engine = HT_ENGINE_CUCKOO};
+    run("prime", &prime, keys);
+    run("pow2", &pow2, keys);
+    run("swiss", &swiss, keys);
+    run("robin-hood", &robin_hood, keys);
+    run("cuckoo", &cuckoo, keys);
+    return 0;
+}
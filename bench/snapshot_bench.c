@@ -0,0 +1,77 @@
+/**
+ * @brief  Warm start from a mapped image against rebuilding with `ht_insert`.
+ * @details Builds a table of `keys` entries one insert at a time, saves
+ *  it, then maps the image back and times the first lookups, which fault
+ *  the touched pages in from the page cache. Run it twice to see the
+ *  mapping of a file that is already cached.
+ *  usage: snapshot_bench [keys] [image]   (default 1048576 snapshot_bench.img)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+#include "../lib/snapshot.h"
+
+#define BENCH_LOOKUPS 100000
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    const char *path = argc > 2 ? argv[2] : "snapshot_bench.img";
+    char key[32], value[32];
+
+    double start = now_ms();
+    Table *table = ht_new();
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "user:%08d", i);
+        snprintf(value, sizeof(value), "session-%d", i);
+        table = ht_insert(table, key, value);
+    }
+    const double build_ms = now_ms() - start;
+
+    start = now_ms();
+    if (ht_save(table, path) != 0)
+    {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    const double save_ms = now_ms() - start;
+    delete_Table(table);
+
+    start = now_ms();
+    Table *mapped = ht_open_mmap(path, HT_MMAP_READ_ONLY);
+    const double open_ms = now_ms() - start;
+    if (mapped == NULL)
+    {
+        fprintf(stderr, "cannot map %s\n", path);
+        return 1;
+    }
+    srand(42);
+    size_t hits = 0;
+    start = now_ms();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        snprintf(key, sizeof(key), "user:%08d", rand() % keys);
+        hits += ht_find(mapped, key) != NULL;
+    }
+    const double lookup_ms = now_ms() - start;
+    delete_Table(mapped);
+
+    printf("keys %d\n", keys);
+    printf("rebuild with ht_insert  %10.1f ms\n", build_ms);
+    printf("ht_save                 %10.1f ms\n", save_ms);
+    printf("ht_open_mmap            %10.3f ms\n", open_ms);
+    printf("first %d lookups    %10.1f ms (%zu hits)\n", BENCH_LOOKUPS, lookup_ms, hits);
+    remove(path);
+    return 0;
+}
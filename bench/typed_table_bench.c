@@ -0,0 +1,101 @@
+/**
+ * @brief  64-bit IDs mapped to fixed-size records, typed table against
+ *  the string table.
+ * @details The string table is driven the way callers used it before
+ *  typed tables: the ID is formatted as a decimal string and the record
+ *  stored as a length-delimited value. The typed table stores both
+ *  inline. Inserts, lookups of present IDs and lookups of absent IDs are
+ *  timed separately.
+ *  usage: typed_table_bench [keys]   (default 1048576)
+ *  */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+#include "../lib/typed-table.h"
+
+struct record
+{
+    uint64_t id;
+    uint64_t created;
+    uint32_t region;
+    uint32_t flags;
+};
+
+HT_TYPED_TABLE(RecordTable, uint64_t, struct record, ht_typed_hash_u64, ht_typed_eq_scalar)
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// scattered IDs, like the ones of the production tables
+static inline uint64_t id_of(const uint64_t i)
+{
+    return i * 0x9E3779B97F4A7C15ull;
+}
+
+int main(int argc, char **argv)
+{
+    const uint64_t keys = argc > 1 ? strtoull(argv[1], NULL, 10) : 1 << 20;
+    char key[24];
+    uint64_t checksum = 0;
+
+    double start = now_ms();
+    Table *strings = ht_new();
+    for (uint64_t i = 0; i < keys; i++)
+    {
+        const struct record record = {.id = id_of(i), .created = i, .region = (uint32_t)(i & 7)};
+        const int len = snprintf(key, sizeof(key), "%" PRIu64, id_of(i));
+        strings = ht_insert_bytes(strings, key, (size_t)len, &record, sizeof(record));
+    }
+    const double string_insert = now_ms() - start;
+    start = now_ms();
+    for (uint64_t i = 0; i < keys; i++)
+    {
+        const int len = snprintf(key, sizeof(key), "%" PRIu64, id_of(i));
+        // values are not aligned for struct record, copy it out
+        struct record record;
+        memcpy(&record, ht_find_bytes(strings, key, (size_t)len, NULL), sizeof(record));
+        checksum += record.created;
+    }
+    const double string_hit = now_ms() - start;
+    start = now_ms();
+    for (uint64_t i = keys; i < 2 * keys; i++)
+    {
+        const int len = snprintf(key, sizeof(key), "%" PRIu64, id_of(i));
+        checksum += ht_find_bytes(strings, key, (size_t)len, NULL) == NULL;
+    }
+    const double string_miss = now_ms() - start;
+    delete_Table(strings);
+
+    start = now_ms();
+    RecordTable *typed = RecordTable_new(0);
+    for (uint64_t i = 0; i < keys; i++)
+    {
+        const struct record record = {.id = id_of(i), .created = i, .region = (uint32_t)(i & 7)};
+        RecordTable_insert(typed, id_of(i), record);
+    }
+    const double typed_insert = now_ms() - start;
+    start = now_ms();
+    for (uint64_t i = 0; i < keys; i++)
+        checksum -= RecordTable_find(typed, id_of(i))->created;
+    const double typed_hit = now_ms() - start;
+    start = now_ms();
+    for (uint64_t i = keys; i < 2 * keys; i++)
+        checksum -= RecordTable_find(typed, id_of(i)) == NULL;
+    const double typed_miss = now_ms() - start;
+    RecordTable_free(typed);
+
+    printf("%" PRIu64 " keys, %zu byte records\n", keys, sizeof(struct record));
+    printf("%-14s %10s %10s %10s\n", "table", "insert ms", "hit ms", "miss ms");
+    printf("%-14s %10.1f %10.1f %10.1f\n", "string", string_insert, string_hit, string_miss);
+    printf("%-14s %10.1f %10.1f %10.1f\n", "typed", typed_insert, typed_hit, typed_miss);
+    // every typed lookup undoes a string lookup
+    return checksum != 0;
+}
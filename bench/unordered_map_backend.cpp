@@ -0,0 +1,126 @@
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "unordered_map_backend.h"
+
+namespace
+{
+
+/**
+ * @brief allocator adding every allocation to a counter owned by the map
+ * */
+template <typename T>
+struct CountingAllocator
+{
+    using value_type = T;
+
+    size_t *bytes;
+
+    explicit CountingAllocator(size_t *counter) : bytes(counter) {}
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U> &other) : bytes(other.bytes) {}
+
+    T *allocate(size_t n)
+    {
+        *bytes += n * sizeof(T);
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        *bytes -= n * sizeof(T);
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U> &other) const { return bytes == other.bytes; }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U> &other) const { return bytes != other.bytes; }
+};
+
+using String = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+// keys are views of bytes the map allocates itself, so lookups and
+// removals hash and compare the caller's bytes without building a string
+using Map = std::unordered_map<std::string_view, String, std::hash<std::string_view>, std::equal_to<std::string_view>,
+                               CountingAllocator<std::pair<const std::string_view, String>>>;
+
+} // namespace
+
+struct um_map
+{
+    size_t bytes = 0;
+    Map map{16, std::hash<std::string_view>(), std::equal_to<std::string_view>(),
+            CountingAllocator<std::pair<const std::string_view, String>>(&bytes)};
+
+    ~um_map()
+    {
+        for (const auto &entry : map)
+            free_key(entry.first);
+    }
+
+    void free_key(std::string_view key)
+    {
+        CountingAllocator<char>(&bytes).deallocate(const_cast<char *>(key.data()), key.size());
+    }
+};
+
+struct um_map *um_new(void)
+{
+    return new um_map();
+}
+
+void um_free(struct um_map *map)
+{
+    delete map;
+}
+
+void um_insert(struct um_map *map, const char *key, size_t key_len, const char *value, size_t value_len)
+{
+    CountingAllocator<char> alloc(&map->bytes);
+    const auto found = map->map.find(std::string_view(key, key_len));
+    if (found != map->map.end())
+    {
+        found->second.assign(value, value_len);
+        return;
+    }
+    char *owned = alloc.allocate(key_len);
+    std::memcpy(owned, key, key_len);
+    map->map.emplace(std::string_view(owned, key_len), String(value, value_len, alloc));
+}
+
+const char *um_find(struct um_map *map, const char *key, size_t key_len)
+{
+    const auto found = map->map.find(std::string_view(key, key_len));
+    return found == map->map.end() ? nullptr : found->second.c_str();
+}
+
+void um_remove(struct um_map *map, const char *key, size_t key_len)
+{
+    const auto found = map->map.find(std::string_view(key, key_len));
+    if (found == map->map.end())
+        return;
+    const std::string_view owned = found->first;
+    map->map.erase(found);
+    map->free_key(owned);
+}
+
+size_t um_bytes(const struct um_map *map)
+{
+    return sizeof(um_map) + map->bytes;
+}
+
+size_t um_buckets(const struct um_map *map)
+{
+    return map->map.bucket_count();
+}
+
+size_t um_count(const struct um_map *map)
+{
+    return map->map.size();
+}
@@ -0,0 +1,42 @@
+#ifndef UNORDERED_MAP_BACKEND_H
+#define UNORDERED_MAP_BACKEND_H
+
+/**
+ * @brief  std::unordered_map<std::string_view, std::string> behind a C interface.
+ * @details Baseline for the workload benchmark. Every allocation of the
+ *  map goes through a counting allocator so its memory per entry can be
+ *  compared with the tables'. Keys are copied into allocations of their
+ *  own and viewed by the map, so finds and removals allocate nothing.
+ *  Values short enough for the small string buffer of the standard
+ *  library allocate nothing of their own.
+ *  */
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct um_map;
+
+struct um_map *um_new(void);
+
+void um_free(struct um_map *);
+
+void um_insert(struct um_map *, const char *, size_t, const char *, size_t);
+
+const char *um_find(struct um_map *, const char *, size_t);
+
+void um_remove(struct um_map *, const char *, size_t);
+
+// bytes held by the map, its nodes and its strings
+size_t um_bytes(const struct um_map *);
+
+size_t um_buckets(const struct um_map *);
+
+size_t um_count(const struct um_map *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNORDERED_MAP_BACKEND_H
@@ -0,0 +1,166 @@
+/**
+ * @brief  Read-modify-write counters and get-or-insert, through entries
+ *  and through separate finds, deletes and inserts.
+ * @details Counts `updates` events over `keys` counters stored as decimal
+ *  strings. Without entries an increment finds the counter, deletes it and
+ *  inserts the new count, since `ht_insert` would add a second item; with
+ *  an entry it probes once and rewrites the value in place. Get-or-insert
+ *  asks for `updates` keys of which half are new, as `ht_find` followed
+ *  by `ht_insert` on a miss and as `ht_get_or_insert`. Every variant runs
+ *  BENCH_PASSES times on a new table and reports its fastest pass.
+ *  usage: upsert_bench [keys] [updates]   (default 1000000 4000000)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+
+// runs of every variant, the fastest is reported
+#define BENCH_PASSES 3
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static inline uint64_t next_random(uint64_t *rng)
+{
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 7;
+    *rng ^= *rng << 17;
+    return *rng;
+}
+
+/**
+ * @brief finds the counter, deletes it and inserts the incremented count
+ * */
+static void count_find_delete_insert(Table *table, const char *key)
+{
+    char count[24];
+    const char *value = ht_find(table, key);
+    const long n = value != NULL ? atol(value) + 1 : 1;
+    if (value != NULL)
+        ht_delete(table, key);
+    snprintf(count, sizeof(count), "%ld", n);
+    ht_insert(table, key, count);
+}
+
+/**
+ * @brief finds the entry of the counter and sets the incremented count
+ * */
+static void count_entry(Table *table, const char *key)
+{
+    char count[24];
+    TableEntry entry = ht_entry(table, key);
+    const long n = entry.item != NULL ? atol(ht_item_value(entry.item)) + 1 : 1;
+    const int len = snprintf(count, sizeof(count), "%ld", n);
+    ht_entry_set(&entry, count, (size_t)len);
+}
+
+/**
+ * @brief ms one pass of counting takes, on a new table
+ * */
+static double count_pass(void (*count)(Table *, const char *), const int keys, const int updates)
+{
+    Table *table = ht_new();
+    char key[32];
+    uint64_t rng = 88172645463325252ull;
+    const double start = now_ms();
+    for (int i = 0; i < updates; i++)
+    {
+        snprintf(key, sizeof(key), "counter:%08d", (int)(next_random(&rng) % (uint64_t)keys));
+        count(table, key);
+    }
+    const double ms = now_ms() - start;
+    long total = 0;
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "counter:%08d", i);
+        const char *value = ht_find(table, key);
+        total += value != NULL ? atol(value) : 0;
+    }
+    if (total != updates)
+        exit(1);
+    delete_Table(table);
+    return ms;
+}
+
+static void run_counters(const char *label, void (*count)(Table *, const char *), const int keys, const int updates)
+{
+    double best = 0;
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        const double ms = count_pass(count, keys, updates);
+        if (pass == 0 || ms < best)
+            best = ms;
+    }
+    printf("counters      %-20s %7.1f ns/update\n", label, best * 1e6 / updates);
+}
+
+/**
+ * @brief ms one pass of get-or-insert requests takes, on a new table
+ * */
+static double get_or_insert_pass(const bool entries, const int keys, const int updates)
+{
+    Table *table = ht_new();
+    char key[32];
+    for (int i = 0; i < keys; i++)
+    {
+        snprintf(key, sizeof(key), "user:%08d", i);
+        table = ht_insert(table, key, "old");
+    }
+    uint64_t rng = 88172645463325252ull;
+    size_t found = 0;
+    const double start = now_ms();
+    for (int i = 0; i < updates; i++)
+    {
+        // odd requests ask for keys not stored yet, or stored by this loop
+        snprintf(key, sizeof(key), "user:%08d", (int)(next_random(&rng) % (uint64_t)keys) + (i & 1) * keys);
+        const char *value;
+        if (entries)
+        {
+            value = ht_get_or_insert(table, key, "new");
+        }
+        else
+        {
+            value = ht_find(table, key);
+            if (value == NULL)
+            {
+                table = ht_insert(table, key, "new");
+                value = "new";
+            }
+        }
+        found += value[0] == 'o';
+    }
+    const double ms = now_ms() - start;
+    if (found != (size_t)updates / 2)
+        exit(1);
+    delete_Table(table);
+    return ms;
+}
+
+static void run_get_or_insert(const bool entries, const int keys, const int updates)
+{
+    double best = 0;
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        const double ms = get_or_insert_pass(entries, keys, updates);
+        if (pass == 0 || ms < best)
+            best = ms;
+    }
+    printf("get-or-insert %-20s %7.1f ns/request\n", entries ? "ht_get_or_insert" : "find, insert", best * 1e6 / updates);
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1000000;
+    const int updates = argc > 2 ? atoi(argv[2]) : 4000000;
+    run_counters("find, delete, insert", count_find_delete_insert, keys, updates);
+    run_counters("ht_entry", count_entry, keys, updates);
+    run_get_or_insert(false, keys, updates);
+    run_get_or_insert(true, keys, updates);
+    return 0;
+}
@@ -0,0 +1,435 @@
+/**
+ * @brief  Workload suite: every engine and std::unordered_map under the
+ *  same realistic operation mixes.
+ * @details Each workload fills a structure with `keys` live keys out of a
+ *  universe of twice as many, then replays `ops` pre-generated operations:
+ *  lookups that hit (uniform or Zipfian over the live keys), lookups that
+ *  miss, inserts of dead keys and deletes of live keys. Every operation is
+ *  timed on its own; latencies include one clock read, for every backend
+ *  alike. An operation during which the slot array changed size counts as
+ *  a resize pause (the fill is included).
+ *  Reports ops/sec, p50/p99/p999 latency, bytes per live entry and resize
+ *  pauses, as an aligned table or as one JSON object per line.
+ *  usage: workload_bench [keys] [ops] [text|json]   (default 262144 1000000 text)
+ *  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../lib/hash-table.h"
+#include "../lib/arena.h"
+#include "unordered_map_backend.h"
+
+#define ZIPF_THETA 0.99
+
+enum bench_op
+{
+    OP_FIND_HIT,
+    OP_FIND_MISS,
+    OP_INSERT,
+    OP_DELETE,
+};
+
+/**
+ * @brief one operation mix
+ * */
+struct workload
+{
+    const char *name;
+    // percent of lookups, of inserts and of deletes, they add up to 100
+    int find_percent;
+    int insert_percent;
+    int delete_percent;
+    // percent of lookups that look for a live key
+    int hit_percent;
+    // hits pick live keys with a Zipfian instead of a uniform distribution
+    int zipf;
+    // bytes in every key
+    int key_len;
+};
+
+static const struct workload WORKLOADS[] = {
+    {"uniform-read-mostly", 95, 3, 2, 100, 0, 16},
+    {"zipf-read-mostly", 95, 3, 2, 100, 1, 16},
+    {"uniform-write-heavy", 50, 25, 25, 100, 0, 16},
+    {"zipf-write-heavy", 50, 25, 25, 100, 1, 16},
+    {"churn", 0, 50, 50, 100, 0, 16},
+    {"miss-heavy", 100, 0, 0, 40, 0, 16},
+    {"short-keys", 95, 3, 2, 80, 0, 8},
+    {"long-keys", 95, 3, 2, 80, 0, 64},
+};
+
+/**
+ * @brief a structure under test behind a common interface
+ * */
+struct backend
+{
+    const char *name;
+    void *(*create)(const struct backend *);
+    void (*destroy)(void *);
+    void (*insert)(void *, const char *, size_t);
+    const char *(*find)(void *, const char *, size_t);
+    void (*remove)(void *, const char *, size_t);
+    // bytes held, slot arrays included
+    size_t (*bytes)(void *, const struct backend *);
+    // slots or buckets, a change marks a resize
+    size_t (*capacity)(void *);
+    TableConfig config;
+};
+
+static void *table_create(const struct backend *backend)
+{
+    return ht_new_with_config(&backend->config);
+}
+
+static void table_destroy(void *table)
+{
+    delete_Table(table);
+}
+
+static void table_insert(void *table, const char *key, size_t key_len)
+{
+    ht_insert_bytes(table, key, key_len, key, key_len);
+}
+
+static const char *table_find(void *table, const char *key, size_t key_len)
+{
+    return ht_find_bytes(table, key, key_len, NULL);
+}
+
+static void table_remove(void *table, const char *key, size_t key_len)
+{
+    ht_delete_bytes(table, key, key_len);
+}
+
+/**
+ * @brief arena bytes plus the slot arrays as `ht_stats` reports them
+ * */
+static size_t table_bytes(void *arg, const struct backend *backend)
+{
+    (void)backend;
+    TableStats stats;
+    ht_stats(arg, &stats);
+    return sizeof(Table) + stats.slot_bytes + stats.arena_bytes;
+}
+
+static size_t table_capacity(void *table)
+{
+    return (size_t)((Table *)table)->size;
+}
+
+static void *um_create(const struct backend *backend)
+{
+    (void)backend;
+    return um_new();
+}
+
+static void um_destroy(void *map)
+{
+    um_free(map);
+}
+
+static void um_insert_key(void *map, const char *key, size_t key_len)
+{
+    um_insert(map, key, key_len, key, key_len);
+}
+
+static const char *um_find_key(void *map, const char *key, size_t key_len)
+{
+    return um_find(map, key, key_len);
+}
+
+static void um_remove_key(void *map, const char *key, size_t key_len)
+{
+    um_remove(map, key, key_len);
+}
+
+static size_t um_bytes_used(void *map, const struct backend *backend)
+{
+    (void)backend;
+    return um_bytes(map);
+}
+
+static size_t um_capacity(void *map)
+{
+    return um_buckets(map);
+}
+
+#define TABLE_BACKEND(label, ...)                                                          \
+    {                                                                                      \
+        label, table_create, table_destroy, table_insert, table_find, table_remove,       \
+            table_bytes, table_capacity, __VA_ARGS__                                       \
+    }
+
+static const struct backend BACKENDS[] = {
+    TABLE_BACKEND("double-hash", {.engine = HT_ENGINE_DOUBLE_HASH}),
+    TABLE_BACKEND("double-hash-pow2", {.engine = HT_ENGINE_DOUBLE_HASH, .capacity_policy = HT_CAPACITY_POW2}),
+    TABLE_BACKEND("swiss", {.engine = HT_ENGINE_SWISS}),
+    TABLE_BACKEND("robin-hood", {.engine = HT_ENGINE_ROBIN_HOOD}),
+    TABLE_BACKEND("cuckoo", {.engine = HT_ENGINE_CUCKOO}),
+    {"std::unordered_map", um_create, um_destroy, um_insert_key, um_find_key, um_remove_key, um_bytes_used, um_capacity, {0}},
+};
+
+/**
+ * @brief xorshift64*, deterministic so every backend replays the same operations
+ * */
+static inline uint64_t bench_rand(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * @brief Zipfian ranks over [0, n) (Gray et al., as in YCSB)
+ * */
+struct zipf
+{
+    double n;
+    double alpha;
+    double zetan;
+    double eta;
+    double half_pow_theta;
+};
+
+static void zipf_init(struct zipf *zipf, const long n)
+{
+    double zetan = 0;
+    for (long i = 1; i <= n; i++)
+        zetan += 1.0 / pow((double)i, ZIPF_THETA);
+    const double zeta2 = 1.0 + 1.0 / pow(2.0, ZIPF_THETA);
+    zipf->n = (double)n;
+    zipf->alpha = 1.0 / (1.0 - ZIPF_THETA);
+    zipf->zetan = zetan;
+    zipf->eta = (1.0 - pow(2.0 / (double)n, 1.0 - ZIPF_THETA)) / (1.0 - zeta2 / zetan);
+    zipf->half_pow_theta = pow(0.5, ZIPF_THETA);
+}
+
+static uint64_t zipf_next(const struct zipf *zipf, uint64_t *state)
+{
+    const double u = (double)(bench_rand(state) >> 11) / 9007199254740992.0;
+    const double uz = u * zipf->zetan;
+    if (uz < 1.0)
+        return 0;
+    if (uz < 1.0 + zipf->half_pow_theta)
+        return 1;
+    return (uint64_t)(zipf->n * pow(zipf->eta * u - zipf->eta + 1.0, zipf->alpha));
+}
+
+/**
+ * @brief a pre-generated operation, `r` picks the key once the live
+ * count at that point of the replay is known
+ * */
+struct bench_step
+{
+    int op;
+    uint64_t r;
+};
+
+/**
+ * @brief measurements of one workload on one backend
+ * */
+struct bench_result
+{
+    double ops_per_sec;
+    double p50;
+    double p99;
+    double p999;
+    double bytes_per_entry;
+    int resizes;
+    double resize_total_ms;
+    double resize_max_ms;
+};
+
+static inline double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_float(const void *a, const void *b)
+{
+    const float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_resize_pause(struct bench_result *result, const double ns)
+{
+    result->resizes++;
+    result->resize_total_ms += ns / 1e6;
+    if (ns / 1e6 > result->resize_max_ms)
+        result->resize_max_ms = ns / 1e6;
+}
+
+/**
+ * @brief fills a backend and replays the steps on it. `order` holds the
+ * key indexes, order[0, live) are live and the rest are not.
+ * */
+static struct bench_result bench_run(const struct backend *backend, char **names, const int key_len, int *order,
+                                     const int keys, const struct bench_step *steps, const int ops, float *latencies)
+{
+    struct bench_result result = {0};
+    for (int i = 0; i < keys * 2; i++)
+        order[i] = i;
+    void *map = backend->create(backend);
+    size_t capacity = backend->capacity(map);
+    for (int i = 0; i < keys; i++)
+    {
+        const double start = now_ns();
+        backend->insert(map, names[i], (size_t)key_len);
+        if (backend->capacity(map) != capacity)
+        {
+            bench_resize_pause(&result, now_ns() - start);
+            capacity = backend->capacity(map);
+        }
+    }
+
+    long live = keys;
+    const long universe = (long)keys * 2;
+    volatile size_t sink = 0;
+    const double begin = now_ns();
+    for (int i = 0; i < ops; i++)
+    {
+        const struct bench_step *step = &steps[i];
+        const double start = now_ns();
+        switch (step->op)
+        {
+        case OP_FIND_HIT:
+            sink += (size_t)backend->find(map, names[order[live > 0 ? step->r % (uint64_t)live : 0]], (size_t)key_len);
+            break;
+        case OP_FIND_MISS:
+            sink += (size_t)backend->find(map, names[order[live + (long)(step->r % (uint64_t)(universe - live))]], (size_t)key_len);
+            break;
+        case OP_INSERT:
+        {
+            if (live == universe)
+                break;
+            const long dead = live + (long)(step->r % (uint64_t)(universe - live));
+            backend->insert(map, names[order[dead]], (size_t)key_len);
+            const int tmp = order[dead];
+            order[dead] = order[live];
+            order[live++] = tmp;
+            break;
+        }
+        case OP_DELETE:
+        {
+            if (live == 0)
+                break;
+            const long victim = (long)(step->r % (uint64_t)live);
+            backend->remove(map, names[order[victim]], (size_t)key_len);
+            const int tmp = order[victim];
+            order[victim] = order[--live];
+            order[live] = tmp;
+            break;
+        }
+        }
+        const double elapsed = now_ns() - start;
+        latencies[i] = (float)elapsed;
+        if (backend->capacity(map) != capacity)
+        {
+            bench_resize_pause(&result, elapsed);
+            capacity = backend->capacity(map);
+        }
+    }
+    const double total = now_ns() - begin;
+    (void)sink;
+
+    result.ops_per_sec = (double)ops / (total / 1e9);
+    result.bytes_per_entry = live > 0 ? (double)backend->bytes(map, backend) / (double)live : 0;
+    qsort(latencies, (size_t)ops, sizeof(float), compare_float);
+    result.p50 = latencies[ops / 2];
+    result.p99 = latencies[(size_t)ops * 99 / 100];
+    result.p999 = latencies[(size_t)ops * 999 / 1000];
+    backend->destroy(map);
+    return result;
+}
+
+/**
+ * @brief draws the operations of a workload
+ * */
+static void bench_steps(const struct workload *workload, const struct zipf *zipf, const int ops, struct bench_step *steps)
+{
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < ops; i++)
+    {
+        const int roll = (int)(bench_rand(&state) % 100);
+        struct bench_step *step = &steps[i];
+        if (roll < workload->find_percent)
+        {
+            step->op = (int)(bench_rand(&state) % 100) < workload->hit_percent ? OP_FIND_HIT : OP_FIND_MISS;
+            step->r = step->op == OP_FIND_HIT && workload->zipf ? zipf_next(zipf, &state) : bench_rand(&state);
+        }
+        else
+        {
+            step->op = roll < workload->find_percent + workload->insert_percent ? OP_INSERT : OP_DELETE;
+            step->r = bench_rand(&state);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int keys = argc > 1 ? atoi(argv[1]) : 1 << 18;
+    const int ops = argc > 2 ? atoi(argv[2]) : 1000000;
+    const int json = argc > 3 && strcmp(argv[3], "json") == 0;
+    const int workload_count = (int)(sizeof(WORKLOADS) / sizeof(WORKLOADS[0]));
+    const int backend_count = (int)(sizeof(BACKENDS) / sizeof(BACKENDS[0]));
+
+    char **names = malloc(sizeof(char *) * (size_t)keys * 2);
+    int *order = malloc(sizeof(int) * (size_t)keys * 2);
+    struct bench_step *steps = malloc(sizeof(struct bench_step) * (size_t)ops);
+    float *latencies = malloc(sizeof(float) * (size_t)ops);
+    if (names == NULL || order == NULL || steps == NULL || latencies == NULL)
+        return 1;
+    for (int i = 0; i < keys * 2; i++)
+        names[i] = NULL;
+    struct zipf zipf;
+    zipf_init(&zipf, keys);
+
+    if (!json)
+        printf("%-20s %-18s %10s %8s %8s %8s %8s %7s %9s\n", "workload", "backend", "Mops/s", "p50ns", "p99ns",
+               "p999ns", "B/entry", "resizes", "maxpause");
+    int names_len = 0;
+    for (int w = 0; w < workload_count; w++)
+    {
+        const struct workload *workload = &WORKLOADS[w];
+        if (names_len != workload->key_len)
+        {
+            // "k" followed by the zero padded index in hex up to the key length
+            for (int i = 0; i < keys * 2; i++)
+            {
+                free(names[i]);
+                names[i] = malloc((size_t)workload->key_len + 1);
+                snprintf(names[i], (size_t)workload->key_len + 1, "k%0*x", workload->key_len - 1, (unsigned)i);
+            }
+            names_len = workload->key_len;
+        }
+        bench_steps(workload, &zipf, ops, steps);
+        for (int b = 0; b < backend_count; b++)
+        {
+            const struct bench_result r = bench_run(&BACKENDS[b], names, workload->key_len, order, keys, steps, ops, latencies);
+            if (json)
+                printf("{\"workload\":\"%s\",\"backend\":\"%s\",\"keys\":%d,\"ops\":%d,\"key_len\":%d,"
+                       "\"ops_per_sec\":%.0f,\"p50_ns\":%.0f,\"p99_ns\":%.0f,\"p999_ns\":%.0f,"
+                       "\"bytes_per_entry\":%.1f,\"resizes\":%d,\"resize_total_ms\":%.3f,\"resize_max_ms\":%.3f}\n",
+                       workload->name, BACKENDS[b].name, keys, ops, workload->key_len, r.ops_per_sec, r.p50, r.p99,
+                       r.p999, r.bytes_per_entry, r.resizes, r.resize_total_ms, r.resize_max_ms);
+            else
+                printf("%-20s %-18s %10.2f %8.0f %8.0f %8.0f %8.1f %7d %7.2fms\n", workload->name, BACKENDS[b].name,
+                       r.ops_per_sec / 1e6, r.p50, r.p99, r.p999, r.bytes_per_entry, r.resizes, r.resize_max_ms);
+            fflush(stdout);
+        }
+    }
+    for (int i = 0; i < keys * 2; i++)
+        free(names[i]);
+    free(names);
+    free(order);
+    free(steps);
+    free(latencies);
+    return 0;
+}
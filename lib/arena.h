@@ -0,0 +1,100 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+ * @brief  Table owned slab/bump allocator.
+ * @details Small blocks are carved out of large chunks by bumping a cursor
+ *  and recycled through one free list per 8-byte size class, so item nodes
+ *  and key/value bytes cost no malloc header and no global allocator lock.
+ *  Blocks above ARENA_MAX_SMALL bytes go to malloc and are tracked so that
+ *  `arena_destroy` releases everything in one pass. Arenas created under
+ *  a page policy map every chunk as ARENA_MAX_CHUNK bytes of huge pages.
+ *  */
+#include <stddef.h>
+
+#include "pages.h"
+
+#define ARENA_ALIGN 8
+#define ARENA_MAX_SMALL 512
+#define ARENA_SIZE_CLASSES (ARENA_MAX_SMALL / ARENA_ALIGN)
+#define ARENA_FIRST_CHUNK (64 * 1024)
+#define ARENA_MAX_CHUNK (4 * 1024 * 1024)
+
+struct arena_chunk;
+struct arena_large;
+
+/**
+ * @brief Structural definition for an arena
+ * */
+struct arena
+{
+    // chunks that small blocks are carved from, newest first
+    struct arena_chunk *chunks;
+    // blocks above ARENA_MAX_SMALL, doubly linked so they can be freed alone
+    struct arena_large *large;
+    // bump cursor and end of the newest chunk
+    char *cursor;
+    char *limit;
+    // size of the next chunk, doubles up to ARENA_MAX_CHUNK
+    size_t next_chunk;
+    // freed small blocks, singly linked through their first word
+    void *free_lists[ARENA_SIZE_CLASSES];
+    // bytes obtained from malloc (chunks and large blocks)
+    size_t bytes_reserved;
+    // bytes handed out and not freed yet, rounded to the size class
+    size_t bytes_in_use;
+    // pages chunks are mapped with, zeroed for the heap
+    struct page_policy pages;
+};
+
+typedef struct arena Arena;
+
+/**
+ * @brief bytes a block of `size` bytes really takes, so two sizes with the
+ * same rounded size may share a block
+ * */
+static inline size_t arena_round(size_t size)
+{
+    return size == 0 ? ARENA_ALIGN : (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/**
+ * @brief creates an empty arena, no memory is reserved until the first alloc
+ * */
+Arena *arena_new(void);
+
+/**
+ * @brief creates an empty arena whose chunks are allocated under a page policy
+ * @param conststructpage_policy* policy, copied into the arena
+ * */
+Arena *arena_new_paged(const struct page_policy *);
+
+/**
+ * @brief returns `size` bytes aligned to ARENA_ALIGN
+ * @param Arena* arena to allocate from
+ * @param size_t number of bytes, may be 0
+ * */
+void *arena_alloc(Arena *, size_t);
+
+/**
+ * @brief gives a block back to the arena
+ * @param Arena* arena the block was allocated from
+ * @param void* block returned by `arena_alloc`
+ * @param size_t the size passed to `arena_alloc`
+ * */
+void arena_free(Arena *, void *, size_t);
+
+/**
+ * @brief moves every block and chunk of an arena into another and frees
+ * the emptied arena, blocks of either may then be freed to `into`
+ * @param Arena* arena taking the memory
+ * @param Arena* arena given up
+ * */
+void arena_merge(Arena *, Arena *);
+
+/**
+ * @brief frees every block and chunk together with the arena
+ * */
+void arena_destroy(Arena *);
+
+#endif // ARENA_H
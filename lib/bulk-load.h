@@ -0,0 +1,70 @@
+#ifndef BULK_LOAD_H
+#define BULK_LOAD_H
+
+/**
+ * @brief  Parallel construction of a table from a file of records.
+ * @details The file is counted first, so the table is created at its
+ *  final size and never resizes. It is then read in windows of
+ *  HT_BULK_WINDOW bytes. In each window every thread parses and hashes
+ *  one slice of the records and sorts them by the range of buckets their
+ *  probe starts in. Every thread then places the records of one range;
+ *  a record whose probe leaves its range is placed once the threads of
+ *  the window are done. Threads allocate from arenas of their own that
+ *  join the table arena at the end.
+ *  Prefer HT_CAPACITY_POW2: its probe walks neighbouring buckets, so a
+ *  collision rarely leaves the range. The double hash step of
+ *  HT_CAPACITY_PRIME jumps anywhere in the table, so nearly every record
+ *  that collides is left to the serial pass, close to a third of them at
+ *  the usual load.
+ *  Tables with another engine than HT_ENGINE_DOUBLE_HASH are presized,
+ *  parsed the same way and filled by one thread, as are tables interning
+ *  their values.
+ *  */
+#include <stddef.h>
+
+#include "hash-table.h"
+
+#define HT_BULK_WINDOW (64 * 1024 * 1024)
+#define HT_BULK_MAX_THREADS 64
+
+/**
+ * @brief Record layouts `ht_bulk_load` reads
+ * */
+enum hash_table_bulk_format
+{
+    // one "key\tvalue\n" line per record, the key ends at the first tab,
+    // a line without a tab is a key with an empty value
+    HT_BULK_TSV = 0,
+    // little endian uint32 key length, key bytes, uint32 value length,
+    // value bytes, back to back
+    HT_BULK_LENGTH_PREFIXED,
+};
+
+/**
+ * @brief Options of `ht_bulk_load`, zeroed options read TSV with one
+ * thread per online CPU
+ * */
+struct hash_table_bulk_options
+{
+    // one of `enum hash_table_bulk_format`
+    int format;
+    // worker threads, 0 for the number of online CPUs
+    int threads;
+};
+
+typedef struct hash_table_bulk_options BulkLoadOptions;
+
+/**
+ * @brief builds a table holding every record of a file
+ * @param constchar* file to read
+ * @param constTableConfig* options of the new table, NULL for defaults;
+ * `capacity` is replaced by the record count, `borrowed_keys` is not
+ * allowed since the file is unmapped when the load ends and an eviction
+ * policy is not allowed since records are placed past the cache budgets
+ * @param constBulkLoadOptions* format and threads, NULL for defaults
+ * @return Table* the table, NULL when the file cannot be read, a length
+ * prefixed record runs past its end or the config is rejected
+ * */
+Table *ht_bulk_load(const char *, const TableConfig *, const BulkLoadOptions *);
+
+#endif // BULK_LOAD_H
@@ -0,0 +1,107 @@
+#ifndef CONCURRENT_TABLE_H
+#define CONCURRENT_TABLE_H
+
+/**
+ * @brief  Thread-safe hash table split into independently locked shards.
+ * @details A key is hashed once; the high bits of the hash pick the shard
+ *  and the whole hash is handed to the shard's `Table`, which uses the low
+ *  bits for its own probing. Every shard resizes on its own, so a resize
+ *  only blocks the keys of one shard.
+ *  */
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "hash-table.h"
+
+#define CT_CACHE_LINE 64
+
+/**
+ * @brief Lock protecting each shard
+ * */
+enum concurrent_table_lock_kind
+{
+    // pthread reader-writer lock, readers of a shard run in parallel
+    CT_LOCK_RWLOCK = 0,
+    // test-and-test-and-set spinlock, cheaper for short write-heavy sections
+    CT_LOCK_SPIN,
+};
+
+/**
+ * @brief Structural definition for one shard, padded to its own
+ * cache lines so neighbouring locks do not false share
+ * */
+struct concurrent_table_shard
+{
+    _Alignas(CT_CACHE_LINE) pthread_rwlock_t rwlock;
+    // spinlock word used with CT_LOCK_SPIN
+    int spin;
+    // the shard's keys
+    Table *table;
+};
+
+/**
+ * @brief Structural definition for a sharded table
+ * */
+struct concurrent_table
+{
+    // number of shards, a power of two
+    int shard_count;
+    // log2 of `shard_count`
+    int shard_bits;
+    // one of `enum concurrent_table_lock_kind`
+    int lock_kind;
+    // hash function and seed shared by every shard
+    HashFn hash;
+    uint64_t seed;
+    struct concurrent_table_shard *shards;
+};
+
+typedef struct concurrent_table ConcurrentTable;
+
+/**
+ * @brief Creates a sharded table
+ * @param int number of shards, rounded up to a power of two
+ * @param int one of `enum concurrent_table_lock_kind`
+ * @param constTableConfig* configuration of every shard, NULL for defaults
+ * @return ConcurrentTable* the table, NULL if a shard cannot be created
+ * */
+ConcurrentTable *ct_new(int, int, const TableConfig *);
+
+/**
+ * @brief inserts a copy of key/value, safe to call from any thread
+ * */
+void ct_insert(ConcurrentTable *, const char *, const char *);
+
+/**
+ * @brief inserts a copy of key/value that expires after the given
+ * milliseconds of the shard clock, safe to call from any thread. Shards
+ * of other engines than HT_ENGINE_DOUBLE_HASH store it without a TTL
+ * */
+void ct_insert_with_ttl(ConcurrentTable *, const char *, const char *, const uint64_t);
+
+/**
+ * @brief copies the value of key into the buffer (truncated and
+ * NUL-terminated to the buffer size), safe to call from any thread.
+ * Lookups take the shard write lock when they change it, in shards that
+ * resize incrementally, evict or hold TTL entries
+ * @return bool true if the key was found
+ * */
+bool ct_find(ConcurrentTable *, const char *, char *, size_t);
+
+/**
+ * @brief deletes key, safe to call from any thread
+ * */
+void ct_delete(ConcurrentTable *, const char *);
+
+/**
+ * @brief number of items over all shards, each shard is read under its lock
+ * */
+int ct_count(ConcurrentTable *);
+
+/**
+ * @brief frees the table, no other thread may use it any more
+ * */
+void delete_ConcurrentTable(ConcurrentTable *);
+
+#endif // CONCURRENT_TABLE_H
@@ -0,0 +1,94 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+/**
+ * @brief  Epoch based memory reclamation.
+ * @details Readers announce the global epoch they run in with a plain store
+ *  and a fence (no read-modify-write). Writers retire memory tagged with
+ *  the current epoch; the epoch only advances once every active reader has
+ *  caught up, so memory retired in epoch e is freed once the global epoch
+ *  reaches e + 2 and no reader can still hold it.
+ *  `epoch_retire`/`epoch_reclaim` are writer side and must be serialized
+ *  by the caller.
+ *  */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define EPOCH_MAX_READERS 128
+#define EPOCH_CACHE_LINE 64
+// retired blocks kept before a retire tries to reclaim
+#define EPOCH_RECLAIM_BATCH 64
+
+/**
+ * @brief Structural definition for one registered reader, on its own cache line
+ * */
+struct epoch_reader
+{
+    // epoch the reader runs in, 0 while it is outside a read section
+    _Alignas(EPOCH_CACHE_LINE) _Atomic uint64_t epoch;
+    // set while a thread owns this record
+    atomic_int in_use;
+};
+
+typedef struct epoch_reader EpochReader;
+
+struct epoch_retired;
+
+/**
+ * @brief Structural definition for a reclamation domain
+ * */
+struct epoch_domain
+{
+    // global epoch, starts at 1
+    _Atomic uint64_t global;
+    EpochReader readers[EPOCH_MAX_READERS];
+    // retired blocks waiting for readers to move on, newest first
+    struct epoch_retired *retired;
+    size_t retired_count;
+};
+
+typedef struct epoch_domain EpochDomain;
+
+/**
+ * @brief prepares an empty domain
+ * */
+void epoch_init(EpochDomain *);
+
+/**
+ * @brief claims a reader record for the calling thread
+ * @return EpochReader* the record, NULL when EPOCH_MAX_READERS are in use
+ * */
+EpochReader *epoch_register(EpochDomain *);
+
+/**
+ * @brief gives a reader record back, the reader must be outside a read section
+ * */
+void epoch_unregister(EpochReader *);
+
+/**
+ * @brief enters a read section: memory reachable now is not freed before `epoch_exit`
+ * */
+void epoch_enter(EpochDomain *, EpochReader *);
+
+/**
+ * @brief leaves a read section
+ * */
+void epoch_exit(EpochReader *);
+
+/**
+ * @brief frees `ptr` with `free_fn` once no reader can still see it
+ * */
+void epoch_retire(EpochDomain *, void *, void (*)(void *));
+
+/**
+ * @brief advances the epoch when every reader caught up and frees what is safe
+ * */
+void epoch_reclaim(EpochDomain *);
+
+/**
+ * @brief frees everything still retired, no reader may be active
+ * */
+void epoch_destroy(EpochDomain *);
+
+#endif // EPOCH_H
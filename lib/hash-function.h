@@ -0,0 +1,38 @@
+#ifndef HASH_FUNCTION_H
+#define HASH_FUNCTION_H
+
+/**
+ * @brief  Key hash functions used by the hash table.
+ * @details Every function hashes `len` bytes at `key` into a 64-bit value.
+ *  The table derives every probe parameter from that single value.
+ *  */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief signature shared by every key hash function
+ * @param constvoid* key bytes to hash
+ * @param size_t number of bytes in the key
+ * @param uint64_t seed mixed into the hash state
+ * */
+typedef uint64_t (*HashFn)(const void *, size_t, uint64_t);
+
+/**
+ * @brief wyhash style hash, the default for every table.
+ * Reads the key 4/8 bytes at a time and folds with 64x64->128 multiplies.
+ * */
+uint64_t ht_hash_wy(const void *, size_t, uint64_t);
+
+/**
+ * @brief FNV-1a hash, one byte per round. Kept as a simple baseline
+ * to compare the default against.
+ * */
+uint64_t ht_hash_fnv1a(const void *, size_t, uint64_t);
+
+/**
+ * @brief returns a random seed for tables created with a seeded hash
+ * (read from /dev/urandom, falls back to clock/address entropy).
+ * */
+uint64_t ht_random_seed(void);
+
+#endif // HASH_FUNCTION_H
@@ -9,23 +9,206 @@
  *  */
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "hash-function.h"
+#include "pages.h"
 
-#define HT_PRIME_X 2
-#define HT_PRIME_Y 3
 #define HT_INITIAL_SIZE 50
+// old buckets migrated by every operation during an incremental resize
+#define HT_REHASH_STEP 16
+// keys of a batch whose probes are interleaved, their slots and nodes are
+// prefetched together before any of them is resolved
+#define HT_BATCH_GROUP 16
+// probe length histogram buckets, the last one counts every longer probe
+#define HT_STATS_PROBE_BUCKETS 16
+// bytes of "key\0value\0" a node of the default engine stores in itself
+#define HT_ITEM_INLINE 24
+// longest key and value an item can describe
+#define HT_ITEM_MAX_KEY UINT32_MAX
+#define HT_ITEM_MAX_VALUE 0x3FFFFFFFu
+// entries a sampled LRU cache compares to pick the one it evicts
+#define HT_CACHE_SAMPLES 5
+// expiry timer wheel: levels of 2^HT_WHEEL_BITS slots, one tick per
+// millisecond, level k holds timers due 64^k to 64^(k+1) ticks ahead
+#define HT_WHEEL_BITS 6
+#define HT_WHEEL_SLOTS (1 << HT_WHEEL_BITS)
+#define HT_WHEEL_LEVELS 6
+// timers and ticks every TTL insert advances the wheel by
+#define HT_EXPIRE_STEP 16
+// expiry time of an entry inserted without a TTL
+#define HT_NEVER_EXPIRES UINT64_MAX
+// threads a resize spreads its rehash over at most, and the old slot
+// arrays too small for it to pay off
+#define HT_REHASH_MAX_THREADS 64
+#define HT_REHASH_PARALLEL_MIN (1 << 16)
+// negative lookup filter: 4-bit counters per slot of the slot array, and
+// counters a key sets, all in one 64-byte block of 128 counters
+#define HT_FILTER_COUNTERS_PER_SLOT 8
+#define HT_FILTER_HASHES 4
 
 
 /**
- * @brief Structural definition for a hash table node
+ * @brief Structural definition for a hash table node. Short entries of
+ * the default engine keep "key\0value\0" in the node itself, read them
+ * through `ht_item_key` and `ht_item_value`.
  * */
 struct hash_table_node
 {
-    char *key;  //for key storage {must be hashable}
-    char *value; // for value storage
+    union
+    {
+        struct
+        {
+            char *key;  //for key storage {must be hashable}
+            char *value; // for value storage, always followed by a NUL
+        };
+        char inline_bytes[HT_ITEM_INLINE]; // key and value when is_inline is set
+    };
+    uint64_t hash; // hash of key, computed once on insert and reused on resize
+    uint32_t key_len; // bytes in key, compared before the key bytes
+    uint32_t value_len : 30; // bytes in value, not counting the trailing NUL
+    uint32_t is_inline : 1;
+    uint32_t is_timed : 1; // the node is followed by an expiry timer
 };
 
 typedef struct hash_table_node Item;
 
+/**
+ * @brief callback run on stored items by `ht_scan` and `ht_for_each_item`
+ * */
+typedef void (*HtItemFn)(const Item *, void *);
+
+/**
+ * @brief clock TTLs are measured with, in milliseconds
+ * */
+typedef uint64_t (*HtClockFn)(void);
+
+/**
+ * @brief key bytes of an item, followed by a NUL unless the key is borrowed
+ * */
+static inline char *ht_item_key(const Item *item)
+{
+    return item->is_inline ? (char *)item->inline_bytes : item->key;
+}
+
+/**
+ * @brief value bytes of an item, always followed by a NUL
+ * */
+static inline char *ht_item_value(const Item *item)
+{
+    return item->is_inline ? (char *)item->inline_bytes + item->key_len + 1 : item->value;
+}
+
+/**
+ * @brief Storage engines a table can be created with
+ * */
+enum hash_table_engine_kind
+{
+    // array of `Item *` probed with double hashing (the original layout)
+    HT_ENGINE_DOUBLE_HASH = 0,
+    // swiss table: 7-bit tags in a control byte array, inline slots
+    HT_ENGINE_SWISS,
+    // robin hood linear probing, deletes by backward shift (no tombstones)
+    HT_ENGINE_ROBIN_HOOD,
+    // 4-way bucketized cuckoo hashing: a key sits in one of two cache line
+    // buckets, grows at 95% load, one entry per key
+    HT_ENGINE_CUCKOO,
+};
+
+/**
+ * @brief How the default engine sizes its slot array
+ * */
+enum hash_table_capacity_policy
+{
+    // prime bucket counts, double hashing with a modulo per operation
+    HT_CAPACITY_PRIME = 0,
+    // power-of-two bucket counts, mask indexing and linear probing
+    HT_CAPACITY_POW2,
+};
+
+/**
+ * @brief How a cache table picks the entry it evicts
+ * */
+enum hash_table_eviction
+{
+    // no cache, the table grows to hold every key
+    HT_EVICT_NONE = 0,
+    // a hand sweeps the slots, clearing the reference bits hits set, and
+    // evicts the first entry whose bit is already clear
+    HT_EVICT_CLOCK,
+    // the least recently used of HT_CACHE_SAMPLES entries found from a
+    // random slot, by a logical access time kept per slot
+    HT_EVICT_SAMPLED_LRU,
+};
+
+struct ht_engine;
+struct arena;
+struct intern_pool;
+struct hash_table_expiry;
+struct hash_table_filter;
+
+// CLOCK marks of a cache slot
+#define HT_CACHE_FREE 0
+#define HT_CACHE_UNREFERENCED 1
+#define HT_CACHE_REFERENCED 2
+
+/**
+ * @brief Budgets and replacement state of a table created with an
+ * eviction policy. The marks are indexed like `items` and move with
+ * the items when the slot array is rebuilt; they also tell which slots
+ * hold an entry, so choosing a victim reads nothing else.
+ * */
+struct hash_table_cache
+{
+    // one of `enum hash_table_eviction`
+    int policy;
+    // entries held at most, 0 for no limit
+    int max_entries;
+    // item nodes plus the key and value bytes stored apart from them,
+    // at most `max_bytes` of them are held (0 for no limit)
+    size_t max_bytes;
+    size_t bytes;
+    // HT_EVICT_CLOCK: HT_CACHE_FREE or the reference bit of the entry of
+    // each slot, set by hits
+    uint8_t *ref;
+    // HT_EVICT_SAMPLED_LRU: logical time of the last access to the entry
+    // of each slot, 0 for a free slot
+    uint32_t *stamp;
+    // marks of the slot array being rebuilt
+    uint8_t *old_ref;
+    uint32_t *old_stamp;
+    // logical clock advanced by every sampled LRU access
+    uint32_t clock;
+    // next slot the CLOCK hand looks at
+    int hand;
+    // deleted slots of the slot array
+    int tombstones;
+    uint64_t evictions;
+    uint64_t rng;
+    // run on every evicted item before it is freed
+    HtItemFn on_evict;
+    void *evict_ctx;
+};
+
+/**
+ * @brief Counters kept by tables when the library is built with
+ * HT_STATS, they stay zero otherwise
+ * */
+struct hash_table_counters
+{
+    // lookups by number of slots (groups for swiss tables) they examined
+    uint64_t hit_probes[HT_STATS_PROBE_BUCKETS];
+    uint64_t miss_probes[HT_STATS_PROBE_BUCKETS];
+    // slot array rebuilds and the time they took
+    uint64_t resizes;
+    uint64_t resize_total_ns;
+    uint64_t resize_max_ns;
+    // lookups of a filtered table the filter rejected, and lookups it let
+    // through that found nothing
+    uint64_t filter_rejects;
+    uint64_t filter_false_positives;
+};
+
 /**
  * @brief Structural definition for a hash table  with array of pointers 
  * to  struct hash_table_node
@@ -40,40 +223,245 @@ struct hash_table
     int count; 
     // pointers to each  an array of `Item`
     Item **items; 
+    // hash function chosen when the table was created
+    HashFn hash;
+    // seed passed to `hash` on every call
+    uint64_t seed;
+    // one of `enum hash_table_capacity_policy`
+    int capacity_policy;
+    // operations of a non default engine, NULL for HT_ENGINE_DOUBLE_HASH
+    const struct ht_engine *engine;
+    // storage owned by `engine`, `items` is unused when it is set
+    void *store;
+    // slab/bump allocator for item nodes and key/value bytes
+    struct arena *arena;
+    // resize by migrating a few buckets per operation instead of all at once
+    bool incremental_resize;
+    // slot array being migrated away from, NULL when no resize is running
+    Item **old_items;
+    // number of buckets in `old_items`
+    int old_size;
+    // next bucket of `old_items` to migrate
+    int rehash_idx;
+    // items point at the caller's key bytes instead of a copy
+    bool borrowed_keys;
+    // pool holding one copy of every distinct value, NULL unless interning
+    struct intern_pool *values;
+    // smallest base size a shrink may reach, raised by reservations
+    int min_base_size;
+    // budgets and reference marks of a cache table, NULL otherwise
+    struct hash_table_cache *cache;
+    // timer wheel of the entries inserted with a TTL, created by the first one
+    struct hash_table_expiry *expiry;
+    // milliseconds TTLs are measured in
+    HtClockFn clock;
+    // threads moving the items of a resize, 1 for the calling thread alone
+    int rehash_threads;
+    // pages backing the slot arrays and the arena chunks
+    struct page_policy pages;
+    // counting filter of the hashes of every item, NULL unless created
+    // with `lookup_filter`
+    struct hash_table_filter *filter;
+    // bumped whenever default engine items change slots, prime tables
+    // restart a scan when it moved
+    unsigned int layout_version;
+    // probe and resize counters, only updated in HT_STATS builds
+    struct hash_table_counters counters;
 };
 
 typedef struct hash_table Table;
 
+/**
+ * @brief Options fixed when a table is created. A zeroed config
+ * gives the same table as `ht_new()`.
+ * */
+struct hash_table_config
+{
+    // key hash function, NULL selects `ht_hash_wy`
+    HashFn hash;
+    // seed for `hash`, use `ht_random_seed()` for a seeded table
+    uint64_t seed;
+    // storage engine, one of `enum hash_table_engine_kind`
+    int engine;
+    // slot array sizing of the default engine, one of `enum hash_table_capacity_policy`
+    int capacity_policy;
+    // spread resizes of the default engine over later operations (redis style)
+    bool incremental_resize;
+    // store no copy of keys: the caller keeps every inserted key alive and
+    // unchanged until it is deleted or the table is freed
+    bool borrowed_keys;
+    // store each distinct value once in a reference counted pool, for
+    // tables whose values repeat; values short enough to sit in the node
+    // of a default engine item stay there
+    bool intern_values;
+    // items the table holds before it first grows, 0 for HT_INITIAL_SIZE
+    int capacity;
+    // make the table a cache that evicts entries to stay within
+    // `max_entries` and `max_bytes`, one of `enum hash_table_eviction`.
+    // Default engine only; a cache holds one entry per key, inserting a
+    // cached key replaces its value, and it resizes at once.
+    int eviction;
+    // entries a cache holds at most, 0 for no limit
+    int max_entries;
+    // bytes of item nodes and of the keys and values stored apart from
+    // them a cache holds at most, 0 for no limit
+    size_t max_bytes;
+    // run on every item a cache evicts, before it is freed; it must not
+    // change the table. May be NULL.
+    HtItemFn on_evict;
+    // passed to `on_evict` untouched
+    void *evict_ctx;
+    // milliseconds `ht_insert_with_ttl` and expiry go by, NULL for
+    // CLOCK_MONOTONIC. Entries of other engines than HT_ENGINE_DOUBLE_HASH
+    // are stored without a TTL and never expire.
+    HtClockFn clock;
+    // threads a resize of a HT_CAPACITY_POW2 table of at least
+    // HT_REHASH_PARALLEL_MIN slots moves its items with, up to
+    // HT_REHASH_MAX_THREADS; 0 or 1 rehashes on the calling thread. The
+    // slot array comes out the same either way. Not for caches or
+    // incremental resizes.
+    int rehash_threads;
+    // pages of the slot arrays and item arena of the default engine, one
+    // of `enum hash_table_page_policy`, see pages.h for the fallbacks
+    int pages;
+    // NUMA placement of those pages, one of `enum hash_table_numa_policy`
+    int numa;
+    // node HT_NUMA_BIND keeps them on
+    int numa_node;
+    // keep a counting blocked Bloom filter of the keys next to the slot
+    // array, so most lookups and deletes of absent keys end after reading
+    // one cache line of it instead of probing. Default engine only; costs
+    // HT_FILTER_COUNTERS_PER_SLOT / 2 bytes per slot.
+    bool lookup_filter;
+};
 
+typedef struct hash_table_config TableConfig;
 
-static Item HT_EMPTY_ITEM = {.key=NULL, .value=NULL};
+/**
+ * @brief Snapshot of the state of a table returned by `ht_stats`
+ * */
+struct hash_table_stats
+{
+    // live items, slots and live items per slot
+    int count;
+    int size;
+    double load_factor;
+    // deleted slots still taking part in probes
+    int tombstones;
+    // the counters below are maintained (library built with HT_STATS)
+    bool counters_enabled;
+    uint64_t hit_probes[HT_STATS_PROBE_BUCKETS];
+    uint64_t miss_probes[HT_STATS_PROBE_BUCKETS];
+    uint64_t resizes;
+    double resize_total_ms;
+    double resize_max_ms;
+    // slot arrays, items stored in them for inline engines
+    size_t slot_bytes;
+    // item nodes allocated apart from the slots
+    size_t node_bytes;
+    // key and value bytes with their NULs stored apart from the items,
+    // borrowed keys and inline entries count nothing, interned values
+    // count once per distinct value with their pool entry header
+    size_t key_bytes;
+    size_t value_bytes;
+    // bytes the table arena obtained from malloc
+    size_t arena_bytes;
+    // entries a cache table evicted to stay within its budgets
+    uint64_t evictions;
+    // entries inserted with a TTL and not reclaimed yet, expired or not
+    int expiring;
+    // entries reclaimed once expired, by `ht_find` or the timer wheel
+    uint64_t expired;
+    // counters of the lookup filter, 0 without one
+    size_t filter_bytes;
+    // chance that the filter lets an absent key through, estimated from
+    // the share of counters in use
+    double filter_fp_rate;
+    // lookups the filter rejected (they count in no probe histogram) and
+    // lookups it let through that missed, maintained with HT_STATS
+    uint64_t filter_rejects;
+    uint64_t filter_false_positives;
+};
 
-static inline Table* ht_resize(Table *, const int);
+typedef struct hash_table_stats TableStats;
 
-static inline bool ht_cell_empty(Item* item);
+/**
+ * @brief Handle on the place of one key in a table, returned by
+ * `ht_entry`. An occupied entry points at the item stored for the key, a
+ * vacant one remembers the slot its probe ended on so `ht_entry_set`
+ * stores the key there without probing again. Any other change to the
+ * table invalidates the handle.
+ * */
+struct hash_table_entry
+{
+    Table *table;
+    // item stored for the key, NULL while the entry is vacant
+    Item *item;
+    // key the entry was looked up with, the caller keeps it alive until
+    // the entry is set
+    const void *key;
+    size_t key_len;
+    uint64_t hash;
+    // free slot of the default engine a vacant entry fills, -1 when
+    // setting it takes the insert path of the engine or cache
+    int slot;
+};
 
-static inline Table* ht_resize_up(Table *);
+typedef struct hash_table_entry TableEntry;
 
-static inline Table* ht_resize_down(Table *);
 
-static inline Item *create_new_item(const char *, const char *);
+Table *ht_insert(Table *, const char *, const char *);
 
-static inline void delete_item(Item *);
+char *ht_find(Table *, const char *);
 
-static inline Table *ht_create_new_sized_table(const int);
+void ht_delete(Table *, const char *);
 
-static inline int ht_hash(const char *, const int, const int);
+Table *ht_insert_with_hash(Table *, const char *, const char *, const uint64_t);
 
-static  inline int ht_get_dhashidx(const char *, const int, const int);
+char *ht_find_with_hash(Table *, const char *, const uint64_t);
 
-Table *ht_insert(Table *, const char *, const char *);
+void ht_delete_with_hash(Table *, const char *, const uint64_t);
 
-char *ht_find(Table *, const char *);
+Table *ht_insert_bytes(Table *, const void *, const size_t, const void *, const size_t);
 
-void ht_delete(Table *, const char *);
+Table *ht_insert_with_ttl(Table *, const char *, const char *, const uint64_t);
+
+int ht_expire(Table *, int);
+
+char *ht_find_bytes(Table *, const void *, const size_t, size_t *);
+
+void ht_delete_bytes(Table *, const void *, const size_t);
+
+TableEntry ht_entry(Table *, const char *);
+
+TableEntry ht_entry_bytes(Table *, const void *, const size_t);
+
+char *ht_entry_set(TableEntry *, const void *, const size_t);
+
+Table *ht_upsert(Table *, const char *, const char *);
+
+char *ht_get_or_insert(Table *, const char *, const char *);
+
+int ht_rehash_step(Table *, int);
+
+void ht_find_batch(Table *, const char **, const int, char **);
+
+Table *ht_insert_batch(Table *, const char **, const char **, const int);
 
 Table *ht_new();
 
+Table *ht_new_with_config(const TableConfig *);
+
+Table *ht_new_with_capacity(const int);
+
+Table *ht_reserve(Table *, const int);
+
+uint64_t ht_scan(Table *, uint64_t, HtItemFn, void *, int);
+
+void ht_stats(Table *, TableStats *);
+
+void ht_stats_reset(Table *);
+
 void delete_Table(Table *);
 
 
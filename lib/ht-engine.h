@@ -0,0 +1,429 @@
+#ifndef HT_ENGINE_H
+#define HT_ENGINE_H
+
+/**
+ * @brief  Storage engine interface behind `ht_insert`/`ht_find`/`ht_delete`.
+ * @details The public functions hash the key once and hand the hash to the
+ *  engine of the table. An engine owns `table->store` and keeps
+ *  `table->size` (slot capacity) and `table->count` up to date. Key and
+ *  value bytes come from the table arena, which is created before `init`
+ *  and destroyed after `destroy`. Keys are (pointer, length) pairs and may
+ *  hold any byte, NUL included.
+ *  */
+#include <string.h>
+
+#include "hash-table.h"
+
+// code compiled only into HT_STATS builds, so the counters cost nothing otherwise
+#ifdef HT_STATS
+#define HT_STATS_ONLY(...) __VA_ARGS__
+#else
+#define HT_STATS_ONLY(...)
+#endif
+
+// adds to a lookup counter; lookups of a concurrent table share a read
+// lock, so the add is atomic, relaxed since nothing is ordered by it
+#define HT_STATS_ADD(counter, n) __atomic_fetch_add(&(counter), (uint64_t)(n), __ATOMIC_RELAXED)
+
+/**
+ * @brief items collected by one `ht_scan` call, copied so callbacks
+ * may change the table while the batch is delivered
+ * */
+struct ht_scan_batch
+{
+    Item *items;
+    size_t count;
+    size_t capacity;
+};
+
+/**
+ * @brief Operations every alternative storage engine provides
+ * */
+struct ht_engine
+{
+    // allocates `table->store` with room for at least the given number of items
+    void (*init)(Table *, const int);
+    // frees the store, item strings go away with the table arena
+    void (*destroy)(Table *);
+    // stores key/value under the given hash with `ht_store_item_strings`, growing when needed
+    void (*insert)(Table *, const void *, const size_t, const void *, const size_t, const uint64_t);
+    // returns the item stored for key or NULL
+    Item *(*find)(Table *, const void *, const size_t, const uint64_t);
+    // removes every item stored under key
+    void (*remove)(Table *, const void *, const size_t, const uint64_t);
+    // calls the callback on every stored item, in slot order
+    void (*each)(Table *, HtItemFn, void *);
+    // grows the store so the given number of items fit without growing again
+    void (*reserve)(Table *, const int);
+    // fills the tombstones and slot bytes of the store
+    void (*stats)(Table *, TableStats *);
+    // collects the items of the home buckets from the cursor on, until
+    // about `budget` slots are examined, and returns the next cursor
+    uint64_t (*scan)(Table *, uint64_t, struct ht_scan_batch *, int);
+};
+
+/**
+ * @brief checks an item against a key, the cached hash and the length
+ * reject almost every mismatch before the bytes are compared
+ * */
+static inline bool ht_item_matches(const Item *item, const void *key, const size_t key_len, const uint64_t hash)
+{
+    return item->hash == hash && item->key_len == key_len && memcmp(ht_item_key(item), key, key_len) == 0;
+}
+
+/**
+ * @brief whether a slot of the default engine holds an item. Slot
+ * arrays hold NULL for free slots and the empty item of src/hash-table.c
+ * for tombstones, the only item with neither key nor inline bytes.
+ * */
+static inline bool ht_item_live(const Item *item)
+{
+    return item != NULL && (item->is_inline || item->key != NULL);
+}
+
+/**
+ * @brief copies key and value into one block of the table arena
+ * and points the item at it, borrowed-key tables copy the value only.
+ * Default engine items keep short entries inline instead.
+ * */
+void ht_store_item_strings(Table *, Item *, const void *, const size_t, const void *, const size_t);
+
+/**
+ * @brief gives the key/value block of an item back to the table arena
+ * */
+void ht_release_item_strings(Table *, Item *);
+
+/**
+ * @brief calls a callback on every item of a table, whatever its engine
+ * */
+void ht_for_each_item(Table *, HtItemFn, void *);
+
+static inline uint64_t ht_bit_reverse64(uint64_t v)
+{
+    v = __builtin_bswap64(v);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((v & 0x0F0F0F0F0F0F0F0Full) << 4);
+    v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+    return ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+}
+
+/**
+ * @brief reverse binary increment of a scan cursor over `mask + 1` home
+ * buckets: the high bits of the bucket index count up first, so buckets
+ * that split or merge when the bucket count doubles or halves are
+ * visited next to each other and a resize between calls skips nothing
+ * */
+static inline uint64_t ht_scan_next(uint64_t cursor, const uint64_t mask)
+{
+    cursor |= ~mask;
+    return ht_bit_reverse64(ht_bit_reverse64(cursor) + 1);
+}
+
+/**
+ * @brief adds a copy of an item to a scan batch
+ * */
+void ht_scan_push(struct ht_scan_batch *, const Item *);
+
+/**
+ * @brief monotonic clock in nanoseconds for the resize counters
+ * */
+uint64_t ht_stats_clock(void);
+
+/**
+ * @brief adds a resize that started at the given clock value to the counters
+ * */
+void ht_stats_record_resize(Table *, const uint64_t);
+
+/**
+ * @brief adds a lookup of the given probe length to the hit or miss histogram
+ * */
+void ht_stats_record_probe(Table *, const bool, const int);
+
+/**
+ * @brief first bucket of the probe sequence of a hash, default engine only
+ * */
+int ht_home_slot(const Table *, const uint64_t);
+
+/**
+ * @brief places an item of a default engine table only if its probe finds
+ * a free bucket within [lo, hi), so threads can fill disjoint ranges
+ * */
+bool ht_place_item_in_range(Table *, Item *, const int, const int);
+
+/**
+ * @brief places an item of a default engine table without growing it
+ * */
+void ht_place_new_item(Table *, Item *);
+
+/**
+ * @brief sets up the budgets and marks of a default engine table created
+ * with an eviction policy, once its slot array exists
+ * */
+void ht_cache_init(Table *, const TableConfig *);
+
+/**
+ * @brief frees the cache state of a table
+ * */
+void ht_cache_destroy(Table *);
+
+/**
+ * @brief gives the current marks to the slot array being rebuilt and
+ * starts clear ones for the new array, `ht_cache_move_mark` carries them
+ * */
+void ht_cache_begin_rebuild(Table *);
+
+/**
+ * @brief frees the marks of the rebuilt slot array, it holds no tombstones
+ * */
+void ht_cache_end_rebuild(Table *);
+
+/**
+ * @brief bytes an item counts against the byte budget of a cache
+ * */
+size_t ht_cache_item_bytes(const Table *, const Item *);
+
+/**
+ * @brief slot of the entry a cache table holding entries evicts next
+ * */
+int ht_cache_victim(Table *);
+
+/**
+ * @brief accounts for an item just placed in the given slot, as not
+ * referenced yet for CLOCK and as just used for sampled LRU
+ * */
+void ht_cache_admit(Table *, const Item *, const int);
+
+/**
+ * @brief accounts for an item about to be deleted from the given slot
+ * */
+void ht_cache_forget(Table *, const Item *, const int);
+
+/**
+ * @brief next sampled LRU access time, 0 stays the mark of a free slot
+ * */
+static inline uint32_t ht_cache_tick(struct hash_table_cache *cache)
+{
+    if (++cache->clock == 0)
+        cache->clock = 1;
+    return cache->clock;
+}
+
+/**
+ * @brief records a hit on the item of a slot, a byte or word store in the
+ * marks array and nothing else
+ * */
+static inline void ht_cache_touch(struct hash_table_cache *cache, const int idx)
+{
+    if (cache->ref != NULL)
+    {
+        // keep the line clean when the bit is already set
+        if (cache->ref[idx] != HT_CACHE_REFERENCED)
+            cache->ref[idx] = HT_CACHE_REFERENCED;
+        return;
+    }
+    cache->stamp[idx] = ht_cache_tick(cache);
+}
+
+/**
+ * @brief carries the mark of an item moved from an old slot to a new one
+ * */
+static inline void ht_cache_move_mark(struct hash_table_cache *cache, const int from, const int to)
+{
+    if (cache->ref != NULL)
+        cache->ref[to] = cache->old_ref[from];
+    else
+        cache->stamp[to] = cache->old_stamp[from];
+}
+
+/**
+ * @brief link of an entry with a TTL in a slot list of the timer wheel
+ * */
+struct ht_timer
+{
+    // clock value from which the entry is gone
+    uint64_t expires;
+    struct ht_timer *next;
+    // the `next` or list head pointing at this timer, NULL when unlinked
+    struct ht_timer **pprev;
+};
+
+/**
+ * @brief node of a default engine entry inserted with a TTL, allocated
+ * in one block so the timer costs no allocation of its own
+ * */
+struct ht_timed_item
+{
+    Item item;
+    struct ht_timer timer;
+};
+
+/**
+ * @brief hierarchical timer wheel of a table's entries with a TTL
+ * */
+struct hash_table_expiry
+{
+    // level k, slot s lists timers due 64^k to 64^(k+1) ticks after
+    // `now`, by bits [6k, 6k+6) of their expiry
+    struct ht_timer *wheel[HT_WHEEL_LEVELS][HT_WHEEL_SLOTS];
+    // slots that may be non empty, per level
+    uint64_t occupied[HT_WHEEL_LEVELS];
+    // timers of a slot cascaded by the last tick, per level, waiting to
+    // be expired or placed on a lower level
+    struct ht_timer *pending[HT_WHEEL_LEVELS];
+    // last tick the wheel expired timers for
+    uint64_t now;
+    // entries with a TTL in the table, and entries reclaimed once expired
+    int timed;
+    uint64_t expired;
+};
+
+static inline struct ht_timed_item *ht_timed_item_of(const Item *item)
+{
+    return (struct ht_timed_item *)item;
+}
+
+/**
+ * @brief the item was inserted with a TTL that has run out
+ * */
+static inline bool ht_item_expired(const Table *table, const Item *item)
+{
+    return item->is_timed && ht_timed_item_of(item)->timer.expires <= table->clock();
+}
+
+/**
+ * @brief CLOCK_MONOTONIC in milliseconds, the default clock of TTLs
+ * */
+uint64_t ht_clock_ms(void);
+
+/**
+ * @brief creates the timer wheel of a table, its first tick is now
+ * */
+void ht_expiry_init(Table *);
+
+/**
+ * @brief frees the wheel, the timers live in the nodes
+ * */
+void ht_expiry_destroy(Table *);
+
+/**
+ * @brief puts the timer of a new timed item on the wheel
+ * */
+void ht_timer_add(struct hash_table_expiry *, struct ht_timer *);
+
+/**
+ * @brief takes a timer off the wheel, nothing for an unlinked one
+ * */
+static inline void ht_timer_unlink(struct ht_timer *timer)
+{
+    if (timer->pprev == NULL)
+        return;
+    *timer->pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = timer->pprev;
+    timer->pprev = NULL;
+}
+
+/**
+ * @brief ticks the wheel towards the given clock value, reclaiming the
+ * entries it finds expired, until the budget of timers plus ticks is spent
+ * @return int entries reclaimed
+ * */
+int ht_expiry_advance(Table *, const uint64_t, int);
+
+/**
+ * @brief deletes one item of a default engine table, found by address
+ * */
+void ht_remove_item(Table *, Item *);
+
+/**
+ * @brief counting blocked Bloom filter of a table's item hashes: a hash
+ * picks one 64-byte block and HT_FILTER_HASHES 4-bit counters in it.
+ * Counters stop at 15 and saturated ones are never decremented, so a
+ * removal can only leave extra false positives, never a false negative.
+ * */
+struct hash_table_filter
+{
+    // 8 words of 16 counters per block
+    uint64_t *words;
+    uint64_t blocks;
+};
+
+/**
+ * @brief first word of the block of a hash
+ * */
+static inline uint64_t *ht_filter_block(const struct hash_table_filter *filter, const uint64_t hash)
+{
+    // the high half of a remix of the whole hash scaled to the block
+    // count: the top bits of the hash pick the shard of a concurrent
+    // table and the low bits the home slot. The multiplier differs from
+    // the one of the counters, so their bits stay independent.
+    return filter->words + ((((hash * 0xC2B2AE3D27D4EB4Full) >> 32) * filter->blocks) >> 32) * 8;
+}
+
+/**
+ * @brief counter `n` of a hash within its block, 7 bits of the hash
+ * remixed so they do not repeat the bits that picked the block
+ * */
+static inline unsigned ht_filter_counter(const uint64_t hash, const int n)
+{
+    return (unsigned)((hash * 0x9E3779B97F4A7C15ull) >> (57 - 7 * n)) & 127u;
+}
+
+/**
+ * @brief false when no item of the table has the hash, true when one
+ * may have it. Reads one cache line.
+ * */
+static inline bool ht_filter_may_contain(const struct hash_table_filter *filter, const uint64_t hash)
+{
+    const uint64_t *block = ht_filter_block(filter, hash);
+    for (int n = 0; n < HT_FILTER_HASHES; n++)
+    {
+        const unsigned c = ht_filter_counter(hash, n);
+        if (((block[c >> 4] >> ((c & 15) * 4)) & 15) == 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief sizes the filter of a table for its current slot array and
+ * counts every item of `items` and `old_items` in it, creating the
+ * filter on the first call
+ * */
+void ht_filter_rebuild(Table *);
+
+/**
+ * @brief frees the filter of a table
+ * */
+void ht_filter_destroy(Table *);
+
+/**
+ * @brief counts a hash in the filter
+ * */
+void ht_filter_add(struct hash_table_filter *, const uint64_t);
+
+/**
+ * @brief takes back a hash `ht_filter_add` counted
+ * */
+void ht_filter_remove(struct hash_table_filter *, const uint64_t);
+
+/**
+ * @brief fills the filter bytes and estimated false positive rate
+ * */
+void ht_filter_stats(const struct hash_table_filter *, TableStats *);
+
+/**
+ * @brief moves every item of the old slot array of a HT_CAPACITY_POW2
+ * table being resized with `rehash_threads` threads, leaving the layout
+ * a serial `ht_rehash_step` would and the old array to free
+ * */
+void ht_rehash_parallel(Table *);
+
+extern const struct ht_engine HT_SWISS_ENGINE;
+
+extern const struct ht_engine HT_ROBIN_HOOD_ENGINE;
+
+extern const struct ht_engine HT_CUCKOO_ENGINE;
+
+extern const struct ht_engine HT_MMAP_ENGINE;
+
+#endif // HT_ENGINE_H
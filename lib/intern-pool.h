@@ -0,0 +1,79 @@
+#ifndef INTERN_POOL_H
+#define INTERN_POOL_H
+
+/**
+ * @brief  Reference counted pool of byte strings stored once.
+ * @details Every distinct string is kept in one entry of an arena with
+ *  its hash, length and reference count. An open addressing index of
+ *  entry pointers (linear probing over a power of two array, deletes by
+ *  backward shift) finds the entry of a string. `intern_acquire` returns
+ *  the bytes of the entry, adding a reference, and `intern_release`
+ *  drops one; the entry goes back to the arena with its last reference.
+ *  A pool is not thread safe, it belongs to one table.
+ *  */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash-function.h"
+
+#define INTERN_INITIAL_SLOTS 64
+
+struct arena;
+struct intern_entry;
+
+/**
+ * @brief Structural definition for an intern pool
+ * */
+struct intern_pool
+{
+    // entry of each slot or NULL, a power of two of them
+    struct intern_entry **slots;
+    size_t mask;
+    // distinct strings held
+    size_t count;
+    // bytes of the entries held, headers included
+    size_t bytes;
+    // arena the entries are allocated from, owned by the caller
+    struct arena *arena;
+    HashFn hash;
+    uint64_t seed;
+};
+
+typedef struct intern_pool InternPool;
+
+/**
+ * @brief creates an empty pool
+ * @param Arena* arena entries are allocated from, it must outlive the pool
+ * @param HashFn hash of the strings
+ * @param uint64_t seed passed to the hash
+ * */
+InternPool *intern_pool_new(struct arena *, HashFn, uint64_t);
+
+/**
+ * @brief returns the pooled copy of a string, adding a reference
+ * @param InternPool* pool to look in
+ * @param constvoid* first byte of the string
+ * @param size_t bytes in the string
+ * @return char* pooled bytes followed by a NUL, valid until the last
+ * reference is released
+ * */
+char *intern_acquire(InternPool *, const void *, size_t);
+
+/**
+ * @brief drops a reference taken by `intern_acquire`
+ * @param InternPool* pool the string came from
+ * @param constchar* pointer returned by `intern_acquire`
+ * */
+void intern_release(InternPool *, const char *);
+
+/**
+ * @brief references held on a pooled string
+ * */
+uint32_t intern_refs(const char *);
+
+/**
+ * @brief frees the index, entries stay in the arena until it is destroyed
+ * */
+void intern_pool_destroy(InternPool *);
+
+#endif // INTERN_POOL_H
@@ -0,0 +1,93 @@
+#ifndef LOCKFREE_TABLE_H
+#define LOCKFREE_TABLE_H
+
+/**
+ * @brief  Hash table with lock-free readers.
+ * @details Lookups take no lock and perform no atomic read-modify-write:
+ *  they load the slot array and the slots with acquire loads inside an
+ *  epoch read section. Writers are serialized by a mutex and publish new
+ *  nodes, tombstones and resized slot arrays with release stores.
+ *  Replaced nodes and old arrays are freed through epoch reclamation
+ *  once no reader can still see them.
+ *  */
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "hash-function.h"
+#include "epoch.h"
+
+struct lf_array;
+
+/**
+ * @brief Structural definition for a lock-free read table
+ * */
+struct lockfree_table
+{
+    // current slot array, swapped as a whole on resize
+    _Atomic(struct lf_array *) array;
+    // serializes writers
+    pthread_mutex_t write_lock;
+    HashFn hash;
+    uint64_t seed;
+    // live keys and tombstones of the current array, writer side only
+    size_t count;
+    size_t tombstones;
+    // reclamation of nodes and arrays readers may still hold
+    EpochDomain epoch;
+};
+
+typedef struct lockfree_table LockFreeTable;
+
+typedef EpochReader LfReader;
+
+/**
+ * @brief Creates an empty table
+ * @param HashFn key hash function, NULL for `ht_hash_wy`
+ * @param uint64_t seed for the hash function
+ * */
+LockFreeTable *lf_new(HashFn, uint64_t);
+
+/**
+ * @brief registers the calling thread as a reader
+ * @return LfReader* the reader, NULL when too many readers are registered
+ * */
+LfReader *lf_register_reader(LockFreeTable *);
+
+/**
+ * @brief unregisters a reader that is outside a read section
+ * */
+void lf_unregister_reader(LfReader *);
+
+/**
+ * @brief enters a read section, values returned by `lf_find` stay valid until `lf_read_unlock`
+ * */
+void lf_read_lock(LockFreeTable *, LfReader *);
+
+/**
+ * @brief leaves a read section
+ * */
+void lf_read_unlock(LfReader *);
+
+/**
+ * @brief Finds a key, must be called inside a read section
+ * @return constchar* the value or NULL
+ * */
+const char *lf_find(LockFreeTable *, const char *);
+
+/**
+ * @brief inserts key/value, replacing the value of an existing key
+ * */
+void lf_insert(LockFreeTable *, const char *, const char *);
+
+/**
+ * @brief deletes key
+ * */
+void lf_delete(LockFreeTable *, const char *);
+
+/**
+ * @brief frees the table, no reader or writer may use it any more
+ * */
+void delete_LockFreeTable(LockFreeTable *);
+
+#endif // LOCKFREE_TABLE_H
@@ -0,0 +1,86 @@
+#ifndef PAGES_H
+#define PAGES_H
+
+/**
+ * @brief  Page level backing for large table allocations.
+ * @details Slot arrays and arena chunks of a table created with a page or
+ *  NUMA policy are mapped with `mmap` instead of coming from malloc, in
+ *  whole HT_HUGE_PAGE_SIZE units aligned to one, so random probes miss
+ *  the TLB far less. HT_PAGES_HUGETLB asks for reserved hugetlbfs pages
+ *  and falls back to transparent huge pages when none are free;
+ *  HT_PAGES_TRANSPARENT asks the kernel to back the mapping with
+ *  transparent huge pages (MADV_HUGEPAGE), which it does when they are
+ *  enabled and memory is not too fragmented, and with 4 KB pages
+ *  otherwise. A NUMA policy is applied with `mbind` before the first
+ *  touch and ignored where the kernel has no NUMA support.
+ *  Blocks below HT_HUGE_PAGE_SIZE stay on the heap whatever the policy.
+ *  */
+#include <stddef.h>
+#include <stdbool.h>
+
+// huge page size on x86-64 and arm64 with 4 KB base pages
+#define HT_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * @brief Pages backing slot arrays and arena chunks
+ * */
+enum hash_table_page_policy
+{
+    // malloc, whatever pages the heap uses
+    HT_PAGES_DEFAULT = 0,
+    // anonymous mapping advised with MADV_HUGEPAGE
+    HT_PAGES_TRANSPARENT,
+    // MAP_HUGETLB from the reserved pool, HT_PAGES_TRANSPARENT without one
+    HT_PAGES_HUGETLB,
+};
+
+/**
+ * @brief NUMA placement of the pages of a mapping
+ * */
+enum hash_table_numa_policy
+{
+    // first touch, the node of the thread writing a page first
+    HT_NUMA_DEFAULT = 0,
+    // pages spread round robin over every online node
+    HT_NUMA_INTERLEAVE,
+    // pages on one node only
+    HT_NUMA_BIND,
+};
+
+/**
+ * @brief page and NUMA policy of the large allocations of a table
+ * */
+struct page_policy
+{
+    // one of `enum hash_table_page_policy`
+    int pages;
+    // one of `enum hash_table_numa_policy`
+    int numa;
+    // node HT_NUMA_BIND places pages on
+    int node;
+};
+
+/**
+ * @brief whether a block of the given size is mapped under a policy
+ * rather than taken from the heap
+ * @param conststructpage_policy* policy, NULL for the heap
+ * @param size_t bytes of the block
+ * */
+bool pages_mapped(const struct page_policy *, size_t);
+
+/**
+ * @brief returns a zeroed block, exits when no memory is left
+ * @param conststructpage_policy* policy, NULL for the heap
+ * @param size_t bytes of the block
+ * */
+void *pages_alloc(const struct page_policy *, size_t);
+
+/**
+ * @brief frees a block of `pages_alloc` under the same policy and size
+ * @param conststructpage_policy* policy the block was allocated under
+ * @param void* block, may be NULL
+ * @param size_t bytes passed to `pages_alloc`
+ * */
+void pages_free(const struct page_policy *, void *, size_t);
+
+#endif // PAGES_H
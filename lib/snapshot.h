@@ -0,0 +1,100 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/**
+ * @brief  On-disk table images that are mapped instead of rebuilt.
+ * @details `ht_save` writes a header, a power-of-two array of fixed size
+ *  slots and the key/value bytes. Slots refer to their bytes by file
+ *  offset, so the image is position independent and `ht_open_mmap` uses
+ *  the mapped pages as they are: no parsing and no per item allocation,
+ *  and processes mapping the same file share one copy in the page cache.
+ *  Images are little endian and only readable by the version that wrote
+ *  them. Tables with a hash function other than `ht_hash_wy` or
+ *  `ht_hash_fnv1a` cannot be saved, the image has to name its hash.
+ *  */
+#include <stdint.h>
+
+#include "hash-table.h"
+
+#define HT_SNAPSHOT_MAGIC "DEVONHT"
+#define HT_SNAPSHOT_VERSION 1
+
+/**
+ * @brief Flags of `ht_open_mmap`
+ * */
+enum hash_table_snapshot_flags
+{
+    // lookups only, inserts and deletes are ignored
+    HT_MMAP_READ_ONLY = 0,
+    // private mapping: writes copy the touched pages, the file never changes
+    HT_MMAP_COPY_ON_WRITE = 1,
+    // check the payload checksum, which reads every page of the image.
+    // Without it lookups still keep slots of the image inside the mapping,
+    // but a copy-on-write table takes slots pointing past the image for
+    // keys inserted since, so unverified copy-on-write images are trusted
+    HT_MMAP_VERIFY = 2,
+};
+
+/**
+ * @brief first bytes of an image
+ * */
+struct ht_snapshot_header
+{
+    // HT_SNAPSHOT_MAGIC with its NUL
+    char magic[8];
+    uint32_t version;
+    // one of `enum hash_table_snapshot_hash`
+    uint32_t hash_id;
+    uint64_t seed;
+    // number of slots, a power of two
+    uint64_t slots;
+    // number of items
+    uint64_t count;
+    // bytes of key/value data after the slots
+    uint64_t data_bytes;
+    // checksum of the slots and the key/value data
+    uint64_t payload_checksum;
+    // checksum of every field above
+    uint64_t header_checksum;
+};
+
+/**
+ * @brief Hash functions an image can name
+ * */
+enum hash_table_snapshot_hash
+{
+    HT_SNAPSHOT_HASH_WY = 1,
+    HT_SNAPSHOT_HASH_FNV1A,
+};
+
+/**
+ * @brief one slot of an image, probed linearly from `hash & (slots - 1)`
+ * */
+struct ht_snapshot_slot
+{
+    uint64_t hash;
+    // file offset of "key\0value\0", 0 for an empty slot
+    uint64_t offset;
+    uint32_t key_len;
+    uint32_t value_len;
+};
+
+/**
+ * @brief writes an image of a table, whatever its engine
+ * @param Table* table to save, left unchanged
+ * @param constchar* file to create or replace
+ * @return int 0 on success, -1 when the file cannot be written, the hash
+ * function cannot be named or a key or value is 4 GB or more
+ * */
+int ht_save(Table *, const char *);
+
+/**
+ * @brief maps an image written by `ht_save` as a table
+ * @param constchar* image to map
+ * @param constint `enum hash_table_snapshot_flags` or-ed together
+ * @return Table* the table, free it with `delete_Table`; NULL when the
+ * file cannot be mapped or is not a valid image
+ * */
+Table *ht_open_mmap(const char *, const int);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,251 @@
+#ifndef TYPED_TABLE_H
+#define TYPED_TABLE_H
+
+/**
+ * @brief  Typed tables for fixed-size keys and values.
+ * @details `HT_TYPED_TABLE(name, K, V, hash, eq)` generates a table type
+ *  `name` and static inline functions `name_new`, `name_free`,
+ *  `name_insert`, `name_find`, `name_remove`, `name_reserve` and
+ *  `name_each`. Keys and values are copied by value into the slots, so
+ *  both must be trivially copyable; nothing is allocated per entry and a
+ *  lookup reads one control byte and one slot per probe.
+ *  Slots are probed linearly in a power of two array. Each slot has a
+ *  control byte holding the low 7 bits of the hash of its key, so most
+ *  slots of a probe are skipped without reading their key. Deletes leave
+ *  tombstones that are dropped when the table grows.
+ *
+ *  `hash` is called as `uint64_t hash(const K key)` and `eq` as
+ *  `bool eq(const K a, const K b)`; `ht_typed_hash_u64` and
+ *  `ht_typed_eq_scalar` cover integer keys. The string keyed `Table` keeps
+ *  its own implementation, it stores keys of any length out of line.
+ *  */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash-function.h"
+
+/**
+ * Control byte values. A full slot stores the low 7 bits of its hash,
+ * so every special value has the top bit set.
+ * */
+#define HT_TYPED_EMPTY ((uint8_t)0x80)
+#define HT_TYPED_DELETED ((uint8_t)0xFE)
+#define HT_TYPED_MIN_CAPACITY 16
+
+/**
+ * @brief hash of a 64-bit integer key, the murmur3 finalizer. Every input
+ * bit reaches every output bit, so sequential IDs spread over the table.
+ * */
+static inline uint64_t ht_typed_hash_u64(const uint64_t key)
+{
+    uint64_t h = key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * @brief equality of keys that compare with ==
+ * */
+#define ht_typed_eq_scalar(a, b) ((a) == (b))
+
+/**
+ * @brief hash and equality of struct keys by their bytes, for keys
+ * without padding
+ * */
+#define ht_typed_hash_bytes(key) ht_hash_wy(&(key), sizeof(key), 0)
+#define ht_typed_eq_bytes(a, b) (memcmp(&(a), &(b), sizeof(a)) == 0)
+
+#define HT_TYPED_TABLE(name, K, V, hash, eq)                                                     \
+    struct name##_slot                                                                           \
+    {                                                                                            \
+        K key;                                                                                   \
+        V value;                                                                                 \
+    };                                                                                           \
+                                                                                                 \
+    typedef struct name                                                                          \
+    {                                                                                            \
+        /* control bytes, one per slot */                                                        \
+        uint8_t *ctrl;                                                                           \
+        /* keys and values, slot i is described by ctrl[i] */                                    \
+        struct name##_slot *slots;                                                               \
+        /* slots - 1, the number of slots is a power of two */                                   \
+        size_t mask;                                                                             \
+        /* live entries */                                                                       \
+        size_t count;                                                                            \
+        /* inserts into empty slots left before the table grows */                               \
+        size_t growth_left;                                                                      \
+    } name;                                                                                      \
+                                                                                                 \
+    static inline void name##_alloc(name *table, const size_t capacity)                          \
+    {                                                                                            \
+        table->ctrl = malloc(capacity);                                                          \
+        table->slots = malloc(capacity * sizeof(struct name##_slot));                            \
+        if (table->ctrl == NULL || table->slots == NULL)                                         \
+            exit(EXIT_FAILURE);                                                                  \
+        memset(table->ctrl, HT_TYPED_EMPTY, capacity);                                           \
+        table->mask = capacity - 1;                                                              \
+        table->growth_left = capacity - capacity / 8 - table->count;                             \
+    }                                                                                            \
+                                                                                                 \
+    /* smallest power of two holding `entries` under the 7/8 load limit */                       \
+    static inline size_t name##_capacity_for(const size_t entries)                               \
+    {                                                                                            \
+        size_t capacity = HT_TYPED_MIN_CAPACITY;                                                 \
+        while (capacity - capacity / 8 < entries)                                                \
+            capacity <<= 1;                                                                      \
+        return capacity;                                                                         \
+    }                                                                                            \
+                                                                                                 \
+    /**                                                                                          \
+     * @brief creates a table that holds `capacity` entries without growing                    \
+     * */                                                                                        \
+    static inline name *name##_new(const size_t capacity)                                        \
+    {                                                                                            \
+        name *table = malloc(sizeof(name));                                                      \
+        if (table == NULL)                                                                       \
+            exit(EXIT_FAILURE);                                                                  \
+        table->count = 0;                                                                        \
+        name##_alloc(table, name##_capacity_for(capacity));                                      \
+        return table;                                                                            \
+    }                                                                                            \
+                                                                                                 \
+    static inline void name##_free(name *table)                                                  \
+    {                                                                                            \
+        if (table == NULL)                                                                       \
+            return;                                                                              \
+        free(table->ctrl);                                                                       \
+        free(table->slots);                                                                      \
+        free(table);                                                                             \
+    }                                                                                            \
+                                                                                                 \
+    /* returns the slot holding key or -1, a miss ends on the first empty slot */                \
+    static inline long name##_lookup(const name *table, const K key, const uint64_t h)           \
+    {                                                                                            \
+        const uint8_t tag = (uint8_t)(h & 0x7f);                                                 \
+        for (size_t idx = (size_t)(h >> 7) & table->mask;; idx = (idx + 1) & table->mask)        \
+        {                                                                                        \
+            const uint8_t ctrl = table->ctrl[idx];                                               \
+            if (ctrl == tag && eq(table->slots[idx].key, key))                                   \
+                return (long)idx;                                                                \
+            if (ctrl == HT_TYPED_EMPTY)                                                          \
+                return -1;                                                                       \
+        }                                                                                        \
+    }                                                                                            \
+                                                                                                 \
+    /* first empty or deleted slot of the probe of h */                                         \
+    static inline size_t name##_find_free(const name *table, const uint64_t h)                   \
+    {                                                                                            \
+        size_t idx = (size_t)(h >> 7) & table->mask;                                             \
+        while (!(table->ctrl[idx] & 0x80))                                                       \
+            idx = (idx + 1) & table->mask;                                                       \
+        return idx;                                                                              \
+    }                                                                                            \
+                                                                                                 \
+    /* rebuilds the table with `capacity` slots, dropping tombstones */                          \
+    static inline void name##_rehash(name *table, const size_t capacity)                         \
+    {                                                                                            \
+        uint8_t *old_ctrl = table->ctrl;                                                         \
+        struct name##_slot *old_slots = table->slots;                                            \
+        const size_t old_capacity = table->mask + 1;                                             \
+        name##_alloc(table, capacity);                                                           \
+        for (size_t i = 0; i < old_capacity; i++)                                                \
+        {                                                                                        \
+            if (old_ctrl[i] & 0x80)                                                              \
+                continue;                                                                        \
+            const size_t idx = name##_find_free(table, hash(old_slots[i].key));                  \
+            table->ctrl[idx] = old_ctrl[i];                                                      \
+            table->slots[idx] = old_slots[i];                                                    \
+        }                                                                                        \
+        free(old_ctrl);                                                                          \
+        free(old_slots);                                                                         \
+    }                                                                                            \
+                                                                                                 \
+    /**                                                                                          \
+     * @brief grows the table so it holds `entries` entries without growing again               \
+     * */                                                                                        \
+    static inline void name##_reserve(name *table, const size_t entries)                         \
+    {                                                                                            \
+        const size_t capacity = name##_capacity_for(entries);                                    \
+        if (capacity > table->mask + 1)                                                          \
+            name##_rehash(table, capacity);                                                      \
+    }                                                                                            \
+                                                                                                 \
+    /**                                                                                          \
+     * @brief stores value under key, replacing the value of an existing key                    \
+     * @return bool true when the key was not in the table                                      \
+     * */                                                                                        \
+    static inline bool name##_insert(name *table, const K key, const V value)                    \
+    {                                                                                            \
+        const uint64_t h = hash(key);                                                            \
+        const long found = name##_lookup(table, key, h);                                         \
+        if (found >= 0)                                                                          \
+        {                                                                                        \
+            table->slots[found].value = value;                                                   \
+            return false;                                                                        \
+        }                                                                                        \
+        size_t idx = name##_find_free(table, h);                                                 \
+        if (table->ctrl[idx] == HT_TYPED_EMPTY && table->growth_left == 0)                       \
+        {                                                                                        \
+            /* grow when live entries fill half the table, else only drop tombstones */          \
+            const size_t capacity = table->mask + 1;                                             \
+            name##_rehash(table, table->count * 2 >= capacity ? capacity * 2 : capacity);        \
+            idx = name##_find_free(table, h);                                                    \
+        }                                                                                        \
+        table->growth_left -= table->ctrl[idx] == HT_TYPED_EMPTY;                                \
+        table->ctrl[idx] = (uint8_t)(h & 0x7f);                                                  \
+        table->slots[idx].key = key;                                                             \
+        table->slots[idx].value = value;                                                         \
+        table->count++;                                                                          \
+        return true;                                                                             \
+    }                                                                                            \
+                                                                                                 \
+    /**                                                                                          \
+     * @brief returns the value stored under key, NULL when key is missing.                     \
+     * The pointer stays valid until the next insert or reserve.                                \
+     * */                                                                                        \
+    static inline V *name##_find(const name *table, const K key)                                 \
+    {                                                                                            \
+        const long idx = name##_lookup(table, key, hash(key));                                   \
+        return idx < 0 ? NULL : &table->slots[idx].value;                                        \
+    }                                                                                            \
+                                                                                                 \
+    /**                                                                                          \
+     * @brief removes key, copying its value to `value` when it is not NULL                     \
+     * @return bool true when the key was in the table                                          \
+     * */                                                                                        \
+    static inline bool name##_remove(name *table, const K key, V *value)                         \
+    {                                                                                            \
+        const long idx = name##_lookup(table, key, hash(key));                                   \
+        if (idx < 0)                                                                             \
+            return false;                                                                        \
+        if (value != NULL)                                                                       \
+            *value = table->slots[idx].value;                                                    \
+        /* a slot followed by an empty one ends no probe and can be emptied */                   \
+        if (table->ctrl[(idx + 1) & table->mask] == HT_TYPED_EMPTY)                              \
+        {                                                                                        \
+            table->ctrl[idx] = HT_TYPED_EMPTY;                                                   \
+            table->growth_left++;                                                                \
+        }                                                                                        \
+        else                                                                                     \
+            table->ctrl[idx] = HT_TYPED_DELETED;                                                 \
+        table->count--;                                                                          \
+        return true;                                                                             \
+    }                                                                                            \
+                                                                                                 \
+    /**                                                                                          \
+     * @brief calls fn on every entry, in slot order                                            \
+     * */                                                                                        \
+    static inline void name##_each(name *table, void (*fn)(const K *, V *, void *), void *ctx)   \
+    {                                                                                            \
+        for (size_t i = 0; i <= table->mask; i++)                                                \
+            if (!(table->ctrl[i] & 0x80))                                                        \
+                fn(&table->slots[i].key, &table->slots[i].value, ctx);                           \
+    }
+
+#endif // TYPED_TABLE_H
@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/arena.h"
+
+/**
+ * @brief a chunk that small blocks are bump allocated from
+ * */
+struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t size;
+    // mapped under the page policy of its arena rather than malloc'd
+    bool mapped;
+    _Alignas(ARENA_ALIGN) char data[];
+};
+
+/**
+ * @brief header in front of a block too large for the size classes
+ * */
+struct arena_large
+{
+    struct arena_large *prev;
+    struct arena_large *next;
+    _Alignas(ARENA_ALIGN) char data[];
+};
+
+Arena *arena_new(void)
+{
+    Arena *arena = calloc(1, sizeof(Arena));
+    if (arena == NULL)
+        exit(EXIT_FAILURE);
+    arena->next_chunk = ARENA_FIRST_CHUNK;
+    return arena;
+}
+
+Arena *arena_new_paged(const struct page_policy *pages)
+{
+    Arena *arena = arena_new();
+    arena->pages = *pages;
+    return arena;
+}
+
+/**
+ * @brief frees a chunk the way it was allocated, chunks merged from
+ * another arena may come from the heap
+ * */
+static void arena_free_chunk(const Arena *arena, struct arena_chunk *chunk)
+{
+    if (chunk->mapped)
+        pages_free(&arena->pages, chunk, sizeof(struct arena_chunk) + chunk->size);
+    else
+        free(chunk);
+}
+
+/**
+ * @brief hands what is left of the newest chunk to the free lists
+ * @param Arena* arena whose bump cursor is retired
+ * */
+static void arena_retire_cursor(Arena *arena)
+{
+    size_t left = (size_t)(arena->limit - arena->cursor);
+    while (left >= ARENA_ALIGN)
+    {
+        size_t block = left > ARENA_MAX_SMALL ? ARENA_MAX_SMALL : left;
+        void **slot = &arena->free_lists[block / ARENA_ALIGN - 1];
+        *(void **)arena->cursor = *slot;
+        *slot = arena->cursor;
+        arena->cursor += block;
+        left -= block;
+    }
+    arena->limit = arena->cursor;
+}
+
+/**
+ * @brief starts a new chunk; whatever is left of the current one is
+ * handed to the free lists so it is not lost
+ * @param Arena* arena to grow
+ * @param size_t smallest block the new chunk must fit
+ * */
+static void arena_grow(Arena *arena, size_t min_size)
+{
+    arena_retire_cursor(arena);
+    size_t size = arena->next_chunk;
+    while (size < min_size)
+        size *= 2;
+    // mapped chunks fill whole huge pages, small blocks always fit
+    const bool mapped = pages_mapped(&arena->pages, ARENA_MAX_CHUNK);
+    if (mapped)
+        size = ARENA_MAX_CHUNK - sizeof(struct arena_chunk);
+    struct arena_chunk *chunk = mapped ? pages_alloc(&arena->pages, ARENA_MAX_CHUNK) : malloc(sizeof(struct arena_chunk) + size);
+    if (chunk == NULL)
+        exit(EXIT_FAILURE);
+    chunk->size = size;
+    chunk->mapped = mapped;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->cursor = chunk->data;
+    arena->limit = chunk->data + size;
+    arena->bytes_reserved += sizeof(struct arena_chunk) + size;
+    if (arena->next_chunk < ARENA_MAX_CHUNK)
+        arena->next_chunk *= 2;
+}
+
+void *arena_alloc(Arena *arena, size_t size)
+{
+    size = arena_round(size);
+    if (size > ARENA_MAX_SMALL)
+    {
+        struct arena_large *large = malloc(sizeof(struct arena_large) + size);
+        if (large == NULL)
+            exit(EXIT_FAILURE);
+        large->prev = NULL;
+        large->next = arena->large;
+        if (arena->large != NULL)
+            arena->large->prev = large;
+        arena->large = large;
+        arena->bytes_reserved += sizeof(struct arena_large) + size;
+        arena->bytes_in_use += size;
+        return large->data;
+    }
+    arena->bytes_in_use += size;
+    void **slot = &arena->free_lists[size / ARENA_ALIGN - 1];
+    if (*slot != NULL)
+    {
+        void *block = *slot;
+        *slot = *(void **)block;
+        return block;
+    }
+    if ((size_t)(arena->limit - arena->cursor) < size)
+        arena_grow(arena, size);
+    void *block = arena->cursor;
+    arena->cursor += size;
+    return block;
+}
+
+void arena_free(Arena *arena, void *block, size_t size)
+{
+    if (block == NULL)
+        return;
+    size = arena_round(size);
+    arena->bytes_in_use -= size;
+    if (size > ARENA_MAX_SMALL)
+    {
+        struct arena_large *large = (struct arena_large *)((char *)block - offsetof(struct arena_large, data));
+        if (large->prev != NULL)
+            large->prev->next = large->next;
+        else
+            arena->large = large->next;
+        if (large->next != NULL)
+            large->next->prev = large->prev;
+        arena->bytes_reserved -= sizeof(struct arena_large) + size;
+        free(large);
+        return;
+    }
+    void **slot = &arena->free_lists[size / ARENA_ALIGN - 1];
+    *(void **)block = *slot;
+    *slot = block;
+}
+
+void arena_destroy(Arena *arena)
+{
+    struct arena_chunk *chunk = arena->chunks;
+    while (chunk != NULL)
+    {
+        struct arena_chunk *next = chunk->next;
+        arena_free_chunk(arena, chunk);
+        chunk = next;
+    }
+    struct arena_large *large = arena->large;
+    while (large != NULL)
+    {
+        struct arena_large *next = large->next;
+        free(large);
+        large = next;
+    }
+    free(arena);
+}
+
+void arena_merge(Arena *into, Arena *from)
+{
+    arena_retire_cursor(from);
+    if (from->chunks != NULL)
+    {
+        struct arena_chunk *tail = from->chunks;
+        while (tail->next != NULL)
+            tail = tail->next;
+        // the chunk `into` bumps from stays its newest one
+        if (into->chunks != NULL)
+        {
+            tail->next = into->chunks->next;
+            into->chunks->next = from->chunks;
+        }
+        else
+        {
+            into->chunks = from->chunks;
+        }
+    }
+    if (from->large != NULL)
+    {
+        struct arena_large *tail = from->large;
+        while (tail->next != NULL)
+            tail = tail->next;
+        tail->next = into->large;
+        if (into->large != NULL)
+            into->large->prev = tail;
+        into->large = from->large;
+    }
+    for (int i = 0; i < ARENA_SIZE_CLASSES; i++)
+    {
+        void **tail = &from->free_lists[i];
+        while (*tail != NULL)
+            tail = (void **)*tail;
+        *tail = into->free_lists[i];
+        into->free_lists[i] = from->free_lists[i];
+    }
+    into->bytes_reserved += from->bytes_reserved;
+    into->bytes_in_use += from->bytes_in_use;
+    free(from);
+}
@@ -0,0 +1,433 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../lib/bulk-load.h"
+#include "../lib/ht-engine.h"
+#include "../lib/arena.h"
+#include "../lib/intern-pool.h"
+
+/**
+ * @brief one parsed record, pointing into the mapped file
+ * */
+struct bulk_record
+{
+    const char *key;
+    const char *value;
+    size_t key_len;
+    size_t value_len;
+    uint64_t hash;
+};
+
+/**
+ * @brief growable array of records, reused from window to window
+ * */
+struct bulk_records
+{
+    struct bulk_record *records;
+    size_t count;
+    size_t capacity;
+};
+
+struct bulk_load;
+
+/**
+ * @brief state of one worker thread
+ * */
+struct bulk_worker
+{
+    struct bulk_load *load;
+    int id;
+    // slice of the current window this worker parses
+    const char *begin;
+    const char *end;
+    // records parsed by this worker, one array per bucket range
+    struct bulk_records *ranges;
+    // item nodes and strings placed by this worker
+    Arena *arena;
+    // items whose probe left the bucket range of this worker
+    Item **deferred;
+    size_t deferred_count;
+    size_t deferred_capacity;
+    // items placed within the range
+    size_t placed;
+};
+
+/**
+ * @brief state shared by the workers of one load
+ * */
+struct bulk_load
+{
+    Table *table;
+    int format;
+    int threads;
+    // bucket ranges, 1 when the engine is filled by one thread
+    int ranges;
+    struct bulk_worker *workers;
+};
+
+/**
+ * @brief reads the record at `*cursor` and moves the cursor past it
+ * @param int one of `enum hash_table_bulk_format`
+ * @param constchar** position in the file
+ * @param constchar* end of the file
+ * @param structbulk_record* receives the key and value
+ * @return int 1 for a record, 0 at the end, -1 for a truncated record
+ * or a value longer than HT_ITEM_MAX_VALUE
+ * */
+static int bulk_next_record(const int format, const char **cursor, const char *end, struct bulk_record *record)
+{
+    const char *p = *cursor;
+    if (format == HT_BULK_TSV)
+    {
+        // empty lines hold no record
+        while (p < end && *p == '\n')
+            p++;
+        if (p == end)
+            return 0;
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (line_end == NULL)
+            line_end = end;
+        const char *tab = memchr(p, '\t', (size_t)(line_end - p));
+        record->key = p;
+        record->key_len = (size_t)((tab != NULL ? tab : line_end) - p);
+        record->value = tab != NULL ? tab + 1 : line_end;
+        record->value_len = (size_t)(line_end - record->value);
+        *cursor = line_end < end ? line_end + 1 : end;
+        return 1;
+    }
+    if (p == end)
+        return 0;
+    uint32_t len;
+    if (end - p < 4)
+        return -1;
+    memcpy(&len, p, 4);
+    p += 4;
+    if ((size_t)(end - p) < (size_t)len + 4)
+        return -1;
+    record->key = p;
+    record->key_len = len;
+    p += len;
+    memcpy(&len, p, 4);
+    p += 4;
+    if ((size_t)(end - p) < len || len > HT_ITEM_MAX_VALUE)
+        return -1;
+    record->value = p;
+    record->value_len = len;
+    *cursor = p + len;
+    return 1;
+}
+
+/**
+ * @brief counts the records of a file and checks length prefixed ones
+ * @return long number of records, -1 for a truncated record
+ * */
+static long bulk_count(const int format, const char *begin, const char *end)
+{
+    struct bulk_record record;
+    long count = 0;
+    int read;
+    while ((read = bulk_next_record(format, &begin, end, &record)) == 1)
+        count++;
+    return read < 0 ? -1 : count;
+}
+
+/**
+ * @brief picks the next window of the file and splits it in one slice
+ * per worker, every boundary falling between two records
+ * @param structbulk_load* load whose workers receive their slices
+ * @param constchar* start of the window
+ * @param constchar* end of the file
+ * @return constchar* end of the window
+ * */
+static const char *bulk_split(struct bulk_load *load, const char *begin, const char *end)
+{
+    const size_t window = (size_t)(end - begin) < HT_BULK_WINDOW ? (size_t)(end - begin) : HT_BULK_WINDOW;
+    const size_t slice = window / (size_t)load->threads + 1;
+    const char *cursor = begin;
+    for (int i = 0; i < load->threads; i++)
+    {
+        load->workers[i].begin = cursor;
+        const char *target = begin + slice * (size_t)(i + 1) < begin + window ? begin + slice * (size_t)(i + 1) : begin + window;
+        if (load->format == HT_BULK_TSV)
+        {
+            if (target > cursor)
+            {
+                const char *line_end = memchr(target - 1, '\n', (size_t)(end - target + 1));
+                cursor = line_end != NULL ? line_end + 1 : end;
+            }
+        }
+        else
+        {
+            // records were checked by `bulk_count`, hopping cannot fail
+            struct bulk_record record;
+            while (cursor < target && bulk_next_record(load->format, &cursor, end, &record) == 1)
+                ;
+        }
+        load->workers[i].end = cursor;
+    }
+    return cursor;
+}
+
+static void bulk_push(struct bulk_records *records, const struct bulk_record *record)
+{
+    if (records->count == records->capacity)
+    {
+        records->capacity = records->capacity ? records->capacity * 2 : 4096;
+        records->records = realloc(records->records, records->capacity * sizeof(struct bulk_record));
+        if (records->records == NULL)
+            exit(EXIT_FAILURE);
+    }
+    records->records[records->count++] = *record;
+}
+
+/**
+ * @brief first bucket of the range `range` out of `ranges` equal ranges
+ * */
+static inline int bulk_range_start(const Table *table, const int range, const int ranges)
+{
+    return (int)(((int64_t)range * table->size + ranges - 1) / ranges);
+}
+
+/**
+ * @brief phase one: parses and hashes the slice of a worker and sorts
+ * the records by the bucket range their probe starts in
+ * */
+static void *bulk_parse(void *arg)
+{
+    struct bulk_worker *worker = arg;
+    const struct bulk_load *load = worker->load;
+    const Table *table = load->table;
+    struct bulk_record record;
+    const char *cursor = worker->begin;
+    while (bulk_next_record(load->format, &cursor, worker->end, &record) == 1)
+    {
+        record.hash = table->hash(record.key, record.key_len, table->seed);
+        int range = 0;
+        if (load->ranges > 1)
+            range = (int)((int64_t)ht_home_slot(table, record.hash) * load->ranges / table->size);
+        bulk_push(&worker->ranges[range], &record);
+    }
+    return NULL;
+}
+
+/**
+ * @brief copies a record into a node and one "key\0value\0" block of the
+ * worker arena, or into the node itself when it fits, the layouts
+ * `ht_release_item_strings` expects. Values of interning tables go to
+ * the pool, which only one worker fills.
+ * */
+static Item *bulk_new_item(Table *table, Arena *arena, const struct bulk_record *record)
+{
+    Item *item = arena_alloc(arena, sizeof(Item));
+    item->hash = record->hash;
+    item->key_len = (uint32_t)record->key_len;
+    item->value_len = (uint32_t)record->value_len;
+    item->is_inline = record->key_len + record->value_len + 2 <= HT_ITEM_INLINE;
+    item->is_timed = 0;
+    if (!item->is_inline && table->values != NULL)
+    {
+        item->key = arena_alloc(arena, record->key_len + 1);
+        memcpy(item->key, record->key, record->key_len);
+        item->key[record->key_len] = '\0';
+        item->value = intern_acquire(table->values, record->value, record->value_len);
+        return item;
+    }
+    char *block = item->is_inline ? item->inline_bytes : arena_alloc(arena, record->key_len + record->value_len + 2);
+    memcpy(block, record->key, record->key_len);
+    block[record->key_len] = '\0';
+    memcpy(block + record->key_len + 1, record->value, record->value_len);
+    block[record->key_len + 1 + record->value_len] = '\0';
+    if (!item->is_inline)
+    {
+        item->key = block;
+        item->value = block + record->key_len + 1;
+    }
+    return item;
+}
+
+/**
+ * @brief phase two: places the records every worker parsed for the
+ * bucket range of this worker, no other thread writes to that range
+ * */
+static void *bulk_place(void *arg)
+{
+    struct bulk_worker *worker = arg;
+    const struct bulk_load *load = worker->load;
+    Table *table = load->table;
+    const int lo = bulk_range_start(table, worker->id, load->ranges);
+    const int hi = bulk_range_start(table, worker->id + 1, load->ranges);
+    for (int w = 0; w < load->threads; w++)
+    {
+        const struct bulk_records *records = &load->workers[w].ranges[worker->id];
+        for (size_t i = 0; i < records->count; i++)
+        {
+            Item *item = bulk_new_item(table, worker->arena, &records->records[i]);
+            if (ht_place_item_in_range(table, item, lo, hi))
+            {
+                worker->placed++;
+                continue;
+            }
+            if (worker->deferred_count == worker->deferred_capacity)
+            {
+                worker->deferred_capacity = worker->deferred_capacity ? worker->deferred_capacity * 2 : 1024;
+                worker->deferred = realloc(worker->deferred, worker->deferred_capacity * sizeof(Item *));
+                if (worker->deferred == NULL)
+                    exit(EXIT_FAILURE);
+            }
+            worker->deferred[worker->deferred_count++] = item;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief runs a phase on the first `count` workers, the calling thread
+ * taking the first one
+ * */
+static void bulk_run(struct bulk_load *load, void *(*phase)(void *), const int count)
+{
+    pthread_t threads[HT_BULK_MAX_THREADS];
+    for (int i = 1; i < count; i++)
+    {
+        if (pthread_create(&threads[i], NULL, phase, &load->workers[i]) != 0)
+            exit(EXIT_FAILURE);
+    }
+    phase(&load->workers[0]);
+    for (int i = 1; i < count; i++)
+        pthread_join(threads[i], NULL);
+}
+
+/**
+ * @brief loads one window: parse in parallel, then place in parallel for
+ * the default engine or insert from the calling thread for the others
+ * */
+static void bulk_load_window(struct bulk_load *load)
+{
+    Table *table = load->table;
+    bulk_run(load, bulk_parse, load->threads);
+    if (load->ranges == 1 && table->engine != NULL)
+    {
+        for (int w = 0; w < load->threads; w++)
+        {
+            const struct bulk_records *records = &load->workers[w].ranges[0];
+            for (size_t i = 0; i < records->count; i++)
+            {
+                const struct bulk_record *record = &records->records[i];
+                table->engine->insert(table, record->key, record->key_len, record->value, record->value_len, record->hash);
+            }
+        }
+    }
+    else
+    {
+        bulk_run(load, bulk_place, load->ranges);
+        // items deferred by a worker probe into buckets other workers own
+        for (int w = 0; w < load->ranges; w++)
+        {
+            struct bulk_worker *worker = &load->workers[w];
+            for (size_t i = 0; i < worker->deferred_count; i++)
+                ht_place_new_item(table, worker->deferred[i]);
+            table->count += (int)(worker->placed + worker->deferred_count);
+            worker->placed = 0;
+            worker->deferred_count = 0;
+        }
+    }
+    for (int w = 0; w < load->threads; w++)
+    {
+        for (int r = 0; r < load->ranges; r++)
+            load->workers[w].ranges[r].count = 0;
+    }
+}
+
+Table *ht_bulk_load(const char *path, const TableConfig *config, const BulkLoadOptions *options)
+{
+    const BulkLoadOptions default_options = {0};
+    if (options == NULL)
+        options = &default_options;
+    TableConfig table_config = {0};
+    if (config != NULL)
+        table_config = *config;
+    // workers place items straight into the slots, past any cache budget
+    if (table_config.borrowed_keys || table_config.eviction != HT_EVICT_NONE)
+        return NULL;
+    if (options->format != HT_BULK_TSV && options->format != HT_BULK_LENGTH_PREFIXED)
+        return NULL;
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    const size_t length = (size_t)st.st_size;
+    if (length == 0)
+    {
+        close(fd);
+        return ht_new_with_config(&table_config);
+    }
+    const char *begin = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (begin == MAP_FAILED)
+        return NULL;
+    madvise((void *)begin, length, MADV_SEQUENTIAL);
+    const char *end = begin + length;
+
+    const long records = bulk_count(options->format, begin, end);
+    table_config.capacity = (int)records;
+    Table *table = records >= 0 && records <= INT_MAX ? ht_new_with_config(&table_config) : NULL;
+    if (table == NULL || records == 0)
+    {
+        munmap((void *)begin, length);
+        return table;
+    }
+
+    struct bulk_load load = {.table = table, .format = options->format};
+    load.threads = options->threads > 0 ? options->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (load.threads < 1)
+        load.threads = 1;
+    if (load.threads > HT_BULK_MAX_THREADS)
+        load.threads = HT_BULK_MAX_THREADS;
+    // the value pool of an interning table is filled by one thread
+    load.ranges = table->engine == NULL && table->values == NULL ? load.threads : 1;
+    load.workers = calloc((size_t)load.threads, sizeof(struct bulk_worker));
+    if (load.workers == NULL)
+        exit(EXIT_FAILURE);
+    for (int w = 0; w < load.threads; w++)
+    {
+        load.workers[w].load = &load;
+        load.workers[w].id = w;
+        load.workers[w].ranges = calloc((size_t)load.ranges, sizeof(struct bulk_records));
+        load.workers[w].arena = arena_new_paged(&table->pages);
+        if (load.workers[w].ranges == NULL)
+            exit(EXIT_FAILURE);
+    }
+
+    for (const char *window = begin; window < end;)
+    {
+        window = bulk_split(&load, window, end);
+        bulk_load_window(&load);
+    }
+
+    for (int w = 0; w < load.threads; w++)
+    {
+        arena_merge(table->arena, load.workers[w].arena);
+        for (int r = 0; r < load.ranges; r++)
+            free(load.workers[w].ranges[r].records);
+        free(load.workers[w].ranges);
+        free(load.workers[w].deferred);
+    }
+    free(load.workers);
+    munmap((void *)begin, length);
+    // workers placed the items without counting them in the filter
+    if (table->filter != NULL)
+        ht_filter_rebuild(table);
+    return table;
+}
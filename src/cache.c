@@ -0,0 +1,161 @@
+#include <stdlib.h>
+
+#include "../lib/ht-engine.h"
+
+/**
+ * @brief allocates clear marks for `size` slots under the policy of a cache
+ * @param structhash_table_cache* cache whose marks are replaced
+ * @param constint number of slots
+ * */
+static void ht_cache_alloc_marks(struct hash_table_cache *cache, const int size)
+{
+    if (cache->policy == HT_EVICT_CLOCK)
+        cache->ref = calloc((size_t)size, sizeof(uint8_t));
+    else
+        cache->stamp = calloc((size_t)size, sizeof(uint32_t));
+    if (cache->ref == NULL && cache->stamp == NULL)
+        exit(EXIT_FAILURE);
+}
+
+void ht_cache_init(Table *table, const TableConfig *config)
+{
+    struct hash_table_cache *cache = calloc(1, sizeof(struct hash_table_cache));
+    if (cache == NULL)
+        exit(EXIT_FAILURE);
+    cache->policy = config->eviction;
+    cache->max_entries = config->max_entries;
+    cache->max_bytes = config->max_bytes;
+    cache->on_evict = config->on_evict;
+    cache->evict_ctx = config->evict_ctx;
+    cache->rng = table->seed ^ 0x9E3779B97F4A7C15ull;
+    ht_cache_alloc_marks(cache, table->size);
+    table->cache = cache;
+}
+
+void ht_cache_destroy(Table *table)
+{
+    if (table->cache == NULL)
+        return;
+    free(table->cache->ref);
+    free(table->cache->stamp);
+    free(table->cache);
+    table->cache = NULL;
+}
+
+void ht_cache_begin_rebuild(Table *table)
+{
+    struct hash_table_cache *cache = table->cache;
+    cache->old_ref = cache->ref;
+    cache->old_stamp = cache->stamp;
+    cache->ref = NULL;
+    cache->stamp = NULL;
+    ht_cache_alloc_marks(cache, table->size);
+}
+
+void ht_cache_end_rebuild(Table *table)
+{
+    struct hash_table_cache *cache = table->cache;
+    free(cache->old_ref);
+    free(cache->old_stamp);
+    cache->old_ref = NULL;
+    cache->old_stamp = NULL;
+    cache->tombstones = 0;
+    if (cache->hand >= table->size)
+        cache->hand = 0;
+}
+
+/**
+ * @brief item nodes and their expiry timers always count, key and
+ * value bytes count when they are stored apart from the node. Interned
+ * values count in full for every entry that refers to them.
+ * @param constTable* cache table
+ * @param constItem* item to measure
+ * */
+size_t ht_cache_item_bytes(const Table *table, const Item *item)
+{
+    size_t bytes = item->is_timed ? sizeof(struct ht_timed_item) : sizeof(Item);
+    if (!item->is_inline)
+        bytes += item->value_len + 1 + (table->borrowed_keys ? 0 : item->key_len + 1);
+    return bytes;
+}
+
+/**
+ * @brief CLOCK victim: the hand clears the reference bits it passes
+ * until it reaches an entry whose bit was already clear, so every entry
+ * hit since the last sweep survives one more. Only the marks are read,
+ * never the slots or the items.
+ * @param Table* cache table holding at least one entry
+ * @return int slot of the victim
+ * */
+static int ht_cache_clock_victim(Table *table)
+{
+    struct hash_table_cache *cache = table->cache;
+    for (;;)
+    {
+        const int idx = cache->hand;
+        cache->hand = idx + 1 == table->size ? 0 : idx + 1;
+        if (cache->ref[idx] == HT_CACHE_UNREFERENCED)
+            return idx;
+        if (cache->ref[idx] == HT_CACHE_REFERENCED)
+            cache->ref[idx] = HT_CACHE_UNREFERENCED;
+    }
+}
+
+/**
+ * @brief sampled LRU victim: the oldest of the first HT_CACHE_SAMPLES
+ * entries found walking from a random slot
+ * @param Table* cache table holding at least one entry
+ * @return int slot of the victim
+ * */
+static int ht_cache_lru_victim(Table *table)
+{
+    struct hash_table_cache *cache = table->cache;
+    // xorshift64, seeded from the table seed
+    cache->rng ^= cache->rng << 13;
+    cache->rng ^= cache->rng >> 7;
+    cache->rng ^= cache->rng << 17;
+    int idx = (int)(cache->rng % (uint64_t)table->size);
+    const int samples = table->count < HT_CACHE_SAMPLES ? table->count : HT_CACHE_SAMPLES;
+    int victim = -1;
+    uint32_t oldest = 0;
+    for (int found = 0; found < samples; idx = idx + 1 == table->size ? 0 : idx + 1)
+    {
+        if (cache->stamp[idx] == 0)
+            continue;
+        // unsigned ages stay right across a wrap of the clock
+        const uint32_t age = cache->clock - cache->stamp[idx];
+        if (victim < 0 || age > oldest)
+        {
+            victim = idx;
+            oldest = age;
+        }
+        found++;
+    }
+    return victim;
+}
+
+int ht_cache_victim(Table *table)
+{
+    return table->cache->policy == HT_EVICT_CLOCK ? ht_cache_clock_victim(table) : ht_cache_lru_victim(table);
+}
+
+void ht_cache_admit(Table *table, const Item *item, const int idx)
+{
+    struct hash_table_cache *cache = table->cache;
+    cache->bytes += ht_cache_item_bytes(table, item);
+    if (cache->ref != NULL)
+        cache->ref[idx] = HT_CACHE_UNREFERENCED;
+    else
+        cache->stamp[idx] = ht_cache_tick(cache);
+}
+
+void ht_cache_forget(Table *table, const Item *item, const int idx)
+{
+    struct hash_table_cache *cache = table->cache;
+    cache->bytes -= ht_cache_item_bytes(table, item);
+    cache->tombstones++;
+    if (cache->ref != NULL)
+        cache->ref[idx] = HT_CACHE_FREE;
+    else
+        cache->stamp[idx] = 0;
+}
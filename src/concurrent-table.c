@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "../lib/concurrent-table.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CT_CPU_RELAX() _mm_pause()
+#else
+#define CT_CPU_RELAX() ((void)0)
+#endif
+
+#define CT_SPIN_TRIES 128
+
+/**
+ * @brief test-and-test-and-set lock; yields the cpu after a while so an
+ * oversubscribed machine does not spin on a preempted holder
+ * */
+static inline void ct_spin_lock(int *spin)
+{
+    for (;;)
+    {
+        if (!__atomic_exchange_n(spin, 1, __ATOMIC_ACQUIRE))
+            return;
+        for (int tries = 0; __atomic_load_n(spin, __ATOMIC_RELAXED); tries++)
+        {
+            if (tries < CT_SPIN_TRIES)
+                CT_CPU_RELAX();
+            else
+                sched_yield();
+        }
+    }
+}
+
+static inline void ct_spin_unlock(int *spin)
+{
+    __atomic_store_n(spin, 0, __ATOMIC_RELEASE);
+}
+
+static inline void ct_read_lock(ConcurrentTable *ct, struct concurrent_table_shard *shard)
+{
+    if (ct->lock_kind == CT_LOCK_SPIN)
+        ct_spin_lock(&shard->spin);
+    else
+        pthread_rwlock_rdlock(&shard->rwlock);
+}
+
+static inline void ct_write_lock(ConcurrentTable *ct, struct concurrent_table_shard *shard)
+{
+    if (ct->lock_kind == CT_LOCK_SPIN)
+        ct_spin_lock(&shard->spin);
+    else
+        pthread_rwlock_wrlock(&shard->rwlock);
+}
+
+static inline void ct_unlock(ConcurrentTable *ct, struct concurrent_table_shard *shard)
+{
+    if (ct->lock_kind == CT_LOCK_SPIN)
+        ct_spin_unlock(&shard->spin);
+    else
+        pthread_rwlock_unlock(&shard->rwlock);
+}
+
+/**
+ * @brief picks the shard of a hash from its high bits, the low bits
+ * stay uniform for probing inside the shard
+ * */
+static inline struct concurrent_table_shard *ct_shard(ConcurrentTable *ct, const uint64_t hash)
+{
+    if (ct->shard_bits == 0)
+        return &ct->shards[0];
+    return &ct->shards[hash >> (64 - ct->shard_bits)];
+}
+
+ConcurrentTable *ct_new(int shard_count, int lock_kind, const TableConfig *config)
+{
+    const TableConfig defaults = {0};
+    if (config == NULL)
+        config = &defaults;
+    if (lock_kind != CT_LOCK_RWLOCK && lock_kind != CT_LOCK_SPIN)
+        return NULL;
+    ConcurrentTable *ct = malloc(sizeof(ConcurrentTable));
+    if (ct == NULL)
+        exit(EXIT_FAILURE);
+    ct->shard_bits = 0;
+    while ((1 << ct->shard_bits) < shard_count)
+        ct->shard_bits++;
+    ct->shard_count = 1 << ct->shard_bits;
+    ct->lock_kind = lock_kind;
+    ct->hash = config->hash != NULL ? config->hash : ht_hash_wy;
+    ct->seed = config->seed;
+    ct->shards = aligned_alloc(CT_CACHE_LINE, sizeof(struct concurrent_table_shard) * (size_t)ct->shard_count);
+    if (ct->shards == NULL)
+        exit(EXIT_FAILURE);
+    for (int i = 0; i < ct->shard_count; i++)
+    {
+        struct concurrent_table_shard *shard = &ct->shards[i];
+        pthread_rwlock_init(&shard->rwlock, NULL);
+        shard->spin = 0;
+        shard->table = ht_new_with_config(config);
+        if (shard->table == NULL)
+        {
+            ct->shard_count = i;
+            delete_ConcurrentTable(ct);
+            return NULL;
+        }
+    }
+    return ct;
+}
+
+void ct_insert(ConcurrentTable *ct, const char *key, const char *value)
+{
+    const uint64_t hash = ct->hash(key, strlen(key), ct->seed);
+    struct concurrent_table_shard *shard = ct_shard(ct, hash);
+    ct_write_lock(ct, shard);
+    ht_insert_with_hash(shard->table, key, value, hash);
+    ct_unlock(ct, shard);
+}
+
+void ct_insert_with_ttl(ConcurrentTable *ct, const char *key, const char *value, const uint64_t ttl_ms)
+{
+    const uint64_t hash = ct->hash(key, strlen(key), ct->seed);
+    struct concurrent_table_shard *shard = ct_shard(ct, hash);
+    ct_write_lock(ct, shard);
+    ht_insert_with_ttl(shard->table, key, value, ttl_ms);
+    ct_unlock(ct, shard);
+}
+
+bool ct_find(ConcurrentTable *ct, const char *key, char *value, size_t value_size)
+{
+    const uint64_t hash = ct->hash(key, strlen(key), ct->seed);
+    struct concurrent_table_shard *shard = ct_shard(ct, hash);
+    // incremental resizes migrate buckets on lookups and cache hits mark
+    // their entry and advance the clock, so those shards need the write
+    // lock even to read
+    const bool mutates = shard->table->incremental_resize || shard->table->cache != NULL;
+    if (mutates)
+    {
+        ct_write_lock(ct, shard);
+    }
+    else
+    {
+        ct_read_lock(ct, shard);
+        // lookups reclaim the expired items they find; the timer wheel
+        // appears with the first TTL insert, so it is checked under the lock
+        if (ct->lock_kind == CT_LOCK_RWLOCK && shard->table->expiry != NULL)
+        {
+            ct_unlock(ct, shard);
+            ct_write_lock(ct, shard);
+        }
+    }
+    const char *found = ht_find_with_hash(shard->table, key, hash);
+    if (found != NULL && value_size > 0)
+    {
+        const size_t len = strlen(found);
+        const size_t copy = len < value_size ? len : value_size - 1;
+        memcpy(value, found, copy);
+        value[copy] = '\0';
+    }
+    ct_unlock(ct, shard);
+    return found != NULL;
+}
+
+void ct_delete(ConcurrentTable *ct, const char *key)
+{
+    const uint64_t hash = ct->hash(key, strlen(key), ct->seed);
+    struct concurrent_table_shard *shard = ct_shard(ct, hash);
+    ct_write_lock(ct, shard);
+    ht_delete_with_hash(shard->table, key, hash);
+    ct_unlock(ct, shard);
+}
+
+int ct_count(ConcurrentTable *ct)
+{
+    int count = 0;
+    for (int i = 0; i < ct->shard_count; i++)
+    {
+        ct_read_lock(ct, &ct->shards[i]);
+        count += ct->shards[i].table->count;
+        ct_unlock(ct, &ct->shards[i]);
+    }
+    return count;
+}
+
+void delete_ConcurrentTable(ConcurrentTable *ct)
+{
+    for (int i = 0; i < ct->shard_count; i++)
+    {
+        pthread_rwlock_destroy(&ct->shards[i].rwlock);
+        delete_Table(ct->shards[i].table);
+    }
+    free(ct->shards);
+    free(ct);
+}
@@ -0,0 +1,454 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/ht-engine.h"
+#include "../lib/arena.h"
+
+// entries per bucket, one bucket fills a cache line
+#define CUCKOO_WAYS 4
+// percent of the slots in use before the store doubles
+#define CUCKOO_MAX_LOAD 95
+// buckets a displacement path moves entries through at most
+#define CUCKOO_MAX_PATH 5
+// buckets the search for a displacement path visits at most
+#define CUCKOO_SEARCH_NODES 512
+// displacements a scanned store remembers at least, see `cuckoo_scan`
+#define CUCKOO_MOVES_MIN 256
+
+/**
+ * @brief four entries and their full hashes in one cache line. The hash
+ * is the tag compared before a node is read, and gives the other bucket
+ * of an entry without reading its node when it is displaced.
+ * */
+struct cuckoo_bucket
+{
+    _Alignas(64) uint64_t hashes[CUCKOO_WAYS];
+    // item nodes in the table arena, NULL for a free way
+    Item *items[CUCKOO_WAYS];
+};
+
+/**
+ * @brief bucket a displacement moved an entry into, and the version of
+ * the store the displacement made
+ * */
+struct cuckoo_move
+{
+    uint64_t version;
+    uint32_t bucket;
+};
+
+/**
+ * @brief Structural definition for the cuckoo storage: a power-of-two
+ * array of buckets, every key lives in one of its two buckets
+ * */
+struct cuckoo_store
+{
+    struct cuckoo_bucket *buckets;
+    // buckets - 1
+    size_t mask;
+    // bumped whenever entries change buckets
+    uint64_t version;
+    // ring of the latest displacements, allocated by the first scan and
+    // dropped by a rehash, which moves every entry anyway
+    struct cuckoo_move *moves;
+    size_t moves_capacity;
+    size_t moves_head;
+    size_t moves_count;
+    // the ring holds every displacement made after this version
+    uint64_t moves_from;
+};
+
+/**
+ * @brief one bucket reached by the displacement search: the entry in
+ * way `way` of the bucket of step `parent` can move into it
+ * */
+struct cuckoo_step
+{
+    size_t bucket;
+    int parent;
+    int way;
+    int depth;
+};
+
+static inline size_t cuckoo_first(const uint64_t hash, const size_t mask)
+{
+    return (size_t)hash & mask;
+}
+
+/**
+ * @brief the second bucket comes from the high half of the hash and is
+ * never the first one
+ * */
+static inline size_t cuckoo_second(const uint64_t hash, const size_t mask)
+{
+    const size_t first = cuckoo_first(hash, mask);
+    const size_t second = (size_t)(hash >> 32) & mask;
+    return second != first ? second : first ^ 1;
+}
+
+/**
+ * @brief the bucket an entry of `bucket` moves to when displaced
+ * */
+static inline size_t cuckoo_other(const uint64_t hash, const size_t bucket, const size_t mask)
+{
+    const size_t first = cuckoo_first(hash, mask);
+    return bucket == first ? cuckoo_second(hash, mask) : first;
+}
+
+/**
+ * @brief allocates `buckets` empty buckets, each aligned to a cache line
+ * @param structcuckoo_store* store to fill
+ * @param size_t number of buckets, a power of two
+ * */
+static void cuckoo_alloc(struct cuckoo_store *store, const size_t buckets)
+{
+    store->buckets = aligned_alloc(sizeof(struct cuckoo_bucket), buckets * sizeof(struct cuckoo_bucket));
+    if (store->buckets == NULL)
+        exit(EXIT_FAILURE);
+    memset(store->buckets, 0, buckets * sizeof(struct cuckoo_bucket));
+    store->mask = buckets - 1;
+}
+
+/**
+ * @brief returns the way holding key or NULL. Both buckets are fetched
+ * before either is compared, so a lookup costs one memory round trip
+ * for its two cache lines plus the node of a matching tag.
+ * @param int* buckets compared, 1 or 2, for the probe counters
+ * */
+static inline Item **cuckoo_lookup(const struct cuckoo_store *store, const void *key, const size_t key_len, const uint64_t hash, int *examined)
+{
+    struct cuckoo_bucket *first = &store->buckets[cuckoo_first(hash, store->mask)];
+    struct cuckoo_bucket *second = &store->buckets[cuckoo_second(hash, store->mask)];
+    __builtin_prefetch(second);
+    *examined = 1;
+    for (int way = 0; way < CUCKOO_WAYS; way++)
+    {
+        if (first->hashes[way] == hash && first->items[way] != NULL && ht_item_matches(first->items[way], key, key_len, hash))
+            return &first->items[way];
+    }
+    *examined = 2;
+    for (int way = 0; way < CUCKOO_WAYS; way++)
+    {
+        if (second->hashes[way] == hash && second->items[way] != NULL && ht_item_matches(second->items[way], key, key_len, hash))
+            return &second->items[way];
+    }
+    return NULL;
+}
+
+/**
+ * @brief remembers that a displacement moved an entry into `bucket`,
+ * overwriting the oldest move once the ring is full
+ * */
+static inline void cuckoo_log_move(struct cuckoo_store *store, const size_t bucket)
+{
+    if (store->moves_count == store->moves_capacity)
+    {
+        store->moves_from = store->moves[store->moves_head].version;
+        store->moves_head = (store->moves_head + 1) % store->moves_capacity;
+        store->moves_count--;
+    }
+    const size_t idx = (store->moves_head + store->moves_count) % store->moves_capacity;
+    store->moves[idx] = (struct cuckoo_move){.version = store->version, .bucket = (uint32_t)bucket};
+    store->moves_count++;
+}
+
+static inline int cuckoo_free_way(const struct cuckoo_bucket *bucket)
+{
+    for (int way = 0; way < CUCKOO_WAYS; way++)
+    {
+        if (bucket->items[way] == NULL)
+            return way;
+    }
+    return -1;
+}
+
+/**
+ * @brief whether a bucket is already on the path to step `idx`, so a path
+ * never moves an entry into a bucket it has moved one out of
+ * */
+static inline bool cuckoo_on_path(const struct cuckoo_step *queue, int idx, const size_t bucket)
+{
+    for (; idx >= 0; idx = queue[idx].parent)
+    {
+        if (queue[idx].bucket == bucket)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief places an item whose strings are stored. A breadth-first search
+ * from its two buckets looks for the shortest chain of displacements
+ * ending in a free way, up to CUCKOO_MAX_PATH moves. The chain is then
+ * walked back from its end: every entry moves to its other bucket into
+ * the way freed before it, and the item takes the way freed in one of
+ * its own buckets. Entries only move once a path is known.
+ * @param structcuckoo_store* store to place into
+ * @param Item* item to place
+ * @return bool false when no path was found, the store has to grow
+ * */
+static bool cuckoo_place(struct cuckoo_store *store, Item *item)
+{
+    struct cuckoo_step queue[CUCKOO_SEARCH_NODES];
+    int tail = 0;
+    queue[tail++] = (struct cuckoo_step){.bucket = cuckoo_first(item->hash, store->mask), .parent = -1};
+    queue[tail++] = (struct cuckoo_step){.bucket = cuckoo_second(item->hash, store->mask), .parent = -1};
+    for (int head = 0; head < tail; head++)
+    {
+        const struct cuckoo_step *step = &queue[head];
+        int way = cuckoo_free_way(&store->buckets[step->bucket]);
+        if (way >= 0)
+        {
+            int idx = head;
+            if (queue[idx].parent >= 0)
+                store->version++;
+            for (; queue[idx].parent >= 0; idx = queue[idx].parent)
+            {
+                struct cuckoo_bucket *to = &store->buckets[queue[idx].bucket];
+                struct cuckoo_bucket *from = &store->buckets[queue[queue[idx].parent].bucket];
+                to->hashes[way] = from->hashes[queue[idx].way];
+                to->items[way] = from->items[queue[idx].way];
+                if (store->moves != NULL)
+                    cuckoo_log_move(store, queue[idx].bucket);
+                way = queue[idx].way;
+            }
+            struct cuckoo_bucket *bucket = &store->buckets[queue[idx].bucket];
+            bucket->hashes[way] = item->hash;
+            bucket->items[way] = item;
+            return true;
+        }
+        if (step->depth == CUCKOO_MAX_PATH)
+            continue;
+        const struct cuckoo_bucket *bucket = &store->buckets[step->bucket];
+        for (int w = 0; w < CUCKOO_WAYS && tail < CUCKOO_SEARCH_NODES; w++)
+        {
+            const size_t next = cuckoo_other(bucket->hashes[w], step->bucket, store->mask);
+            if (cuckoo_on_path(queue, head, next))
+                continue;
+            queue[tail++] = (struct cuckoo_step){.bucket = next, .parent = head, .way = w, .depth = step->depth + 1};
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief rebuilds the store with `buckets` buckets, moving every node
+ * pointer; a rebuild that cannot place an entry starts over twice as large
+ * @param Table* table owning the store
+ * @param size_t new number of buckets, a power of two
+ * */
+static void cuckoo_rehash(Table *table, size_t buckets)
+{
+    HT_STATS_ONLY(const uint64_t resize_start = ht_stats_clock();)
+    struct cuckoo_store *store = table->store;
+    const struct cuckoo_store old = *store;
+    // every entry moves, scans in progress start over
+    free(store->moves);
+    store->moves = NULL;
+    for (bool placed = false; !placed; buckets *= 2)
+    {
+        cuckoo_alloc(store, buckets);
+        placed = true;
+        for (size_t b = 0; b <= old.mask && placed; b++)
+        {
+            for (int way = 0; way < CUCKOO_WAYS && placed; way++)
+            {
+                if (old.buckets[b].items[way] != NULL)
+                    placed = cuckoo_place(store, old.buckets[b].items[way]);
+            }
+        }
+        if (!placed)
+            free(store->buckets);
+    }
+    store->version = old.version + 1;
+    table->size = (int)((store->mask + 1) * CUCKOO_WAYS);
+    table->base_size = table->size;
+    free(old.buckets);
+    HT_STATS_ONLY(ht_stats_record_resize(table, resize_start);)
+}
+
+/**
+ * @brief buckets holding `items` entries under CUCKOO_MAX_LOAD
+ * */
+static size_t cuckoo_buckets_for(size_t buckets, const int items)
+{
+    while (buckets * CUCKOO_WAYS * CUCKOO_MAX_LOAD < (size_t)items * 100)
+        buckets *= 2;
+    return buckets;
+}
+
+static void cuckoo_init(Table *table, const int min_items)
+{
+    struct cuckoo_store *store = malloc(sizeof(struct cuckoo_store));
+    if (store == NULL)
+        exit(EXIT_FAILURE);
+    cuckoo_alloc(store, cuckoo_buckets_for(4, min_items));
+    store->version = 0;
+    store->moves = NULL;
+    table->store = store;
+    table->items = NULL;
+    table->size = (int)((store->mask + 1) * CUCKOO_WAYS);
+    table->base_size = table->size;
+    table->count = 0;
+}
+
+static void cuckoo_destroy(Table *table)
+{
+    struct cuckoo_store *store = table->store;
+    free(store->buckets);
+    free(store->moves);
+    free(store);
+    table->store = NULL;
+}
+
+/**
+ * @brief a cuckoo table holds one entry per key: a key that is already
+ * stored gets the new value, as a key can only ever sit in two buckets
+ * */
+static void cuckoo_insert(Table *table, const void *key, const size_t key_len, const void *value, const size_t value_len, const uint64_t hash)
+{
+    struct cuckoo_store *store = table->store;
+    int examined;
+    Item **stored = cuckoo_lookup(store, key, key_len, hash, &examined);
+    if (stored != NULL)
+    {
+        ht_release_item_strings(table, *stored);
+        ht_store_item_strings(table, *stored, key, key_len, value, value_len);
+        return;
+    }
+    if ((size_t)(table->count + 1) * 100 > (store->mask + 1) * CUCKOO_WAYS * CUCKOO_MAX_LOAD)
+        cuckoo_rehash(table, (store->mask + 1) * 2);
+    Item *item = arena_alloc(table->arena, sizeof(Item));
+    ht_store_item_strings(table, item, key, key_len, value, value_len);
+    item->hash = hash;
+    while (!cuckoo_place(table->store, item))
+        cuckoo_rehash(table, (store->mask + 1) * 2);
+    table->count++;
+}
+
+static Item *cuckoo_find(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    int examined;
+    Item **stored = cuckoo_lookup(table->store, key, key_len, hash, &examined);
+    HT_STATS_ONLY(ht_stats_record_probe(table, stored != NULL, examined);)
+    return stored != NULL ? *stored : NULL;
+}
+
+/**
+ * @brief frees the way of the key, there is never a tombstone
+ * */
+static void cuckoo_remove(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    int examined;
+    Item **stored = cuckoo_lookup(table->store, key, key_len, hash, &examined);
+    if (stored == NULL)
+        return;
+    ht_release_item_strings(table, *stored);
+    arena_free(table->arena, *stored, sizeof(Item));
+    *stored = NULL;
+    table->count--;
+}
+
+static void cuckoo_reserve(Table *table, const int items)
+{
+    const struct cuckoo_store *store = table->store;
+    const size_t buckets = cuckoo_buckets_for(store->mask + 1, items);
+    if (buckets > store->mask + 1)
+        cuckoo_rehash(table, buckets);
+}
+
+/**
+ * @brief adds every entry of a bucket to a scan batch
+ * */
+static inline void cuckoo_scan_bucket(const struct cuckoo_store *store, const size_t bucket, struct ht_scan_batch *batch)
+{
+    for (int way = 0; way < CUCKOO_WAYS; way++)
+    {
+        if (store->buckets[bucket].items[way] != NULL)
+            ht_scan_push(batch, store->buckets[bucket].items[way]);
+    }
+}
+
+/**
+ * @brief walks the buckets in order. A displacement between calls may
+ * move an entry into a bucket the scan has passed, so the cursor carries
+ * the version of the layout and the scan first reports again the passed
+ * buckets that displacements made since then moved entries into. The
+ * first scan starts remembering displacements; once more of them happened
+ * since the cursor than the ring holds, or a rehash moved every entry,
+ * the scan starts over.
+ * */
+static uint64_t cuckoo_scan(Table *table, uint64_t cursor, struct ht_scan_batch *batch, int budget)
+{
+    struct cuckoo_store *store = table->store;
+    if (store->moves == NULL)
+    {
+        const size_t capacity = (store->mask + 1) / 4;
+        store->moves_capacity = capacity > CUCKOO_MOVES_MIN ? capacity : CUCKOO_MOVES_MIN;
+        store->moves = malloc(store->moves_capacity * sizeof(struct cuckoo_move));
+        if (store->moves == NULL)
+            exit(EXIT_FAILURE);
+        store->moves_head = 0;
+        store->moves_count = 0;
+        store->moves_from = store->version;
+    }
+    uint64_t bucket = 0;
+    int examined = 0;
+    if (cursor != 0)
+    {
+        // the cursor keeps the low 31 bits of the version it was made at
+        const uint64_t since = store->version - ((store->version - (cursor >> 32)) & 0x7FFFFFFFu);
+        if (since >= store->moves_from)
+        {
+            bucket = cursor & 0xFFFFFFFFull;
+            for (size_t i = 0; i < store->moves_count; i++)
+            {
+                const struct cuckoo_move *move = &store->moves[(store->moves_head + i) % store->moves_capacity];
+                if (move->version > since && move->bucket < bucket)
+                {
+                    cuckoo_scan_bucket(store, move->bucket, batch);
+                    examined += CUCKOO_WAYS;
+                }
+            }
+        }
+    }
+    for (; bucket <= store->mask && examined < budget; bucket++, examined += CUCKOO_WAYS)
+        cuckoo_scan_bucket(store, bucket, batch);
+    const uint64_t tag = ((store->version & 0x7FFFFFFFu) | 0x80000000u) << 32;
+    return bucket <= store->mask ? tag | bucket : 0;
+}
+
+static void cuckoo_stats(Table *table, TableStats *stats)
+{
+    const struct cuckoo_store *store = table->store;
+    stats->tombstones = 0;
+    stats->slot_bytes = (store->mask + 1) * sizeof(struct cuckoo_bucket);
+    if (store->moves != NULL)
+        stats->slot_bytes += store->moves_capacity * sizeof(struct cuckoo_move);
+    stats->node_bytes = (size_t)table->count * sizeof(Item);
+}
+
+static void cuckoo_each(Table *table, HtItemFn fn, void *ctx)
+{
+    const struct cuckoo_store *store = table->store;
+    for (size_t b = 0; b <= store->mask; b++)
+    {
+        for (int way = 0; way < CUCKOO_WAYS; way++)
+        {
+            if (store->buckets[b].items[way] != NULL)
+                fn(store->buckets[b].items[way], ctx);
+        }
+    }
+}
+
+const struct ht_engine HT_CUCKOO_ENGINE = {
+    .init = cuckoo_init,
+    .destroy = cuckoo_destroy,
+    .insert = cuckoo_insert,
+    .find = cuckoo_find,
+    .remove = cuckoo_remove,
+    .each = cuckoo_each,
+    .reserve = cuckoo_reserve,
+    .stats = cuckoo_stats,
+    .scan = cuckoo_scan,
+};
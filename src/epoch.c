@@ -0,0 +1,123 @@
+#include <stdlib.h>
+
+#include "../lib/epoch.h"
+
+/**
+ * @brief a block waiting for readers to leave the epoch it was retired in
+ * */
+struct epoch_retired
+{
+    struct epoch_retired *next;
+    void *ptr;
+    void (*free_fn)(void *);
+    uint64_t epoch;
+};
+
+void epoch_init(EpochDomain *domain)
+{
+    atomic_init(&domain->global, 1);
+    for (int i = 0; i < EPOCH_MAX_READERS; i++)
+    {
+        atomic_init(&domain->readers[i].epoch, 0);
+        atomic_init(&domain->readers[i].in_use, 0);
+    }
+    domain->retired = NULL;
+    domain->retired_count = 0;
+}
+
+EpochReader *epoch_register(EpochDomain *domain)
+{
+    for (int i = 0; i < EPOCH_MAX_READERS; i++)
+    {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&domain->readers[i].in_use, &expected, 1))
+            return &domain->readers[i];
+    }
+    return NULL;
+}
+
+void epoch_unregister(EpochReader *reader)
+{
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+    atomic_store_explicit(&reader->in_use, 0, memory_order_release);
+}
+
+void epoch_enter(EpochDomain *domain, EpochReader *reader)
+{
+    uint64_t epoch = atomic_load_explicit(&domain->global, memory_order_relaxed);
+    for (;;)
+    {
+        atomic_store_explicit(&reader->epoch, epoch, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        // a writer may have advanced before our store became visible
+        const uint64_t now = atomic_load_explicit(&domain->global, memory_order_relaxed);
+        if (now == epoch)
+            return;
+        epoch = now;
+    }
+}
+
+void epoch_exit(EpochReader *reader)
+{
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
+
+void epoch_reclaim(EpochDomain *domain)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    const uint64_t global = atomic_load_explicit(&domain->global, memory_order_relaxed);
+    int caught_up = 1;
+    for (int i = 0; i < EPOCH_MAX_READERS && caught_up; i++)
+    {
+        const uint64_t epoch = atomic_load_explicit(&domain->readers[i].epoch, memory_order_acquire);
+        if (epoch != 0 && epoch != global)
+            caught_up = 0;
+    }
+    if (caught_up)
+        atomic_store_explicit(&domain->global, global + 1, memory_order_seq_cst);
+
+    const uint64_t current = atomic_load_explicit(&domain->global, memory_order_relaxed);
+    struct epoch_retired **link = &domain->retired;
+    while (*link != NULL)
+    {
+        struct epoch_retired *entry = *link;
+        if (entry->epoch + 2 <= current)
+        {
+            *link = entry->next;
+            entry->free_fn(entry->ptr);
+            free(entry);
+            domain->retired_count--;
+        }
+        else
+            link = &entry->next;
+    }
+}
+
+void epoch_retire(EpochDomain *domain, void *ptr, void (*free_fn)(void *))
+{
+    struct epoch_retired *entry = malloc(sizeof(struct epoch_retired));
+    if (entry == NULL)
+        exit(EXIT_FAILURE);
+    entry->ptr = ptr;
+    entry->free_fn = free_fn;
+    entry->epoch = atomic_load_explicit(&domain->global, memory_order_relaxed);
+    entry->next = domain->retired;
+    domain->retired = entry;
+    domain->retired_count++;
+    if (domain->retired_count >= EPOCH_RECLAIM_BATCH)
+        epoch_reclaim(domain);
+}
+
+void epoch_destroy(EpochDomain *domain)
+{
+    struct epoch_retired *entry = domain->retired;
+    while (entry != NULL)
+    {
+        struct epoch_retired *next = entry->next;
+        entry->free_fn(entry->ptr);
+        free(entry);
+        entry = next;
+    }
+    domain->retired = NULL;
+    domain->retired_count = 0;
+}
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/ht-engine.h"
+
+#define HT_WHEEL_MASK (HT_WHEEL_SLOTS - 1)
+
+uint64_t ht_clock_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+void ht_expiry_init(Table *table)
+{
+    struct hash_table_expiry *expiry = calloc(1, sizeof(struct hash_table_expiry));
+    if (expiry == NULL)
+        exit(EXIT_FAILURE);
+    expiry->now = table->clock();
+    table->expiry = expiry;
+}
+
+void ht_expiry_destroy(Table *table)
+{
+    free(table->expiry);
+    table->expiry = NULL;
+}
+
+/**
+ * @brief pushes a timer on a list head
+ * */
+static inline void ht_timer_push(struct ht_timer **head, struct ht_timer *timer)
+{
+    timer->next = *head;
+    if (*head != NULL)
+        (*head)->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+}
+
+/**
+ * @brief the level is the first whose span covers the time left, the
+ * slot comes from the matching bits of the expiry. Timers already due
+ * go to the slot of the current tick; timers beyond the top level wrap
+ * around it and are placed again when their slot cascades.
+ * */
+void ht_timer_add(struct hash_table_expiry *expiry, struct ht_timer *timer)
+{
+    const uint64_t due = timer->expires > expiry->now ? timer->expires : expiry->now;
+    const uint64_t left = due - expiry->now;
+    int level = 0;
+    while (level < HT_WHEEL_LEVELS - 1 && left >> (HT_WHEEL_BITS * (level + 1)) != 0)
+        level++;
+    const int slot = (int)(due >> (HT_WHEEL_BITS * level)) & HT_WHEEL_MASK;
+    ht_timer_push(&expiry->wheel[level][slot], timer);
+    expiry->occupied[level] |= 1ull << slot;
+}
+
+/**
+ * @brief a level holds no timer, stale occupied bits are cleared on the way
+ * */
+static bool ht_wheel_level_empty(struct hash_table_expiry *expiry, const int level)
+{
+    for (uint64_t bits = expiry->occupied[level]; bits != 0; bits &= bits - 1)
+    {
+        const int slot = __builtin_ctzll(bits);
+        if (expiry->wheel[level][slot] != NULL)
+            return false;
+        expiry->occupied[level] &= ~(1ull << slot);
+    }
+    return true;
+}
+
+/**
+ * @brief moves one tick ahead, moving the slot lists of every level
+ * whose boundary the tick crosses to the pending lists
+ * */
+static void ht_wheel_tick(struct hash_table_expiry *expiry)
+{
+    expiry->now++;
+    for (int level = 1; level < HT_WHEEL_LEVELS; level++)
+    {
+        if ((expiry->now & ((1ull << (HT_WHEEL_BITS * level)) - 1)) != 0)
+            break;
+        const int slot = (int)(expiry->now >> (HT_WHEEL_BITS * level)) & HT_WHEEL_MASK;
+        struct ht_timer *first = expiry->wheel[level][slot];
+        if (first == NULL)
+            continue;
+        // the pending list is drained before the next tick, so it is empty
+        expiry->wheel[level][slot] = NULL;
+        expiry->pending[level] = first;
+        first->pprev = &expiry->pending[level];
+    }
+}
+
+/**
+ * @brief reclaims the entry of an expired timer
+ * */
+static inline void ht_timer_fire(Table *table, struct ht_timer *timer)
+{
+    struct ht_timed_item *timed = (struct ht_timed_item *)((char *)timer - offsetof(struct ht_timed_item, timer));
+    ht_remove_item(table, &timed->item);
+    table->expiry->expired++;
+}
+
+int ht_expiry_advance(Table *table, const uint64_t to, int budget)
+{
+    struct hash_table_expiry *expiry = table->expiry;
+    int reclaimed = 0;
+    for (;;)
+    {
+        for (int level = HT_WHEEL_LEVELS - 1; level > 0; level--)
+        {
+            while (expiry->pending[level] != NULL)
+            {
+                if (budget-- <= 0)
+                    return reclaimed;
+                struct ht_timer *timer = expiry->pending[level];
+                if (timer->expires <= expiry->now)
+                {
+                    ht_timer_fire(table, timer);
+                    reclaimed++;
+                    continue;
+                }
+                ht_timer_unlink(timer);
+                ht_timer_add(expiry, timer);
+            }
+        }
+        // every timer of the slot of the current tick is due
+        struct ht_timer **slot = &expiry->wheel[0][expiry->now & HT_WHEEL_MASK];
+        while (*slot != NULL)
+        {
+            if (budget-- <= 0)
+                return reclaimed;
+            ht_timer_fire(table, *slot);
+            reclaimed++;
+        }
+        if (expiry->now >= to || budget-- <= 0)
+            return reclaimed;
+        if (expiry->timed == 0)
+        {
+            expiry->now = to;
+            return reclaimed;
+        }
+        // nothing is due before the next boundary of the first level
+        // holding timers, skip the ticks up to it
+        int level = 0;
+        while (level < HT_WHEEL_LEVELS - 1 && ht_wheel_level_empty(expiry, level))
+            level++;
+        if (level > 0)
+        {
+            const uint64_t boundary = ((expiry->now >> (HT_WHEEL_BITS * level)) + 1) << (HT_WHEEL_BITS * level);
+            expiry->now = boundary - 1 < to ? boundary - 1 : to;
+            if (expiry->now >= to)
+                return reclaimed;
+        }
+        ht_wheel_tick(expiry);
+    }
+}
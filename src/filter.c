@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "../lib/ht-engine.h"
+
+// counters of a 64-byte block
+#define HT_FILTER_BLOCK_COUNTERS 128
+
+static inline size_t ht_filter_bytes(const struct hash_table_filter *filter)
+{
+    return (size_t)filter->blocks * 8 * sizeof(uint64_t);
+}
+
+void ht_filter_add(struct hash_table_filter *filter, const uint64_t hash)
+{
+    uint64_t *block = ht_filter_block(filter, hash);
+    for (int n = 0; n < HT_FILTER_HASHES; n++)
+    {
+        const unsigned c = ht_filter_counter(hash, n);
+        const unsigned shift = (c & 15) * 4;
+        if (((block[c >> 4] >> shift) & 15) != 15)
+            block[c >> 4] += 1ull << shift;
+    }
+}
+
+void ht_filter_remove(struct hash_table_filter *filter, const uint64_t hash)
+{
+    uint64_t *block = ht_filter_block(filter, hash);
+    for (int n = 0; n < HT_FILTER_HASHES; n++)
+    {
+        const unsigned c = ht_filter_counter(hash, n);
+        const unsigned shift = (c & 15) * 4;
+        const uint64_t count = (block[c >> 4] >> shift) & 15;
+        // a saturated counter may stand for more items than it can tell
+        if (count != 0 && count != 15)
+            block[c >> 4] -= 1ull << shift;
+    }
+}
+
+/**
+ * @brief counts every live item of a slot array in the filter, by the
+ * hash cached in the item
+ * */
+static void ht_filter_add_items(struct hash_table_filter *filter, Item **items, const int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        if (ht_item_live(items[i]))
+            ht_filter_add(filter, items[i]->hash);
+    }
+}
+
+void ht_filter_rebuild(Table *table)
+{
+    struct hash_table_filter *filter = table->filter;
+    if (filter == NULL)
+    {
+        filter = calloc(1, sizeof(struct hash_table_filter));
+        if (filter == NULL)
+            exit(EXIT_FAILURE);
+        table->filter = filter;
+    }
+    else
+    {
+        pages_free(&table->pages, filter->words, ht_filter_bytes(filter));
+    }
+    const uint64_t counters = (uint64_t)table->size * HT_FILTER_COUNTERS_PER_SLOT;
+    filter->blocks = (counters + HT_FILTER_BLOCK_COUNTERS - 1) / HT_FILTER_BLOCK_COUNTERS;
+    filter->words = pages_alloc(&table->pages, ht_filter_bytes(filter));
+    ht_filter_add_items(filter, table->items, table->size);
+    if (table->old_items != NULL)
+        ht_filter_add_items(filter, table->old_items, table->old_size);
+}
+
+void ht_filter_destroy(Table *table)
+{
+    if (table->filter == NULL)
+        return;
+    pages_free(&table->pages, table->filter->words, ht_filter_bytes(table->filter));
+    free(table->filter);
+    table->filter = NULL;
+}
+
+/**
+ * @brief an absent key gets through when its HT_FILTER_HASHES counters are
+ * all in use, so each block adds its share of counters in use to the
+ * power of HT_FILTER_HASHES, weighed by the chance of landing in it
+ * */
+void ht_filter_stats(const struct hash_table_filter *filter, TableStats *stats)
+{
+    stats->filter_bytes = ht_filter_bytes(filter);
+    double rate = 0;
+    for (uint64_t b = 0; b < filter->blocks; b++)
+    {
+        int used = 0;
+        for (int w = 0; w < 8; w++)
+        {
+            const uint64_t word = filter->words[b * 8 + w];
+            // a bit per nonzero counter, in the low bit of each nibble
+            const uint64_t any = (word | word >> 1 | word >> 2 | word >> 3) & 0x1111111111111111ull;
+            used += __builtin_popcountll(any);
+        }
+        rate += pow((double)used / HT_FILTER_BLOCK_COUNTERS, HT_FILTER_HASHES);
+    }
+    stats->filter_fp_rate = filter->blocks > 0 ? rate / (double)filter->blocks : 0;
+}
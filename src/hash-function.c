@@ -0,0 +1,140 @@
+#include <string.h>
+#include <time.h>
+#include <stdio.h>
+
+#include "../lib/hash-function.h"
+
+static const uint64_t WY_P0 = 0xa0761d6478bd642full;
+static const uint64_t WY_P1 = 0xe7037ed1a0b428dbull;
+static const uint64_t WY_P2 = 0x8ebc6af09c88c6e3ull;
+static const uint64_t WY_P3 = 0x589965cc75374cc3ull;
+
+/**
+ * @brief 64x64 -> 128 bit multiply, low half in *a and high half in *b
+ * */
+static inline void wy_mum(uint64_t *a, uint64_t *b)
+{
+    __uint128_t r = *a;
+    r *= *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b)
+{
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t wy_read8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t wy_read4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t wy_read3(const uint8_t *p, size_t k)
+{
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+/**
+ * @brief wyhash style hash of a byte string
+ * @param constvoid* key bytes to hash
+ * @param size_t number of bytes in the key
+ * @param uint64_t seed mixed into the hash state
+ * */
+uint64_t ht_hash_wy(const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = key;
+    uint64_t a, b;
+    seed ^= wy_mix(seed ^ WY_P0, WY_P1);
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            a = (wy_read4(p) << 32) | wy_read4(p + ((len >> 3) << 2));
+            b = (wy_read4(p + len - 4) << 32) | wy_read4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+        {
+            a = wy_read3(p, len);
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        size_t i = len;
+        if (i > 48)
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = wy_mix(wy_read8(p) ^ WY_P1, wy_read8(p + 8) ^ seed);
+                see1 = wy_mix(wy_read8(p + 16) ^ WY_P2, wy_read8(p + 24) ^ see1);
+                see2 = wy_mix(wy_read8(p + 32) ^ WY_P3, wy_read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16)
+        {
+            seed = wy_mix(wy_read8(p) ^ WY_P1, wy_read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wy_read8(p + i - 16);
+        b = wy_read8(p + i - 8);
+    }
+    a ^= WY_P1;
+    b ^= seed;
+    wy_mum(&a, &b);
+    return wy_mix(a ^ WY_P0 ^ len, b ^ WY_P1);
+}
+
+/**
+ * @brief FNV-1a hash of a byte string
+ * @param constvoid* key bytes to hash
+ * @param size_t number of bytes in the key
+ * @param uint64_t seed xored into the offset basis
+ * */
+uint64_t ht_hash_fnv1a(const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = key;
+    uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief reads a random 64-bit seed
+ * @return uint64_t a non-zero seed
+ * */
+uint64_t ht_random_seed(void)
+{
+    uint64_t seed = 0;
+    FILE *urandom = fopen("/dev/urandom", "rb");
+    if (urandom != NULL)
+    {
+        if (fread(&seed, sizeof(seed), 1, urandom) != 1)
+            seed = 0;
+        fclose(urandom);
+    }
+    if (seed == 0)
+        seed = wy_mix((uint64_t)time(NULL) ^ WY_P2, (uint64_t)(uintptr_t)&seed ^ WY_P3);
+    return seed;
+}
@@ -1,14 +1,62 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "../lib/hash-table.h"
 #include "../lib/prime.h"
+#include "../lib/hash-function.h"
+#include "../lib/ht-engine.h"
+#include "../lib/arena.h"
+#include "../lib/intern-pool.h"
 
+static Item HT_EMPTY_ITEM = {.key=NULL, .value=NULL};
+
+static inline Table* ht_resize(Table *, const int);
+
+static inline bool ht_cell_empty(Item* item);
+
+static inline Table* ht_resize_up(Table *);
+
+static inline Table* ht_resize_down(Table *);
+
+static inline Item *create_new_item(Table *, const void *, const size_t, const void *, const size_t, const uint64_t, const uint64_t);
+
+static inline void delete_ht_item(Table *, Item *);
+
+static inline int ht_bucket_count(const int, const int);
+
+static inline int ht_base_size_for(const int);
+
+static inline Table *ht_create_new_sized_table(const int, const TableConfig *);
+
+static inline uint64_t ht_hash(const Table *, const void *, const size_t);
+
+static inline int ht_probe_start(const Table *, const uint64_t, const int);
+
+static inline int ht_probe_step(const Table *, const uint64_t, const int);
+
+static inline int ht_probe_next(const int, const int, const int);
+
+static inline int ht_find_slot(const Table *, Item **, const int, const void *, const size_t, const uint64_t, int *);
+
+static inline int ht_place_item(Table *, Item *);
+
+static inline void ht_insert_hashed(Table *, const void *, const size_t, const void *, const size_t, const uint64_t, const uint64_t);
+
+static inline Table *ht_insert_entry(Table *, const void *, const size_t, const void *, const size_t, const uint64_t, const uint64_t);
+
+static inline Item *ht_find_entry(Table *, const void *, const size_t, const uint64_t);
+
+static inline void ht_delete_entry(Table *, const void *, const size_t, const uint64_t);
 
 
 /**
- * @brief resizes the hash table and rehashes all the items
+ * @brief resizes the hash table in place and moves every item pointer
+ * into the new slot array using its cached hash. Items, keys and values
+ * are neither copied nor rehashed, and the table pointer stays valid.
+ * Tables created with `incremental_resize` only start the migration here,
+ * later operations and `ht_rehash_step` finish it.
  * .Note : it should not be < 50
  * @param Table* represents the current hash table
  * @param constint represents the new size of the hash table
@@ -17,15 +65,70 @@ static Table* ht_resize(Table *table, const int base_size)
 {
     if (base_size < HT_INITIAL_SIZE)
         return table;
-    Table *new_table = ht_create_new_sized_table(base_size); // brand new table
-    for (int i = 0; i < table->size; i++)
+    HT_STATS_ONLY(const uint64_t resize_start = ht_stats_clock();)
+    // a migration still running must end before the next one starts
+    if (table->old_items != NULL)
+        ht_rehash_step(table, table->old_size);
+    table->old_items = table->items;
+    table->old_size = table->size;
+    table->rehash_idx = 0;
+    table->base_size = base_size;
+    table->size = ht_bucket_count(table->capacity_policy, base_size);
+    table->items = pages_alloc(&table->pages, (size_t)table->size * sizeof(Item *));
+    table->layout_version++;
+    // the filter keeps its false positive rate by growing with the slots
+    if (table->filter != NULL)
+        ht_filter_rebuild(table);
+    // cache tables never resize incrementally, their marks move below
+    if (table->cache != NULL)
+        ht_cache_begin_rebuild(table);
+    if (!table->incremental_resize)
     {
-        Item *item = table->items[i];
-        if (item != NULL && !ht_cell_empty(item))
-            ht_insert(new_table, item->key, item->value);
+        // linear probing lets threads fill disjoint slot ranges, the
+        // serial step then only frees the old array
+        if (table->rehash_threads > 1 && table->cache == NULL && table->capacity_policy == HT_CAPACITY_POW2 &&
+            table->old_size >= HT_REHASH_PARALLEL_MIN)
+            ht_rehash_parallel(table);
+        ht_rehash_step(table, table->old_size);
+    }
+    if (table->cache != NULL)
+        ht_cache_end_rebuild(table);
+    HT_STATS_ONLY(ht_stats_record_resize(table, resize_start);)
+    return table;
+}
+
+/**
+ * @brief moves up to `buckets` buckets of the old slot array into the
+ * new one while a resize is in progress. Moved buckets become tombstones
+ * so probe sequences through the old array stay intact for lookups.
+ * @param Table* represents the current hash table
+ * @param int number of old buckets to migrate
+ * @return int 1 if buckets are left to migrate, 0 once the resize is done
+ * */
+int ht_rehash_step(Table *table, int buckets)
+{
+    if (table->old_items == NULL)
+        return 0;
+    for (; buckets > 0 && table->rehash_idx < table->old_size; buckets--)
+    {
+        Item *item = table->old_items[table->rehash_idx];
+        if (item != NULL && item != &HT_EMPTY_ITEM)
+        {
+            const int idx = ht_place_item(table, item);
+            if (table->cache != NULL)
+                ht_cache_move_mark(table->cache, table->rehash_idx, idx);
+            table->old_items[table->rehash_idx] = &HT_EMPTY_ITEM;
+            table->layout_version++;
+        }
+        table->rehash_idx++;
     }
-    delete_Table(table);
-    return new_table;
+    if (table->rehash_idx < table->old_size)
+        return 1;
+    pages_free(&table->pages, table->old_items, (size_t)table->old_size * sizeof(Item *));
+    table->old_items = NULL;
+    table->old_size = 0;
+    table->rehash_idx = 0;
+    return 0;
 }
 
 /**
@@ -36,7 +139,7 @@ static Table* ht_resize(Table *table, const int base_size)
  * @return false 
  */
 static bool ht_cell_empty(Item* item){
-    return item->key == HT_EMPTY_ITEM.key && item->value == HT_EMPTY_ITEM.value;
+    return !item->is_inline && item->key == HT_EMPTY_ITEM.key && item->value == HT_EMPTY_ITEM.value;
 }
 
 /**
@@ -56,38 +159,184 @@ static inline Table* ht_resize_up(Table *ht)
 static inline Table* ht_resize_down(Table *ht)
 {
     const int new_size = ht->base_size / 2;
+    if (new_size < ht->min_base_size)
+        return ht;
     return ht_resize(ht, new_size);
 }
 
 
 /**
- * @brief Initializes the ht_items by allocating chunk of memory for
- * the exact `sizeof<struct Item>` while also taging the function as private
- * @private
- * @param constchar*  k represent the key for hashing and storing in the table
- * @param constchar*  v represent the value to be store after hashing the key <k>
+ * @brief copies a value and its NUL, a NULL value comes out as zeroed
+ * bytes the caller fills in place
  * */
-static inline Item *create_new_item(const char *k, const char *v)
+static inline void ht_copy_value(char *dst, const void *v, const size_t v_len)
 {
-    Item *item = malloc(sizeof(Item));
-    item->key = strdup(k);
-    item->value = strdup(v);
-    return item;
+    if (v != NULL)
+        memcpy(dst, v, v_len);
+    else
+        memset(dst, 0, v_len);
+    dst[v_len] = '\0';
 }
 
+/**
+ * @brief copies key and value into one block of the table arena,
+ * laid out as "key\0value\0". Borrowed-key tables point the item at
+ * the caller's key and only copy "value\0". Tables interning values
+ * copy "key\0" and point the item at the pooled value.
+ * @param Table* table owning the arena
+ * @param Item* item whose key/value pointers and lengths are set
+ * @param constvoid* k key to copy
+ * @param constsize_t bytes in k
+ * @param constvoid* v value to copy, NULL for zeroed bytes (not in tables interning values)
+ * @param constsize_t bytes in v
+ * */
+void ht_store_item_strings(Table *table, Item *item, const void *k, const size_t k_len, const void *v, const size_t v_len)
+{
+    item->key_len = (uint32_t)k_len;
+    item->value_len = (uint32_t)v_len;
+    // nodes of the default and cuckoo engines never move, so their strings
+    // can live in them; inline slots of other engines move on every rehash
+    item->is_inline = (table->engine == NULL || table->engine == &HT_CUCKOO_ENGINE) && !table->borrowed_keys &&
+                      k_len + v_len + 2 <= HT_ITEM_INLINE;
+    item->is_timed = 0;
+    if (item->is_inline)
+    {
+        memcpy(item->inline_bytes, k, k_len);
+        item->inline_bytes[k_len] = '\0';
+        ht_copy_value(item->inline_bytes + k_len + 1, v, v_len);
+        return;
+    }
+    if (table->values != NULL)
+    {
+        item->value = intern_acquire(table->values, v, v_len);
+        if (table->borrowed_keys)
+        {
+            item->key = (char *)k;
+            return;
+        }
+        item->key = arena_alloc(table->arena, k_len + 1);
+        memcpy(item->key, k, k_len);
+        item->key[k_len] = '\0';
+        return;
+    }
+    if (table->borrowed_keys)
+    {
+        item->key = (char *)k;
+        item->value = arena_alloc(table->arena, v_len + 1);
+        ht_copy_value(item->value, v, v_len);
+        return;
+    }
+    char *block = arena_alloc(table->arena, k_len + v_len + 2);
+    memcpy(block, k, k_len);
+    block[k_len] = '\0';
+    ht_copy_value(block + k_len + 1, v, v_len);
+    item->key = block;
+    item->value = block + k_len + 1;
+}
 
+/**
+ * @brief gives the key/value block of an item back to the table arena
+ * @param Table* table owning the arena
+ * @param Item* item whose strings are released
+ * */
+void ht_release_item_strings(Table *table, Item *item)
+{
+    if (item->is_inline)
+        return;
+    if (table->values != NULL)
+    {
+        intern_release(table->values, item->value);
+        if (!table->borrowed_keys)
+            arena_free(table->arena, item->key, item->key_len + 1);
+    }
+    else if (table->borrowed_keys)
+        arena_free(table->arena, item->value, item->value_len + 1);
+    else
+        arena_free(table->arena, item->key, item->key_len + item->value_len + 2);
+}
+
+/**
+ * @brief calls a callback on every item of a table. The default engine
+ * walks the slot array and, during an incremental resize, the buckets
+ * of the old array that are not migrated yet.
+ * @param Table* table to walk
+ * @param HtItemFn callback run once per item
+ * @param void* passed to the callback untouched
+ * */
+void ht_for_each_item(Table *table, HtItemFn fn, void *ctx)
+{
+    if (table->engine != NULL)
+    {
+        table->engine->each(table, fn, ctx);
+        return;
+    }
+    for (int i = 0; i < table->size; i++)
+    {
+        if (table->items[i] != NULL && table->items[i] != &HT_EMPTY_ITEM)
+            fn(table->items[i], ctx);
+    }
+    for (int i = table->rehash_idx; table->old_items != NULL && i < table->old_size; i++)
+    {
+        if (table->old_items[i] != NULL && table->old_items[i] != &HT_EMPTY_ITEM)
+            fn(table->old_items[i], ctx);
+    }
+}
 
+/**
+ * @brief Initializes the ht_items by taking a node from the table arena
+ * instead of a separate malloc, with key and value sharing a single block
+ * @private
+ * @param Table* table owning the arena
+ * @param constvoid*  k represent the key for hashing and storing in the table
+ * @param constsize_t bytes in <k>
+ * @param constvoid*  v represent the value to be store after hashing the key <k>
+ * @param constsize_t bytes in <v>
+ * @param constuint64_t hash of <k>, cached so the key is never hashed again
+ * @param constuint64_t clock value the item expires at, HT_NEVER_EXPIRES
+ * for none; a timed node carries its wheel timer after the item
+ * */
+static inline Item *create_new_item(Table *table, const void *k, const size_t k_len, const void *v, const size_t v_len, const uint64_t hash, const uint64_t expires)
+{
+    if (expires == HT_NEVER_EXPIRES)
+    {
+        Item *item = arena_alloc(table->arena, sizeof(Item));
+        ht_store_item_strings(table, item, k, k_len, v, v_len);
+        item->hash = hash;
+        if (table->filter != NULL)
+            ht_filter_add(table->filter, hash);
+        return item;
+    }
+    struct ht_timed_item *timed = arena_alloc(table->arena, sizeof(struct ht_timed_item));
+    ht_store_item_strings(table, &timed->item, k, k_len, v, v_len);
+    timed->item.hash = hash;
+    timed->item.is_timed = 1;
+    if (table->filter != NULL)
+        ht_filter_add(table->filter, hash);
+    timed->timer.expires = expires;
+    ht_timer_add(table->expiry, &timed->timer);
+    table->expiry->timed++;
+    return &timed->item;
+}
 
 /**
- * @brief deletes an existing hashtable node item from the heap
- * to prevent memory leaks
+ * @brief gives an existing hashtable node item and its strings back
+ * to the table arena
+ * @param Table* table owning the arena
  * @param Item* represents the current item to be freed
  * */
-static inline void delete_ht_item(Item *item)
+static inline void delete_ht_item(Table *table, Item *item)
 {
-    free(item->key);
-    free(item->value);
-    free(item);
+    ht_release_item_strings(table, item);
+    if (table->filter != NULL)
+        ht_filter_remove(table->filter, item->hash);
+    if (item->is_timed)
+    {
+        ht_timer_unlink(&ht_timed_item_of(item)->timer);
+        table->expiry->timed--;
+        arena_free(table->arena, item, sizeof(struct ht_timed_item));
+        return;
+    }
+    arena_free(table->arena, item, sizeof(Item));
 }
 
 /**
@@ -97,30 +346,142 @@ static inline void delete_ht_item(Item *item)
  * */
 void delete_Table(Table *table)
 {
-    for (int i = 0; i < table->size; i++)
+    // every node, key and value lives in the arena, no per item walk
+    if (table->engine != NULL)
+        table->engine->destroy(table);
+    pages_free(&table->pages, table->items, (size_t)table->size * sizeof(Item *));
+    pages_free(&table->pages, table->old_items, (size_t)table->old_size * sizeof(Item *));
+    ht_cache_destroy(table);
+    ht_expiry_destroy(table);
+    ht_filter_destroy(table);
+    intern_pool_destroy(table->values);
+    arena_destroy(table->arena);
+    free(table);
+}
+
+/**
+ * @brief number of buckets for a base size under a capacity policy
+ * @param constint one of `enum hash_table_capacity_policy`
+ * @param constint requested base size
+ * */
+static inline int ht_bucket_count(const int policy, const int base_size)
+{
+    if (policy == HT_CAPACITY_POW2)
     {
-        Item *item = table->items[i];
-        if (item != NULL)
-            delete_ht_item(item);
+        int size = 1;
+        while (size < base_size)
+            size <<= 1;
+        return size;
     }
-    free(table->items);
-    free(table);
+    return next_prime(base_size);
+}
+
+/**
+ * @brief base size under which a number of items stays within the
+ * 70% load the default engine grows at
+ * @param constint number of items
+ * */
+static inline int ht_base_size_for(const int items)
+{
+    const int base_size = (int)((int64_t)items * 100 / 70 + 1);
+    return base_size < HT_INITIAL_SIZE ? HT_INITIAL_SIZE : base_size;
+}
+
+/**
+ * @brief load of a slot array in percent, worked out in 64 bits as
+ * `count * 100` leaves int range past about 21.4M items
+ * @param constint64_t number of items, tombstones included when they count
+ * @param constint slots of the array
+ * */
+static inline int64_t ht_load_percent(const int64_t items, const int size)
+{
+    return items * 100 / size;
 }
 
 /**
  * @brief creates a sized hash table
- * @param int size represents the size of the hash table
- * @returns Table* represents the hash table
+ * @param int size represents the size of the hash table, unless the
+ * config asks for a capacity
+ * @param constTableConfig* hash function, seed, engine and capacity policy
+ * @returns Table* represents the hash table, NULL for an unknown engine
  * */
-static inline Table *ht_create_new_sized_table(const int base_size)
+static inline Table *ht_create_new_sized_table(const int base_size, const TableConfig *config)
 {
+    const struct ht_engine *engine = NULL;
+    switch (config->engine)
+    {
+    case HT_ENGINE_DOUBLE_HASH:
+        break;
+    case HT_ENGINE_SWISS:
+        engine = &HT_SWISS_ENGINE;
+        break;
+    case HT_ENGINE_ROBIN_HOOD:
+        engine = &HT_ROBIN_HOOD_ENGINE;
+        break;
+    case HT_ENGINE_CUCKOO:
+        engine = &HT_CUCKOO_ENGINE;
+        break;
+    default:
+        return NULL;
+    }
+    if (config->capacity_policy != HT_CAPACITY_PRIME && config->capacity_policy != HT_CAPACITY_POW2)
+        return NULL;
+    // a cache needs a known policy, a budget and the default engine
+    const bool cache = config->eviction != HT_EVICT_NONE;
+    if (cache && (engine != NULL || (config->eviction != HT_EVICT_CLOCK && config->eviction != HT_EVICT_SAMPLED_LRU) ||
+                  config->max_entries < 0 || (config->max_entries == 0 && config->max_bytes == 0)))
+        return NULL;
+    if (config->pages < HT_PAGES_DEFAULT || config->pages > HT_PAGES_HUGETLB || config->numa < HT_NUMA_DEFAULT ||
+        config->numa > HT_NUMA_BIND)
+        return NULL;
+    if (config->lookup_filter && engine != NULL)
+        return NULL;
+
     Table *table = malloc(sizeof(Table));
     if (table == NULL)
         exit(EXIT_FAILURE);
-    table->base_size = base_size;
-    table->size = next_prime(base_size);
+    table->hash = config->hash != NULL ? config->hash : ht_hash_wy;
+    table->seed = config->seed;
+    table->capacity_policy = config->capacity_policy;
+    table->engine = engine;
+    table->store = NULL;
+    table->pages = (struct page_policy){.pages = config->pages, .numa = config->numa, .node = config->numa_node};
+    table->arena = arena_new_paged(&table->pages);
+    table->incremental_resize = config->incremental_resize && !cache;
+    table->borrowed_keys = config->borrowed_keys;
+    table->values = config->intern_values ? intern_pool_new(table->arena, table->hash, table->seed) : NULL;
+    table->old_items = NULL;
+    table->old_size = 0;
+    table->rehash_idx = 0;
+    table->min_base_size = HT_INITIAL_SIZE;
+    table->cache = NULL;
+    table->expiry = NULL;
+    table->filter = NULL;
+    table->clock = config->clock != NULL ? config->clock : ht_clock_ms;
+    table->rehash_threads = config->rehash_threads < 1 ? 1 : config->rehash_threads;
+    if (table->rehash_threads > HT_REHASH_MAX_THREADS)
+        table->rehash_threads = HT_REHASH_MAX_THREADS;
+    table->layout_version = 0;
+    memset(&table->counters, 0, sizeof(table->counters));
+    if (engine != NULL)
+    {
+        engine->init(table, config->capacity > 0 ? config->capacity : base_size);
+        return table;
+    }
+    // a cache bounded by entries is sized once for them at half load, the
+    // other 20% up to the 70% it grows at absorb tombstones between rebuilds
+    const int cache_capacity = cache ? (int)((int64_t)config->max_entries * 7 / 5) : 0;
+    const int capacity = cache_capacity > config->capacity ? cache_capacity : config->capacity;
+    if (capacity > 0)
+        table->min_base_size = ht_base_size_for(capacity);
+    table->base_size = capacity > 0 ? table->min_base_size : base_size;
+    table->size = ht_bucket_count(table->capacity_policy, table->base_size);
     table->count = 0;
-    table->items = calloc((size_t)table->size, sizeof(Item *));
+    table->items = pages_alloc(&table->pages, (size_t)table->size * sizeof(Item *));
+    if (cache)
+        ht_cache_init(table, config);
+    if (config->lookup_filter)
+        ht_filter_rebuild(table);
     return table;
 }
 
@@ -130,70 +491,602 @@ static inline Table *ht_create_new_sized_table(const int base_size)
  * */
 Table *ht_new()
 {
-    return ht_create_new_sized_table(HT_INITIAL_SIZE);
+    const TableConfig defaults = {0};
+    return ht_create_new_sized_table(HT_INITIAL_SIZE, &defaults);
+}
+
+/**
+ * @brief Creates a new hash table with the hash function, seed,
+ * storage engine and capacity policy picked by the caller
+ * @param constTableConfig* options for the table, NULL for defaults
+ * @return Table* the new table, NULL for an unknown engine or policy
+ * */
+Table *ht_new_with_config(const TableConfig *config)
+{
+    if (config == NULL)
+        return ht_new();
+    return ht_create_new_sized_table(HT_INITIAL_SIZE, config);
 }
 
 /**
- * @brief F[X] Hash function used to create a hash value for the key
- * @param constchar* represents the key to be hashed
- * @param constint prime number to be used for creating the hash value
- * @param constint bucket size of hash table
+ * @brief Creates a new default table sized for a number of items, so
+ * filling it up to that number never resizes
+ * @param constint number of items to make room for
  * */
+Table *ht_new_with_capacity(const int items)
+{
+    const TableConfig config = {.capacity = items};
+    return ht_create_new_sized_table(HT_INITIAL_SIZE, &config);
+}
 
-static inline int ht_hash(const char *key, const int prime, const int bucket_size)
+/**
+ * @brief grows a table once so it holds a number of items without
+ * further resizes, instead of doubling its way there. The table does
+ * not shrink below the reservation when keys are deleted.
+ * @param Table* represents the current hash table
+ * @param constint number of items to make room for
+ * */
+Table *ht_reserve(Table *table, const int items)
 {
-    long hash = 0;
-    const int len_s = strlen(key);
-    for (int i = 0; i < len_s; i++) {
-        hash += (long)pow(prime, len_s - (i+1)) * key[i];
-        hash = hash % bucket_size;
+    if (table->engine != NULL)
+    {
+        table->engine->reserve(table, items);
+        return table;
+    }
+    const int base_size = ht_base_size_for(items);
+    if (base_size > table->min_base_size)
+        table->min_base_size = base_size;
+    if (ht_load_percent(items, table->size) > 70)
+        table = ht_resize(table, base_size);
+    return table;
+}
+
+void ht_scan_push(struct ht_scan_batch *batch, const Item *item)
+{
+    if (batch->count == batch->capacity)
+    {
+        batch->capacity = batch->capacity == 0 ? 64 : batch->capacity * 2;
+        batch->items = realloc(batch->items, batch->capacity * sizeof(Item));
+        if (batch->items == NULL)
+            exit(EXIT_FAILURE);
     }
-    return (int)hash;
+    batch->items[batch->count++] = *item;
 }
 
 /**
- * @brief retreives the index for a bucket after double hashing 
- * @param constchar* represents the key to be hashed
- * @param constint number of buckets in the hash table
- * @param constint attempts to find a free bucket
- **/
-static inline int ht_get_dhashidx(const char *key, const int bucket_size, const int attempt)
+ * @brief collects the items of a power-of-two slot array whose home is
+ * `home`. Linear probing put them all in the run from `home` to the
+ * first bucket never used, tombstones included.
+ * @return int buckets examined
+ * */
+static int ht_scan_run(Item **items, const int size, const int home, struct ht_scan_batch *batch)
 {
-    int hash_a = ht_hash(key, HT_PRIME_X, bucket_size);
-    int hash_b = ht_hash(key, HT_PRIME_Y, bucket_size);
-    if (hash_b % bucket_size == 0) {
-        hash_b = 1;
+    int examined = 0;
+    for (int idx = home; examined < size; idx = (idx + 1) & (size - 1))
+    {
+        const Item *item = items[idx];
+        examined++;
+        if (item == NULL)
+            break;
+        if (item != &HT_EMPTY_ITEM && (int)(item->hash & (uint64_t)(size - 1)) == home)
+            ht_scan_push(batch, item);
     }
-    return (hash_a + (attempt * (hash_b)) % bucket_size);
+    return examined;
 }
 
 /**
- * @brief inserts a new item into the hash table
+ * @brief scan of power-of-two tables, the home bucket of an item is the
+ * low bits of its hash. While a resize runs, the cursor bucket of the
+ * smaller array is walked with every bucket of the larger one it splits
+ * into, so items migrating between calls are seen in either array.
+ * */
+static uint64_t ht_scan_pow2(Table *table, uint64_t cursor, struct ht_scan_batch *batch, const int budget)
+{
+    Item **small = table->items, **large = NULL;
+    int small_size = table->size, large_size = 0;
+    if (table->old_items != NULL)
+    {
+        const bool grows = table->old_size < table->size;
+        small = grows ? table->old_items : table->items;
+        small_size = grows ? table->old_size : table->size;
+        large = grows ? table->items : table->old_items;
+        large_size = grows ? table->size : table->old_size;
+    }
+    const uint64_t m0 = (uint64_t)small_size - 1;
+    int examined = 0;
+    do
+    {
+        examined += ht_scan_run(small, small_size, (int)(cursor & m0), batch);
+        if (large != NULL)
+        {
+            const uint64_t m1 = (uint64_t)large_size - 1;
+            uint64_t v = cursor;
+            do
+            {
+                examined += ht_scan_run(large, large_size, (int)(v & m1), batch);
+                v = (((v | m0) + 1) & ~m0) | (v & m0);
+            } while (v & (m0 ^ m1));
+        }
+        cursor = ht_scan_next(cursor, m0);
+    } while (cursor != 0 && examined < budget);
+    return cursor;
+}
+
+/**
+ * @brief scan of prime tables. Double hashing gives items no home run
+ * to walk, so the cursor is a slot position tagged with the layout
+ * version; once items have moved since the last call the scan restarts
+ * and reports items again rather than miss one.
+ * */
+static uint64_t ht_scan_prime(Table *table, const uint64_t cursor, struct ht_scan_batch *batch, const int budget)
+{
+    const uint64_t tag = (uint64_t)((table->layout_version & 0x7FFFFFFFu) | 0x80000000u) << 32;
+    // positions [0, size) are in `items`, the next `old_size` in `old_items`
+    const uint64_t total = (uint64_t)table->size + (table->old_items != NULL ? (uint64_t)table->old_size : 0);
+    uint64_t pos = (cursor & 0xFFFFFFFF00000000ull) == tag ? cursor & 0xFFFFFFFFull : 0;
+    for (int examined = 0; pos < total && examined < budget; pos++, examined++)
+    {
+        const Item *item = pos < (uint64_t)table->size ? table->items[pos] : table->old_items[pos - (uint64_t)table->size];
+        if (item != NULL && item != &HT_EMPTY_ITEM)
+            ht_scan_push(batch, item);
+    }
+    return pos < total ? tag | pos : 0;
+}
+
+/**
+ * @brief Iterates a table a few buckets at a time, redis SCAN style.
+ * Start with cursor 0 and pass every returned cursor back in until 0
+ * comes out. Every item present from the first call to the last is
+ * reported at least once even if the table grows or shrinks in
+ * between; items may be reported more than once.
+ * Each call examines about `budget` slots (always whole home buckets)
+ * before it runs the callback on the items it found. The callback gets
+ * a copy valid for the call and may insert keys and delete the key it
+ * is given; deleting other keys frees strings that a later callback of
+ * the same call may still be handed.
  * @param Table* represents the current hash table
- * @param constchar* -key represents the key to be hashed
- * @param constchar* -value represents the value to be stored
+ * @param uint64_t cursor returned by the previous call, 0 to start
+ * @param HtItemFn callback run on every item found
+ * @param void* passed to the callback untouched
+ * @param int slots to examine, at least 1
+ * @return uint64_t cursor for the next call, 0 once the scan is complete
  * */
-Table *ht_insert(Table *table, const char *key, const char *value)
+uint64_t ht_scan(Table *table, uint64_t cursor, HtItemFn fn, void *ctx, int budget)
 {
-    const int load = table->count * 100 / table->size;
-    if (load > 70)
-        table = ht_resize_up(table);
+    struct ht_scan_batch batch = {0};
+    if (budget < 1)
+        budget = 1;
+    if (table->engine != NULL)
+        cursor = table->engine->scan(table, cursor, &batch, budget);
+    else if (table->capacity_policy == HT_CAPACITY_POW2)
+        cursor = ht_scan_pow2(table, cursor, &batch, budget);
+    else
+        cursor = ht_scan_prime(table, cursor, &batch, budget);
+    for (size_t i = 0; i < batch.count; i++)
+        fn(&batch.items[i], ctx);
+    free(batch.items);
+    return cursor;
+}
+
+/**
+ * @brief F[X] Hash function used to create a hash value for the key.
+ * Called once per operation, every probe reuses the result.
+ * @param constTable* table whose hash function and seed are used
+ * @param constvoid* represents the key to be hashed
+ * @param constsize_t bytes in the key
+ * */
+static inline uint64_t ht_hash(const Table *table, const void *key, const size_t key_len)
+{
+    return table->hash(key, key_len, table->seed);
+}
+
+/**
+ * @brief retreives the first bucket of the probe sequence of a hash.
+ * Prime tables take the low half of the hash modulo the bucket size,
+ * power-of-two tables mask the low bits and never divide.
+ * @param constTable* table whose capacity policy applies
+ * @param constuint64_t hash of the key
+ * @param constint number of buckets in the slot array
+ **/
+static inline int ht_probe_start(const Table *table, const uint64_t hash, const int bucket_size)
+{
+    if (table->capacity_policy == HT_CAPACITY_POW2)
+        return (int)(hash & (uint64_t)(bucket_size - 1));
+    return (int)((uint32_t)hash % (uint32_t)bucket_size);
+}
+
+/**
+ * @brief retreives the distance between two buckets of a probe sequence.
+ * Prime tables double hash with a step from the high half of the hash;
+ * since the bucket size is prime every step in [1, bucket_size - 1]
+ * visits every bucket. Power-of-two tables probe linearly, which visits
+ * every bucket as well and keeps each probe run in adjacent cache lines.
+ * @param constTable* table whose capacity policy applies
+ * @param constuint64_t hash of the key
+ * @param constint number of buckets in the slot array
+ **/
+static inline int ht_probe_step(const Table *table, const uint64_t hash, const int bucket_size)
+{
+    if (table->capacity_policy == HT_CAPACITY_POW2)
+        return 1;
+    return 1 + (int)((uint32_t)(hash >> 32) % (uint32_t)(bucket_size - 1));
+}
+
+/**
+ * @brief moves to the next bucket of a probe sequence, wrapping with a
+ * compare instead of a division since the step is below the bucket size
+ * @param constint current bucket
+ * @param constint step from `ht_probe_step`
+ * @param constint number of buckets in the slot array
+ **/
+static inline int ht_probe_next(const int idx, const int step, const int bucket_size)
+{
+    const int next = idx + step;
+    return next >= bucket_size ? next - bucket_size : next;
+}
 
-    int idx = ht_get_dhashidx(key, table->size, 0);
-    Item *item = create_new_item(key, value);
+/**
+ * @brief stores an item pointer in the first free bucket of its probe
+ * sequence, using the hash cached in the item
+ * @param Table* represents the current hash table
+ * @param Item* item to place
+ * @return int bucket the item went to
+ * */
+static inline int ht_place_item(Table *table, Item *item)
+{
+    int idx = ht_probe_start(table, item->hash, table->size);
+    const int step = ht_probe_step(table, item->hash, table->size);
     Item* old_item = table->items[idx];
-    int i = 1;
     while (old_item != NULL && !ht_cell_empty(old_item))
     {
-        idx = ht_get_dhashidx(key, table->size, i);
+        idx = ht_probe_next(idx, step, table->size);
         old_item = table->items[idx];
-        i++;
     }
+    // cache tables rebuild their slots by the tombstones left
+    if (old_item != NULL && table->cache != NULL)
+        table->cache->tombstones--;
     table->items[idx] = item;
+    return idx;
+}
+
+/**
+ * @brief first bucket of the probe sequence of a hash in the current
+ * slot array of a default engine table
+ * @param constTable* represents the current hash table
+ * @param constuint64_t hash of the key
+ * */
+int ht_home_slot(const Table *table, const uint64_t hash)
+{
+    return ht_probe_start(table, hash, table->size);
+}
+
+/**
+ * @brief stores an item pointer in the first free bucket of its probe
+ * sequence, as long as the probe stays within buckets [lo, hi). Threads
+ * placing items into disjoint ranges of one slot array never touch the
+ * same bucket; items left over are placed with `ht_place_new_item` once
+ * those threads are done. The table count is left to the caller.
+ * @param Table* represents the current hash table
+ * @param Item* item to place, its hash is cached
+ * @param constint first bucket of the range
+ * @param constint bucket past the range
+ * @return bool false when the probe left the range, the item is not placed
+ * */
+bool ht_place_item_in_range(Table *table, Item *item, const int lo, const int hi)
+{
+    int idx = ht_probe_start(table, item->hash, table->size);
+    const int step = ht_probe_step(table, item->hash, table->size);
+    while (idx >= lo && idx < hi)
+    {
+        if (table->items[idx] == NULL || ht_cell_empty(table->items[idx]))
+        {
+            table->items[idx] = item;
+            return true;
+        }
+        idx = ht_probe_next(idx, step, table->size);
+    }
+    return false;
+}
+
+/**
+ * @brief stores an item pointer in the first free bucket of its probe
+ * sequence without growing the table, the table count is left to the caller
+ * @param Table* represents the current hash table
+ * @param Item* item to place, its hash is cached
+ * */
+void ht_place_new_item(Table *table, Item *item)
+{
+    ht_place_item(table, item);
+}
+
+/**
+ * @brief looks a key up in one slot array
+ * @param constTable* table whose capacity policy applies
+ * @param Item** slot array to probe
+ * @param constint number of buckets in the slot array
+ * @param constvoid* key to look for
+ * @param constsize_t bytes in the key
+ * @param constuint64_t hash of the key
+ * @param int* slots examined are added to it in HT_STATS builds
+ * @return int index of the item holding key or -1
+ * */
+static inline int ht_find_slot(const Table *table, Item **items, const int size, const void *key, const size_t key_len, const uint64_t hash, int *probes)
+{
+    int idx = ht_probe_start(table, hash, size);
+    const int step = ht_probe_step(table, hash, size);
+    Item *item = items[idx];
+    HT_STATS_ONLY(int probe = 1;)
+    while (item != NULL)
+    {
+        if (item != &HT_EMPTY_ITEM && ht_item_matches(item, key, key_len, hash))
+        {
+            HT_STATS_ONLY(*probes += probe;)
+            return idx;
+        }
+        idx = ht_probe_next(idx, step, size);
+        item = items[idx];
+        HT_STATS_ONLY(probe++;)
+    }
+    HT_STATS_ONLY(*probes += probe;)
+    (void)probes;
+    return -1;
+}
+
+/**
+ * @brief places a new item for an already hashed key
+ * @param Table* represents the current hash table
+ * @param constvoid* -key represents the key to be stored
+ * @param constsize_t bytes in -key
+ * @param constvoid* -value represents the value to be stored
+ * @param constsize_t bytes in -value
+ * @param constuint64_t hash of -key
+ * @param constuint64_t clock value the entry expires at or HT_NEVER_EXPIRES
+ * */
+static inline void ht_insert_hashed(Table *table, const void *key, const size_t key_len, const void *value, const size_t value_len, const uint64_t hash, const uint64_t expires)
+{
+    ht_place_item(table, create_new_item(table, key, key_len, value, value_len, hash, expires));
     table->count++;
+}
+
+/**
+ * @brief evicts entries of a cache table chosen by its policy until one
+ * more entry of the given bytes fits its budgets
+ * @param Table* represents the current cache table
+ * @param constsize_t bytes of the entry to make room for
+ * */
+static void ht_cache_make_room(Table *table, const size_t bytes)
+{
+    struct hash_table_cache *cache = table->cache;
+    while (table->count > 0 &&
+           ((cache->max_entries > 0 && table->count >= cache->max_entries) ||
+            (cache->max_bytes > 0 && cache->bytes + bytes > cache->max_bytes)))
+    {
+        const int idx = ht_cache_victim(table);
+        Item *item = table->items[idx];
+        if (cache->on_evict != NULL)
+            cache->on_evict(item, cache->evict_ctx);
+        ht_cache_forget(table, item, idx);
+        delete_ht_item(table, item);
+        table->items[idx] = &HT_EMPTY_ITEM;
+        table->count--;
+        cache->evictions++;
+    }
+}
+
+/**
+ * @brief stores an entry in a cache table, replacing the entry of the
+ * same key and evicting others until it fits the budgets. Evictions leave
+ * tombstones in a slot array that no longer grows, so it is rebuilt at
+ * its size once entries and tombstones fill 70% of it, the load other
+ * tables grow at, which keeps misses short.
+ * @param Table* represents the current cache table
+ * @param constvoid* -key represents the key to be stored
+ * @param constsize_t bytes in -key
+ * @param constvoid* -value represents the value to be stored
+ * @param constsize_t bytes in -value
+ * @param constuint64_t hash of -key
+ * @param constuint64_t clock value the entry expires at or HT_NEVER_EXPIRES
+ * */
+static Table *ht_cache_insert(Table *table, const void *key, const size_t key_len, const void *value, const size_t value_len, const uint64_t hash, const uint64_t expires)
+{
+    ht_delete_entry(table, key, key_len, hash);
+    Item *item = create_new_item(table, key, key_len, value, value_len, hash, expires);
+    const size_t bytes = ht_cache_item_bytes(table, item);
+    // an entry larger than the whole byte budget is not cached
+    if (table->cache->max_bytes > 0 && bytes > table->cache->max_bytes)
+    {
+        delete_ht_item(table, item);
+        return table;
+    }
+    ht_cache_make_room(table, bytes);
+    const unsigned int layout = table->layout_version;
+    if (ht_load_percent(table->count, table->size) > 70)
+        table = ht_resize_up(table);
+    else if (ht_load_percent((int64_t)table->count + table->cache->tombstones, table->size) > 70)
+        table = ht_resize(table, table->base_size);
+    // a filter rebuilt by the resize counts the items in the slots, the
+    // new one is not placed yet
+    if (table->filter != NULL && table->layout_version != layout)
+        ht_filter_add(table->filter, hash);
+    ht_cache_admit(table, item, ht_place_item(table, item));
+    table->count++;
+    return table;
+}
+
+/**
+ * @brief inserts a new item for a hashed key of any length, every
+ * public insert ends up here
+ * @param Table* represents the current hash table
+ * @param constvoid* -key represents the key to be stored
+ * @param constsize_t bytes in -key
+ * @param constvoid* -value represents the value to be stored
+ * @param constsize_t bytes in -value
+ * @param constuint64_t hash of -key
+ * @param constuint64_t clock value the entry expires at or HT_NEVER_EXPIRES
+ * */
+static inline Table *ht_insert_entry(Table *table, const void *key, const size_t key_len, const void *value, const size_t value_len, const uint64_t hash, const uint64_t expires)
+{
+    // items keep 32-bit key and 30-bit value lengths
+    if (key_len > HT_ITEM_MAX_KEY || value_len > HT_ITEM_MAX_VALUE)
+        return table;
+    if (table->engine != NULL)
+    {
+        table->engine->insert(table, key, key_len, value, value_len, hash);
+        return table;
+    }
+    if (table->cache != NULL)
+        return ht_cache_insert(table, key, key_len, value, value_len, hash, expires);
+    if (table->old_items != NULL)
+        ht_rehash_step(table, HT_REHASH_STEP);
+    if (ht_load_percent(table->count, table->size) > 70)
+        table = ht_resize_up(table);
+
+    ht_insert_hashed(table, key, key_len, value, value_len, hash, expires);
     return table;
 }
 
+/**
+ * @brief inserts a new item into the hash table
+ * @param Table* represents the current hash table
+ * @param constchar* -key represents the key to be hashed
+ * @param constchar* -value represents the value to be stored
+ * */
+Table *ht_insert(Table *table, const char *key, const char *value)
+{
+    const size_t key_len = strlen(key);
+    return ht_insert_entry(table, key, key_len, value, strlen(value), ht_hash(table, key, key_len), HT_NEVER_EXPIRES);
+}
+
+/**
+ * @brief inserts a new item whose key the caller already hashed with
+ * the table's hash function and seed
+ * @param Table* represents the current hash table
+ * @param constchar* -key represents the key to be stored
+ * @param constchar* -value represents the value to be stored
+ * @param constuint64_t hash of -key
+ * */
+Table *ht_insert_with_hash(Table *table, const char *key, const char *value, const uint64_t hash)
+{
+    return ht_insert_entry(table, key, strlen(key), value, strlen(value), hash, HT_NEVER_EXPIRES);
+}
+
+/**
+ * @brief inserts a key and a value given as byte ranges, both may
+ * contain NUL bytes
+ * @param Table* represents the current hash table
+ * @param constvoid* -key first byte of the key
+ * @param constsize_t bytes in -key
+ * @param constvoid* -value first byte of the value
+ * @param constsize_t bytes in -value
+ * */
+Table *ht_insert_bytes(Table *table, const void *key, const size_t key_len, const void *value, const size_t value_len)
+{
+    return ht_insert_entry(table, key, key_len, value, value_len, ht_hash(table, key, key_len), HT_NEVER_EXPIRES);
+}
+
+/**
+ * @brief inserts an item that expires after a number of milliseconds of
+ * the table clock. Expired items are absent for `ht_find` straight away
+ * and reclaimed by the lookup that meets them or by the timer wheel,
+ * which every TTL insert and `ht_expire` advance. Other engines than the
+ * default one store the item without a timer, it never expires.
+ * @param Table* represents the current hash table
+ * @param constchar* -key represents the key to be stored
+ * @param constchar* -value represents the value to be stored
+ * @param constuint64_t milliseconds the item lives for
+ * */
+Table *ht_insert_with_ttl(Table *table, const char *key, const char *value, const uint64_t ttl_ms)
+{
+    // slots of other engines move, a timer cannot point at them
+    if (table->engine != NULL)
+        return ht_insert(table, key, value);
+    if (table->expiry == NULL)
+        ht_expiry_init(table);
+    const uint64_t now = table->clock();
+    ht_expiry_advance(table, now, HT_EXPIRE_STEP);
+    const uint64_t expires = ttl_ms < HT_NEVER_EXPIRES - now ? now + ttl_ms : HT_NEVER_EXPIRES - 1;
+    const size_t key_len = strlen(key);
+    return ht_insert_entry(table, key, key_len, value, strlen(value), ht_hash(table, key, key_len), expires);
+}
+
+/**
+ * @brief reclaims expired items in a bounded slice: the timer wheel
+ * ticks towards the table clock until it has examined about `budget`
+ * timers and ticks. Call it periodically, a large expiry spreads over
+ * as many calls as it needs.
+ * @param Table* represents the current hash table
+ * @param int timers and ticks to examine at most
+ * @return int items reclaimed
+ * */
+int ht_expire(Table *table, int budget)
+{
+    if (table->expiry == NULL)
+        return 0;
+    return ht_expiry_advance(table, table->clock(), budget);
+}
+
+/**
+ * @brief finds the item of a hashed key of any length, every public
+ * lookup ends up here
+ * @param Table* represents the current hash table
+ * @param constvoid* -key represents the key to look for
+ * @param constsize_t bytes in -key
+ * @param constuint64_t hash of -key
+ * @return Item* the item holding -key or NULL
+ * */
+static inline Item *ht_find_entry(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    if (table->engine != NULL)
+        return table->engine->find(table, key, key_len, hash);
+    if (table->old_items != NULL)
+        ht_rehash_step(table, HT_REHASH_STEP);
+    // the filter holds the items of both slot arrays during a migration.
+    // The first bucket is fetched meanwhile, so hits do not wait for the
+    // filter line before they start probing.
+    if (table->filter != NULL)
+        __builtin_prefetch(&table->items[ht_probe_start(table, hash, table->size)]);
+    if (table->filter != NULL && !ht_filter_may_contain(table->filter, hash))
+    {
+        HT_STATS_ONLY(HT_STATS_ADD(table->counters.filter_rejects, 1);)
+        return NULL;
+    }
+    int probes = 0;
+    int idx = ht_find_slot(table, table->items, table->size, key, key_len, hash, &probes);
+    // an expired item is absent, the lookup reclaims it and looks again
+    while (idx >= 0 && ht_item_expired(table, table->items[idx]))
+    {
+        ht_remove_item(table, table->items[idx]);
+        table->expiry->expired++;
+        idx = ht_find_slot(table, table->items, table->size, key, key_len, hash, &probes);
+    }
+    if (idx >= 0)
+    {
+        HT_STATS_ONLY(ht_stats_record_probe(table, true, probes);)
+        if (table->cache != NULL)
+            ht_cache_touch(table->cache, idx);
+        return table->items[idx];
+    }
+    // keys not migrated yet are still in the old slot array
+    if (table->old_items != NULL)
+    {
+        idx = ht_find_slot(table, table->old_items, table->old_size, key, key_len, hash, &probes);
+        while (idx >= 0 && ht_item_expired(table, table->old_items[idx]))
+        {
+            ht_remove_item(table, table->old_items[idx]);
+            table->expiry->expired++;
+            idx = ht_find_slot(table, table->old_items, table->old_size, key, key_len, hash, &probes);
+        }
+        if (idx >= 0)
+        {
+            HT_STATS_ONLY(ht_stats_record_probe(table, true, probes);)
+            return table->old_items[idx];
+        }
+    }
+    HT_STATS_ONLY(ht_stats_record_probe(table, false, probes);)
+    HT_STATS_ONLY(HT_STATS_ADD(table->counters.filter_false_positives, table->filter != NULL);)
+    return NULL;
+}
+
 /**
  * @brief Finds an item in the hash table
  * @param Table* represents the current hash table
@@ -202,21 +1095,268 @@ Table *ht_insert(Table *table, const char *key, const char *value)
  * */
 char *ht_find(Table *table, const char *key)
 {
-    int idx = ht_get_dhashidx(key, table->size, 0);
-    Item *item = table->items[idx];
-    int i = 1;
-    while (item != NULL)
+    const size_t key_len = strlen(key);
+    Item *item = ht_find_entry(table, key, key_len, ht_hash(table, key, key_len));
+    return item != NULL ? ht_item_value(item) : NULL;
+}
+
+/**
+ * @brief Finds an item whose key the caller already hashed
+ * @param Table* represents the current hash table
+ * @param constchar* -key represents the key to look for
+ * @param constuint64_t hash of -key
+ * */
+char *ht_find_with_hash(Table *table, const char *key, const uint64_t hash)
+{
+    Item *item = ht_find_entry(table, key, strlen(key), hash);
+    return item != NULL ? ht_item_value(item) : NULL;
+}
+
+/**
+ * @brief Finds a key given as a byte range
+ * @param Table* represents the current hash table
+ * @param constvoid* -key first byte of the key
+ * @param constsize_t bytes in -key
+ * @param size_t* receives the length of the value when found, may be NULL
+ * @return char* the value, followed by a NUL, or NULL
+ * */
+char *ht_find_bytes(Table *table, const void *key, const size_t key_len, size_t *value_len)
+{
+    Item *item = ht_find_entry(table, key, key_len, ht_hash(table, key, key_len));
+    if (item == NULL)
+        return NULL;
+    if (value_len != NULL)
+        *value_len = item->value_len;
+    return ht_item_value(item);
+}
+
+/**
+ * @brief looks up one group of at most HT_BATCH_GROUP keys in interleaved
+ * rounds: every round issues the next dependent load of all keys as a
+ * prefetch before any key waits on it, so the cache misses of the group
+ * overlap instead of being paid one after another
+ * @param Table* represents the current hash table
+ * @param constchar** keys to look for
+ * @param constint number of keys, at most HT_BATCH_GROUP
+ * @param char** receives the value of each key or NULL
+ * */
+static void ht_find_group(Table *table, const char **keys, const int n, char **values)
+{
+    uint64_t hashes[HT_BATCH_GROUP];
+    size_t lens[HT_BATCH_GROUP];
+    int slots[HT_BATCH_GROUP];
+    Item *items[HT_BATCH_GROUP];
+    // round 1: hash every key and prefetch its first bucket, or its filter
+    // block when the table has a filter
+    for (int i = 0; i < n; i++)
+    {
+        lens[i] = strlen(keys[i]);
+        hashes[i] = ht_hash(table, keys[i], lens[i]);
+        slots[i] = ht_probe_start(table, hashes[i], table->size);
+        if (table->filter != NULL)
+            __builtin_prefetch(ht_filter_block(table->filter, hashes[i]));
+        else
+            __builtin_prefetch(&table->items[slots[i]]);
+    }
+    // round 1b: keys the filter rejects get no slot, the others have
+    // their first bucket prefetched
+    if (table->filter != NULL)
     {
-        if (item != &HT_EMPTY_ITEM)
+        for (int i = 0; i < n; i++)
         {
-            if (strcmp(item->key, key) == 0)
-                return item->value;
+            if (ht_filter_may_contain(table->filter, hashes[i]))
+                __builtin_prefetch(&table->items[slots[i]]);
+            else
+                slots[i] = -1;
         }
-        idx = ht_get_dhashidx(key, table->size, i);
-        item = table->items[idx];
-        i++;
     }
-    return NULL;
+    // round 2: load the buckets and prefetch the item nodes
+    for (int i = 0; i < n; i++)
+    {
+        items[i] = slots[i] >= 0 ? table->items[slots[i]] : NULL;
+        if (items[i] != NULL && items[i] != &HT_EMPTY_ITEM)
+            __builtin_prefetch(items[i]);
+    }
+    // round 3: prefetch the key bytes of nodes whose cached hash matches,
+    // inline keys came in with the node
+    for (int i = 0; i < n; i++)
+    {
+        if (items[i] != NULL && items[i] != &HT_EMPTY_ITEM && items[i]->hash == hashes[i] && !items[i]->is_inline)
+            __builtin_prefetch(items[i]->key);
+    }
+    // round 4: resolve, the first probe of every key is now in cache
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = NULL;
+        if (slots[i] < 0)
+        {
+            HT_STATS_ONLY(HT_STATS_ADD(table->counters.filter_rejects, 1);)
+            continue;
+        }
+        if (items[i] == NULL)
+        {
+            HT_STATS_ONLY(ht_stats_record_probe(table, false, 1);)
+            HT_STATS_ONLY(HT_STATS_ADD(table->counters.filter_false_positives, table->filter != NULL);)
+            continue;
+        }
+        int probes = 0;
+        const int idx = ht_find_slot(table, table->items, table->size, keys[i], lens[i], hashes[i], &probes);
+        HT_STATS_ONLY(ht_stats_record_probe(table, idx >= 0, probes);)
+        HT_STATS_ONLY(HT_STATS_ADD(table->counters.filter_false_positives, idx < 0 && table->filter != NULL);)
+        if (idx < 0)
+            continue;
+        if (table->cache != NULL)
+            ht_cache_touch(table->cache, idx);
+        values[i] = ht_item_value(table->items[idx]);
+    }
+}
+
+/**
+ * @brief Finds many keys at once. Equivalent to calling `ht_find` on each
+ * key, but the default engine hashes and prefetches the keys in groups of
+ * HT_BATCH_GROUP so lookups on tables larger than the cache overlap their misses.
+ * @param Table* represents the current hash table
+ * @param constchar** keys to look for
+ * @param constint number of keys
+ * @param char** receives the value of each key or NULL, one per key
+ * */
+void ht_find_batch(Table *table, const char **keys, const int n, char **values)
+{
+    if (table->engine != NULL || table->old_items != NULL || table->expiry != NULL)
+    {
+        // other engines, running migrations and expiring items take the plain path
+        for (int i = 0; i < n; i++)
+            values[i] = ht_find(table, keys[i]);
+        return;
+    }
+    for (int i = 0; i < n; i += HT_BATCH_GROUP)
+    {
+        // the next group hashes its keys first, fetch their bytes meanwhile
+        for (int j = i + HT_BATCH_GROUP; j < n && j < i + 2 * HT_BATCH_GROUP; j++)
+            __builtin_prefetch(keys[j]);
+        ht_find_group(table, keys + i, n - i < HT_BATCH_GROUP ? n - i : HT_BATCH_GROUP, values + i);
+    }
+}
+
+/**
+ * @brief inserts many key/value pairs at once. The slot array of a table
+ * that is not a cache is grown once for the whole batch up front, then
+ * the keys are hashed and their buckets prefetched a group at a time
+ * before the items are placed.
+ * @param Table* represents the current hash table
+ * @param constchar** keys to store
+ * @param constchar** values to store, one per key
+ * @param constint number of pairs
+ * */
+Table *ht_insert_batch(Table *table, const char **keys, const char **values, const int n)
+{
+    // caches evict down to their budget instead of growing for the batch
+    if (table->engine == NULL && !table->incremental_resize && table->cache == NULL)
+    {
+        while (ht_load_percent((int64_t)table->count + n, table->size) > 70)
+            table = ht_resize_up(table);
+    }
+    uint64_t hashes[HT_BATCH_GROUP];
+    size_t lens[HT_BATCH_GROUP];
+    for (int i = 0; i < n; i += HT_BATCH_GROUP)
+    {
+        const int group = n - i < HT_BATCH_GROUP ? n - i : HT_BATCH_GROUP;
+        for (int j = 0; j < group; j++)
+        {
+            lens[j] = strlen(keys[i + j]);
+            hashes[j] = ht_hash(table, keys[i + j], lens[j]);
+            if (table->engine == NULL)
+                __builtin_prefetch(&table->items[ht_probe_start(table, hashes[j], table->size)], 1);
+        }
+        for (int j = 0; j < group; j++)
+            table = ht_insert_entry(table, keys[i + j], lens[j], values[i + j], strlen(values[i + j]), hashes[j], HT_NEVER_EXPIRES);
+    }
+    return table;
+}
+
+/**
+ * @brief deletes every item of a hashed key of any length, every
+ * public delete ends up here
+ * @param Table* represents the current hash table
+ * @param constvoid* -key represents the key to delete
+ * @param constsize_t bytes in -key
+ * @param constuint64_t hash of -key
+ * */
+static inline void ht_delete_entry(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    if (table->engine != NULL)
+    {
+        table->engine->remove(table, key, key_len, hash);
+        return;
+    }
+    if (table->old_items != NULL)
+        ht_rehash_step(table, HT_REHASH_STEP);
+    if (ht_load_percent(table->count, table->size) < 10)
+        ht_resize_down(table);
+    if (table->filter != NULL && !ht_filter_may_contain(table->filter, hash))
+        return;
+    int idx, probes = 0;
+    while ((idx = ht_find_slot(table, table->items, table->size, key, key_len, hash, &probes)) >= 0)
+    {
+        if (table->cache != NULL)
+            ht_cache_forget(table, table->items[idx], idx);
+        delete_ht_item(table, table->items[idx]);
+        table->items[idx] = &HT_EMPTY_ITEM;
+        table->count--;
+    }
+    while (table->old_items != NULL &&
+           (idx = ht_find_slot(table, table->old_items, table->old_size, key, key_len, hash, &probes)) >= 0)
+    {
+        delete_ht_item(table, table->old_items[idx]);
+        table->old_items[idx] = &HT_EMPTY_ITEM;
+        table->count--;
+    }
+}
+
+/**
+ * @brief finds the slot holding an item in one slot array by following
+ * the probe sequence of its cached hash
+ * @param constTable* table whose capacity policy applies
+ * @param Item** slot array to probe
+ * @param constint number of buckets in the slot array
+ * @param constItem* item to look for
+ * @return int index of the item or -1
+ * */
+static inline int ht_find_item_slot(const Table *table, Item **items, const int size, const Item *item)
+{
+    int idx = ht_probe_start(table, item->hash, size);
+    const int step = ht_probe_step(table, item->hash, size);
+    while (items[idx] != NULL)
+    {
+        if (items[idx] == item)
+            return idx;
+        idx = ht_probe_next(idx, step, size);
+    }
+    return -1;
+}
+
+/**
+ * @brief deletes one item of a default engine table found by address,
+ * keys stored more than once keep their other items
+ * @param Table* represents the current hash table
+ * @param Item* item stored in the table
+ * */
+void ht_remove_item(Table *table, Item *item)
+{
+    Item **items = table->items;
+    int idx = ht_find_item_slot(table, items, table->size, item);
+    if (idx < 0 && table->old_items != NULL)
+    {
+        items = table->old_items;
+        idx = ht_find_item_slot(table, items, table->old_size, item);
+    }
+    if (idx < 0)
+        return;
+    if (table->cache != NULL)
+        ht_cache_forget(table, item, idx);
+    delete_ht_item(table, item);
+    items[idx] = &HT_EMPTY_ITEM;
+    table->count--;
 }
 
 /**
@@ -226,25 +1366,384 @@ char *ht_find(Table *table, const char *key)
  * */
 void ht_delete(Table *table, const char *key)
 {
-    const int load = table->count * 100 / table->size;
-    if (load < 10)
-        ht_resize_down(table);
-    int idx = ht_get_dhashidx(key, table->size, 0);
-    Item *item = table->items[idx];
-    int i = 1;
+    const size_t key_len = strlen(key);
+    ht_delete_entry(table, key, key_len, ht_hash(table, key, key_len));
+}
+
+/**
+ * @brief deletes an item whose key the caller already hashed
+ * @param Table* represents the current hash table
+ * @param constchar* -key represents the key to delete
+ * @param constuint64_t hash of -key
+ * */
+void ht_delete_with_hash(Table *table, const char *key, const uint64_t hash)
+{
+    ht_delete_entry(table, key, strlen(key), hash);
+}
+
+/**
+ * @brief deletes a key given as a byte range
+ * @param Table* represents the current hash table
+ * @param constvoid* -key first byte of the key
+ * @param constsize_t bytes in -key
+ * */
+void ht_delete_bytes(Table *table, const void *key, const size_t key_len)
+{
+    ht_delete_entry(table, key, key_len, ht_hash(table, key, key_len));
+}
+
+/**
+ * @brief looks a key up in one slot array in the probe pass an insert of
+ * it would take, remembering the first free bucket on the way: a
+ * tombstone, or the empty bucket that ends the probe
+ * @param constTable* table whose capacity policy applies
+ * @param Item** slot array to probe
+ * @param constint number of buckets in the slot array
+ * @param constvoid* key to look for
+ * @param constsize_t bytes in the key
+ * @param constuint64_t hash of the key
+ * @param constbool compare keys, false when the filter ruled the key out
+ * @param int* receives the first free bucket
+ * @param int* slots examined are added to it in HT_STATS builds
+ * @return int index of the item holding key or -1
+ * */
+static inline int ht_find_slot_or_free(const Table *table, Item **items, const int size, const void *key, const size_t key_len, const uint64_t hash, const bool compare, int *free_idx, int *probes)
+{
+    int idx = ht_probe_start(table, hash, size);
+    const int step = ht_probe_step(table, hash, size);
+    Item *item = items[idx];
+    *free_idx = -1;
+    HT_STATS_ONLY(int probe = 1;)
     while (item != NULL)
     {
-        if (item != &HT_EMPTY_ITEM)
+        if (item == &HT_EMPTY_ITEM)
         {
-            if (strcmp(item->key, key) == 0)
-            {
-                delete_ht_item(item);
-                table->items[idx] = &HT_EMPTY_ITEM;
-            }
+            if (*free_idx < 0)
+                *free_idx = idx;
+        }
+        else if (compare && ht_item_matches(item, key, key_len, hash))
+        {
+            HT_STATS_ONLY(*probes += probe;)
+            return idx;
         }
-        idx = ht_get_dhashidx(key, table->size, i);
-        item = table->items[idx];
-        i++;
+        idx = ht_probe_next(idx, step, size);
+        item = items[idx];
+        HT_STATS_ONLY(probe++;)
     }
-    table->count--;
+    if (*free_idx < 0)
+        *free_idx = idx;
+    HT_STATS_ONLY(*probes += probe;)
+    (void)probes;
+    return -1;
+}
+
+/**
+ * @brief fills an entry of a default engine table in one probe pass over
+ * each slot array, reclaiming an expired item of the key on the way
+ * @param TableEntry* entry whose table, key and hash are set
+ * */
+static inline void ht_entry_locate(TableEntry *entry)
+{
+    Table *table = entry->table;
+    const bool compare = table->filter == NULL || ht_filter_may_contain(table->filter, entry->hash);
+    int idx, probes = 0;
+    for (;;)
+    {
+        Item *item = NULL;
+        idx = ht_find_slot_or_free(table, table->items, table->size, entry->key, entry->key_len, entry->hash, compare, &entry->slot, &probes);
+        if (idx >= 0)
+            item = table->items[idx];
+        // keys not migrated yet are still in the old slot array
+        else if (compare && table->old_items != NULL &&
+                 (idx = ht_find_slot(table, table->old_items, table->old_size, entry->key, entry->key_len, entry->hash, &probes)) >= 0)
+            item = table->old_items[idx];
+        if (item == NULL || !ht_item_expired(table, item))
+        {
+            entry->item = item;
+            break;
+        }
+        ht_remove_item(table, item);
+        table->expiry->expired++;
+    }
+    if (!compare)
+    {
+        HT_STATS_ONLY(HT_STATS_ADD(table->counters.filter_rejects, 1);)
+        return;
+    }
+    HT_STATS_ONLY(ht_stats_record_probe(table, entry->item != NULL, probes);)
+    HT_STATS_ONLY(HT_STATS_ADD(table->counters.filter_false_positives, entry->item == NULL && table->filter != NULL);)
+}
+
+/**
+ * @brief finds the entry of a key given as a byte range
+ * @param Table* represents the current hash table
+ * @param constvoid* -key first byte of the key, kept alive by the caller
+ * until the entry is set
+ * @param constsize_t bytes in -key
+ * @return TableEntry occupied by the item of -key, or vacant
+ * */
+TableEntry ht_entry_bytes(Table *table, const void *key, const size_t key_len)
+{
+    TableEntry entry = {.table = table, .item = NULL, .key = key, .key_len = key_len, .slot = -1};
+    entry.hash = ht_hash(table, key, key_len);
+    if (key_len > HT_ITEM_MAX_KEY)
+        return entry;
+    // other engines and caches find the item the usual way, setting a
+    // vacant entry goes through their insert
+    if (table->engine != NULL || table->cache != NULL)
+    {
+        entry.item = ht_find_entry(table, key, key_len, entry.hash);
+        return entry;
+    }
+    if (table->old_items != NULL)
+        ht_rehash_step(table, HT_REHASH_STEP);
+    ht_entry_locate(&entry);
+    return entry;
+}
+
+/**
+ * @brief finds the entry of a key with a single probe pass: the item
+ * stored for it, or the slot storing it would take. Read the value of an
+ * occupied entry with `ht_item_value(entry.item)`, fill either kind with
+ * `ht_entry_set`.
+ * @param Table* represents the current hash table
+ * @param constchar* -key represents the key to look for, kept alive by
+ * the caller until the entry is set
+ * @return TableEntry occupied by the item of -key, or vacant
+ * */
+TableEntry ht_entry(Table *table, const char *key)
+{
+    return ht_entry_bytes(table, key, strlen(key));
+}
+
+/**
+ * @brief replaces the value of a stored item. A value that takes the same
+ * arena block size as the old one, or still fits the node, is written
+ * over the old bytes; otherwise the key moves to a block sized for the
+ * new value. The item keeps its node, its slot and its TTL.
+ * @param Table* table owning the item
+ * @param Item* item to update
+ * @param constvoid* new value, NULL for zeroed bytes
+ * @param constsize_t bytes in the new value
+ * @return char* the stored value
+ * */
+static char *ht_item_replace_value(Table *table, Item *item, const void *value, const size_t value_len)
+{
+    if (item->is_inline && item->key_len + value_len + 2 <= HT_ITEM_INLINE)
+    {
+        ht_copy_value(item->inline_bytes + item->key_len + 1, value, value_len);
+        item->value_len = (uint32_t)value_len;
+        return ht_item_value(item);
+    }
+    // "key\0value\0" blocks, or "value\0" ones for borrowed keys
+    const size_t fixed = table->borrowed_keys ? 1 : item->key_len + 2;
+    if (!item->is_inline && table->values == NULL && arena_round(fixed + item->value_len) == arena_round(fixed + value_len))
+    {
+        ht_copy_value(item->value, value, value_len);
+        item->value_len = (uint32_t)value_len;
+        return item->value;
+    }
+    // the old strings are released once the key is copied out of them
+    Item old = *item;
+    ht_store_item_strings(table, item, ht_item_key(&old), old.key_len, value, value_len);
+    item->is_timed = old.is_timed;
+    ht_release_item_strings(table, &old);
+    return ht_item_value(item);
+}
+
+/**
+ * @brief stores a value for the key of an entry: an occupied entry has its
+ * value replaced in place, a vacant one gets a new item in the slot its
+ * lookup found, unless the table has to grow first. Mapped images and
+ * caches store the entry anew. The entry is occupied afterwards and
+ * stays usable for reading or setting again.
+ * @param TableEntry* entry returned by `ht_entry` on an unchanged table
+ * @param constvoid* -value bytes to store, NULL to store -value_len zeroed
+ * bytes and write them through the returned pointer (not for tables
+ * interning values, whose values are shared)
+ * @param constsize_t bytes in -value
+ * @return char* the stored value followed by a NUL, NULL when nothing
+ * was stored
+ * */
+char *ht_entry_set(TableEntry *entry, const void *value, const size_t value_len)
+{
+    Table *table = entry->table;
+    if (entry->key_len > HT_ITEM_MAX_KEY || value_len > HT_ITEM_MAX_VALUE || (value == NULL && table->values != NULL))
+        return NULL;
+    // the mmap engine hands out copies of slots of the image, every other
+    // engine items the table owns; caches account for the bytes of a
+    // replaced entry by storing it anew
+    const bool in_place = table->cache == NULL && table->engine != &HT_MMAP_ENGINE;
+    if (entry->item != NULL && in_place)
+        return ht_item_replace_value(table, entry->item, value, value_len);
+    if (table->engine != NULL || table->cache != NULL)
+    {
+        if (table->engine != NULL)
+        {
+            if (entry->item != NULL)
+                table->engine->remove(table, entry->key, entry->key_len, entry->hash);
+            const int count = table->count;
+            table->engine->insert(table, entry->key, entry->key_len, value, value_len, entry->hash);
+            // read-only mappings ignore writes
+            if (table->count == count)
+                return NULL;
+        }
+        else
+        {
+            ht_cache_insert(table, entry->key, entry->key_len, value, value_len, entry->hash, HT_NEVER_EXPIRES);
+        }
+        entry->item = ht_find_entry(table, entry->key, entry->key_len, entry->hash);
+        return entry->item != NULL ? ht_item_value(entry->item) : NULL;
+    }
+    Item *item;
+    if (ht_load_percent(table->count, table->size) > 70)
+    {
+        // the slot found belongs to the array being replaced, and the
+        // filter is rebuilt from the items already placed
+        ht_resize_up(table);
+        item = create_new_item(table, entry->key, entry->key_len, value, value_len, entry->hash, HT_NEVER_EXPIRES);
+        ht_place_item(table, item);
+    }
+    else
+    {
+        item = create_new_item(table, entry->key, entry->key_len, value, value_len, entry->hash, HT_NEVER_EXPIRES);
+        table->items[entry->slot] = item;
+    }
+    table->count++;
+    entry->item = item;
+    entry->slot = -1;
+    return ht_item_value(item);
+}
+
+/**
+ * @brief stores a value for a key, replacing the value of the key's
+ * item when there is one instead of adding another item. The key is
+ * hashed and probed once.
+ * @param Table* represents the current hash table
+ * @param constchar* -key represents the key to be stored
+ * @param constchar* -value represents the value to be stored
+ * */
+Table *ht_upsert(Table *table, const char *key, const char *value)
+{
+    TableEntry entry = ht_entry(table, key);
+    ht_entry_set(&entry, value, strlen(value));
+    return table;
+}
+
+/**
+ * @brief returns the value stored for a key, storing the given value
+ * first when the key is absent. The key is hashed and probed once.
+ * @param Table* represents the current hash table
+ * @param constchar* -key represents the key to look for
+ * @param constchar* -value represents the value stored for an absent key
+ * @return char* the value of -key, NULL when it could not be stored
+ * */
+char *ht_get_or_insert(Table *table, const char *key, const char *value)
+{
+    TableEntry entry = ht_entry(table, key);
+    if (entry.item != NULL)
+        return ht_item_value(entry.item);
+    return ht_entry_set(&entry, value, strlen(value));
+}
+
+/**
+ * @brief monotonic clock in nanoseconds for the resize counters
+ * */
+uint64_t ht_stats_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief counts a resize that started at `start` and ends now
+ * @param Table* represents the current hash table
+ * @param constuint64_t `ht_stats_clock` value taken before the resize
+ * */
+void ht_stats_record_resize(Table *table, const uint64_t start)
+{
+    const uint64_t elapsed = ht_stats_clock() - start;
+    table->counters.resizes++;
+    table->counters.resize_total_ns += elapsed;
+    if (elapsed > table->counters.resize_max_ns)
+        table->counters.resize_max_ns = elapsed;
+}
+
+/**
+ * @brief counts a lookup in the hit or the miss histogram
+ * @param Table* represents the current hash table
+ * @param constbool the key was found
+ * @param constint slots or groups the lookup examined
+ * */
+void ht_stats_record_probe(Table *table, const bool hit, const int probes)
+{
+    const int bucket = probes < 1 ? 0 : probes > HT_STATS_PROBE_BUCKETS ? HT_STATS_PROBE_BUCKETS - 1 : probes - 1;
+    if (hit)
+        HT_STATS_ADD(table->counters.hit_probes[bucket], 1);
+    else
+        HT_STATS_ADD(table->counters.miss_probes[bucket], 1);
+}
+
+static void ht_stats_add_item(const Item *item, void *ctx)
+{
+    TableStats *stats = ctx;
+    if (item->is_inline)
+        return;
+    stats->key_bytes += item->key_len + 1;
+    stats->value_bytes += item->value_len + 1;
+}
+
+/**
+ * @brief fills a snapshot of the state of a table. Slot, tombstone and
+ * byte counts are worked out by walking the table, the probe and resize
+ * counters are only maintained when the library is built with HT_STATS.
+ * @param Table* represents the current hash table
+ * @param TableStats* receives the snapshot
+ * */
+void ht_stats(Table *table, TableStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->count = table->count;
+    stats->size = table->size;
+    stats->load_factor = table->size > 0 ? (double)table->count / table->size : 0;
+    HT_STATS_ONLY(stats->counters_enabled = true;)
+    memcpy(stats->hit_probes, table->counters.hit_probes, sizeof(stats->hit_probes));
+    memcpy(stats->miss_probes, table->counters.miss_probes, sizeof(stats->miss_probes));
+    stats->resizes = table->counters.resizes;
+    stats->resize_total_ms = (double)table->counters.resize_total_ns / 1e6;
+    stats->resize_max_ms = (double)table->counters.resize_max_ns / 1e6;
+    stats->arena_bytes = table->arena->bytes_reserved;
+    stats->evictions = table->cache != NULL ? table->cache->evictions : 0;
+    stats->expiring = table->expiry != NULL ? table->expiry->timed : 0;
+    stats->expired = table->expiry != NULL ? table->expiry->expired : 0;
+    stats->filter_rejects = table->counters.filter_rejects;
+    stats->filter_false_positives = table->counters.filter_false_positives;
+    if (table->filter != NULL)
+        ht_filter_stats(table->filter, stats);
+    ht_for_each_item(table, ht_stats_add_item, stats);
+    if (table->borrowed_keys)
+        stats->key_bytes = 0;
+    if (table->values != NULL)
+        stats->value_bytes = table->values->bytes;
+    if (table->engine != NULL)
+    {
+        table->engine->stats(table, stats);
+        return;
+    }
+    stats->slot_bytes = (size_t)(table->size + table->old_size) * sizeof(Item *);
+    stats->node_bytes = (size_t)table->count * sizeof(Item) + (size_t)stats->expiring * sizeof(struct ht_timer);
+    for (int i = 0; i < table->size; i++)
+        stats->tombstones += table->items[i] == &HT_EMPTY_ITEM;
+    for (int i = 0; i < table->old_size; i++)
+        stats->tombstones += table->old_items[i] == &HT_EMPTY_ITEM;
+}
+
+/**
+ * @brief zeroes the probe and resize counters of a table
+ * @param Table* represents the current hash table
+ * */
+void ht_stats_reset(Table *table)
+{
+    memset(&table->counters, 0, sizeof(table->counters));
 }
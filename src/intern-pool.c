@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/arena.h"
+#include "../lib/intern-pool.h"
+
+/**
+ * @brief a pooled string, the bytes follow the header and end with a NUL
+ * */
+struct intern_entry
+{
+    uint64_t hash;
+    uint32_t refs;
+    uint32_t len;
+    char bytes[];
+};
+
+static inline struct intern_entry *intern_entry_of(const char *bytes)
+{
+    return (struct intern_entry *)(bytes - offsetof(struct intern_entry, bytes));
+}
+
+static inline size_t intern_entry_size(const size_t len)
+{
+    return sizeof(struct intern_entry) + len + 1;
+}
+
+static void intern_alloc_slots(InternPool *pool, const size_t capacity)
+{
+    pool->slots = calloc(capacity, sizeof(struct intern_entry *));
+    if (pool->slots == NULL)
+        exit(EXIT_FAILURE);
+    pool->mask = capacity - 1;
+}
+
+InternPool *intern_pool_new(Arena *arena, HashFn hash, uint64_t seed)
+{
+    InternPool *pool = malloc(sizeof(InternPool));
+    if (pool == NULL)
+        exit(EXIT_FAILURE);
+    intern_alloc_slots(pool, INTERN_INITIAL_SLOTS);
+    pool->count = 0;
+    pool->bytes = 0;
+    pool->arena = arena;
+    pool->hash = hash;
+    pool->seed = seed;
+    return pool;
+}
+
+/**
+ * @brief doubles the index, entries keep their addresses
+ * */
+static void intern_grow(InternPool *pool)
+{
+    struct intern_entry **old = pool->slots;
+    const size_t old_capacity = pool->mask + 1;
+    intern_alloc_slots(pool, old_capacity * 2);
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old[i] == NULL)
+            continue;
+        size_t idx = (size_t)old[i]->hash & pool->mask;
+        while (pool->slots[idx] != NULL)
+            idx = (idx + 1) & pool->mask;
+        pool->slots[idx] = old[i];
+    }
+    free(old);
+}
+
+char *intern_acquire(InternPool *pool, const void *bytes, size_t len)
+{
+    const uint64_t hash = pool->hash(bytes, len, pool->seed);
+    size_t idx = (size_t)hash & pool->mask;
+    for (struct intern_entry *entry; (entry = pool->slots[idx]) != NULL; idx = (idx + 1) & pool->mask)
+    {
+        if (entry->hash == hash && entry->len == len && memcmp(entry->bytes, bytes, len) == 0)
+        {
+            entry->refs++;
+            return entry->bytes;
+        }
+    }
+    // the index stays at most 3/4 full
+    if ((pool->count + 1) * 4 > (pool->mask + 1) * 3)
+    {
+        intern_grow(pool);
+        idx = (size_t)hash & pool->mask;
+        while (pool->slots[idx] != NULL)
+            idx = (idx + 1) & pool->mask;
+    }
+    struct intern_entry *entry = arena_alloc(pool->arena, intern_entry_size(len));
+    entry->hash = hash;
+    entry->refs = 1;
+    entry->len = (uint32_t)len;
+    memcpy(entry->bytes, bytes, len);
+    entry->bytes[len] = '\0';
+    pool->slots[idx] = entry;
+    pool->count++;
+    pool->bytes += intern_entry_size(len);
+    return entry->bytes;
+}
+
+void intern_release(InternPool *pool, const char *bytes)
+{
+    struct intern_entry *entry = intern_entry_of(bytes);
+    if (--entry->refs > 0)
+        return;
+    size_t idx = (size_t)entry->hash & pool->mask;
+    while (pool->slots[idx] != entry)
+        idx = (idx + 1) & pool->mask;
+    // backward shift: pull later entries of the cluster into the hole
+    // unless their home lies cyclically in (hole, slot]
+    size_t hole = idx;
+    for (size_t next = (hole + 1) & pool->mask; pool->slots[next] != NULL; next = (next + 1) & pool->mask)
+    {
+        const size_t home = (size_t)pool->slots[next]->hash & pool->mask;
+        if (((next - home) & pool->mask) >= ((next - hole) & pool->mask))
+        {
+            pool->slots[hole] = pool->slots[next];
+            hole = next;
+        }
+    }
+    pool->slots[hole] = NULL;
+    pool->count--;
+    pool->bytes -= intern_entry_size(entry->len);
+    arena_free(pool->arena, entry, intern_entry_size(entry->len));
+}
+
+uint32_t intern_refs(const char *bytes)
+{
+    return intern_entry_of(bytes)->refs;
+}
+
+void intern_pool_destroy(InternPool *pool)
+{
+    if (pool == NULL)
+        return;
+    free(pool->slots);
+    free(pool);
+}
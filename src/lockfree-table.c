@@ -0,0 +1,210 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/lockfree-table.h"
+
+#define LF_INITIAL_SIZE 64
+#define LF_MAX_LOAD_PERCENT 70
+
+/**
+ * @brief an immutable key/value node, key and value share its allocation
+ * */
+struct lf_node
+{
+    uint64_t hash;
+    char *value;
+    char key[];
+};
+
+/**
+ * @brief a power-of-two slot array probed linearly
+ * */
+struct lf_array
+{
+    size_t size;
+    _Atomic(struct lf_node *) slots[];
+};
+
+// marks a deleted slot so probe sequences through it continue
+static struct lf_node LF_TOMBSTONE;
+
+static struct lf_array *lf_array_new(size_t size)
+{
+    struct lf_array *array = malloc(sizeof(struct lf_array) + size * sizeof(_Atomic(struct lf_node *)));
+    if (array == NULL)
+        exit(EXIT_FAILURE);
+    array->size = size;
+    for (size_t i = 0; i < size; i++)
+        atomic_init(&array->slots[i], NULL);
+    return array;
+}
+
+static struct lf_node *lf_node_new(const char *key, const char *value, const uint64_t hash)
+{
+    const size_t key_size = strlen(key) + 1;
+    const size_t value_size = strlen(value) + 1;
+    struct lf_node *node = malloc(sizeof(struct lf_node) + key_size + value_size);
+    if (node == NULL)
+        exit(EXIT_FAILURE);
+    node->hash = hash;
+    memcpy(node->key, key, key_size);
+    node->value = node->key + key_size;
+    memcpy(node->value, value, value_size);
+    return node;
+}
+
+LockFreeTable *lf_new(HashFn hash, uint64_t seed)
+{
+    LockFreeTable *table = malloc(sizeof(LockFreeTable));
+    if (table == NULL)
+        exit(EXIT_FAILURE);
+    atomic_init(&table->array, lf_array_new(LF_INITIAL_SIZE));
+    pthread_mutex_init(&table->write_lock, NULL);
+    table->hash = hash != NULL ? hash : ht_hash_wy;
+    table->seed = seed;
+    table->count = 0;
+    table->tombstones = 0;
+    epoch_init(&table->epoch);
+    return table;
+}
+
+LfReader *lf_register_reader(LockFreeTable *table)
+{
+    return epoch_register(&table->epoch);
+}
+
+void lf_unregister_reader(LfReader *reader)
+{
+    epoch_unregister(reader);
+}
+
+void lf_read_lock(LockFreeTable *table, LfReader *reader)
+{
+    epoch_enter(&table->epoch, reader);
+}
+
+void lf_read_unlock(LfReader *reader)
+{
+    epoch_exit(reader);
+}
+
+/**
+ * @brief probes an array for key
+ * @param structlf_node** set to the node found, the slot may change after the load
+ * @return long the slot holding key or -1
+ * */
+static long lf_lookup(struct lf_array *array, const char *key, const uint64_t hash, struct lf_node **found)
+{
+    const size_t mask = array->size - 1;
+    size_t idx = (size_t)hash & mask;
+    for (size_t probes = 0; probes < array->size; probes++)
+    {
+        struct lf_node *node = atomic_load_explicit(&array->slots[idx], memory_order_acquire);
+        if (node == NULL)
+            return -1;
+        if (node != &LF_TOMBSTONE && node->hash == hash && strcmp(node->key, key) == 0)
+        {
+            *found = node;
+            return (long)idx;
+        }
+        idx = (idx + 1) & mask;
+    }
+    return -1;
+}
+
+const char *lf_find(LockFreeTable *table, const char *key)
+{
+    const uint64_t hash = table->hash(key, strlen(key), table->seed);
+    struct lf_array *array = atomic_load_explicit(&table->array, memory_order_acquire);
+    struct lf_node *node;
+    if (lf_lookup(array, key, hash, &node) < 0)
+        return NULL;
+    return node->value;
+}
+
+/**
+ * @brief copies every live node pointer into a new array and publishes it,
+ * readers still probing the old array keep seeing valid nodes
+ * */
+static void lf_resize(LockFreeTable *table, size_t size)
+{
+    struct lf_array *old = atomic_load_explicit(&table->array, memory_order_relaxed);
+    struct lf_array *array = lf_array_new(size);
+    for (size_t i = 0; i < old->size; i++)
+    {
+        struct lf_node *node = atomic_load_explicit(&old->slots[i], memory_order_relaxed);
+        if (node == NULL || node == &LF_TOMBSTONE)
+            continue;
+        size_t idx = (size_t)node->hash & (size - 1);
+        while (atomic_load_explicit(&array->slots[idx], memory_order_relaxed) != NULL)
+            idx = (idx + 1) & (size - 1);
+        atomic_store_explicit(&array->slots[idx], node, memory_order_relaxed);
+    }
+    atomic_store_explicit(&table->array, array, memory_order_release);
+    table->tombstones = 0;
+    epoch_retire(&table->epoch, old, free);
+}
+
+void lf_insert(LockFreeTable *table, const char *key, const char *value)
+{
+    const uint64_t hash = table->hash(key, strlen(key), table->seed);
+    struct lf_node *node = lf_node_new(key, value, hash);
+    pthread_mutex_lock(&table->write_lock);
+    struct lf_array *array = atomic_load_explicit(&table->array, memory_order_relaxed);
+    struct lf_node *old;
+    const long existing = lf_lookup(array, key, hash, &old);
+    if (existing >= 0)
+    {
+        atomic_store_explicit(&array->slots[existing], node, memory_order_release);
+        epoch_retire(&table->epoch, old, free);
+        pthread_mutex_unlock(&table->write_lock);
+        return;
+    }
+    if ((table->count + table->tombstones + 1) * 100 > array->size * LF_MAX_LOAD_PERCENT)
+    {
+        // grow when live keys fill the array, otherwise just drop tombstones
+        lf_resize(table, (table->count + 1) * 100 > array->size * LF_MAX_LOAD_PERCENT / 2 ? array->size * 2 : array->size);
+        array = atomic_load_explicit(&table->array, memory_order_relaxed);
+    }
+    size_t idx = (size_t)hash & (array->size - 1);
+    struct lf_node *slot;
+    while ((slot = atomic_load_explicit(&array->slots[idx], memory_order_relaxed)) != NULL && slot != &LF_TOMBSTONE)
+        idx = (idx + 1) & (array->size - 1);
+    if (slot == &LF_TOMBSTONE)
+        table->tombstones--;
+    atomic_store_explicit(&array->slots[idx], node, memory_order_release);
+    table->count++;
+    pthread_mutex_unlock(&table->write_lock);
+}
+
+void lf_delete(LockFreeTable *table, const char *key)
+{
+    const uint64_t hash = table->hash(key, strlen(key), table->seed);
+    pthread_mutex_lock(&table->write_lock);
+    struct lf_array *array = atomic_load_explicit(&table->array, memory_order_relaxed);
+    struct lf_node *node;
+    const long idx = lf_lookup(array, key, hash, &node);
+    if (idx >= 0)
+    {
+        atomic_store_explicit(&array->slots[idx], &LF_TOMBSTONE, memory_order_release);
+        table->count--;
+        table->tombstones++;
+        epoch_retire(&table->epoch, node, free);
+    }
+    pthread_mutex_unlock(&table->write_lock);
+}
+
+void delete_LockFreeTable(LockFreeTable *table)
+{
+    struct lf_array *array = atomic_load_explicit(&table->array, memory_order_relaxed);
+    for (size_t i = 0; i < array->size; i++)
+    {
+        struct lf_node *node = atomic_load_explicit(&array->slots[i], memory_order_relaxed);
+        if (node != NULL && node != &LF_TOMBSTONE)
+            free(node);
+    }
+    free(array);
+    epoch_destroy(&table->epoch);
+    pthread_mutex_destroy(&table->write_lock);
+    free(table);
+}
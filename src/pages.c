@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "../lib/pages.h"
+
+// kernel memory policy modes, as in <linux/mempolicy.h>
+#define PAGES_MPOL_BIND 2
+#define PAGES_MPOL_INTERLEAVE 3
+// nodes a policy mask describes
+#define PAGES_MAX_NODES 1024
+#define PAGES_MASK_WORDS (PAGES_MAX_NODES / (8 * sizeof(unsigned long)))
+
+static inline size_t pages_round(const size_t bytes)
+{
+    return (bytes + HT_HUGE_PAGE_SIZE - 1) & ~(size_t)(HT_HUGE_PAGE_SIZE - 1);
+}
+
+bool pages_mapped(const struct page_policy *policy, const size_t bytes)
+{
+    return policy != NULL && (policy->pages != HT_PAGES_DEFAULT || policy->numa != HT_NUMA_DEFAULT) &&
+           bytes >= HT_HUGE_PAGE_SIZE;
+}
+
+/**
+ * @brief sets the bits of the online nodes, read from sysfs as a list
+ * of ranges such as "0-3,8"
+ * @return bool false when the list cannot be read
+ * */
+static bool pages_online_nodes(unsigned long *mask)
+{
+    FILE *file = fopen("/sys/devices/system/node/online", "r");
+    if (file == NULL)
+        return false;
+    int first, last;
+    bool any = false;
+    while (fscanf(file, "%d", &first) == 1)
+    {
+        last = first;
+        int c = fgetc(file);
+        if (c == '-')
+        {
+            if (fscanf(file, "%d", &last) != 1)
+                break;
+            c = fgetc(file);
+        }
+        for (int node = first; node <= last && node < PAGES_MAX_NODES; node++)
+        {
+            mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+            any = true;
+        }
+        if (c != ',')
+            break;
+    }
+    fclose(file);
+    return any;
+}
+
+/**
+ * @brief applies the NUMA policy to a fresh mapping, before any page of
+ * it is touched. Kernels without NUMA support refuse and the pages go
+ * where they would have gone anyway.
+ * */
+static void pages_place(const struct page_policy *policy, void *block, const size_t length)
+{
+#ifdef SYS_mbind
+    unsigned long mask[PAGES_MASK_WORDS] = {0};
+    int mode;
+    if (policy->numa == HT_NUMA_INTERLEAVE)
+    {
+        if (!pages_online_nodes(mask))
+            return;
+        mode = PAGES_MPOL_INTERLEAVE;
+    }
+    else if (policy->numa == HT_NUMA_BIND && policy->node >= 0 && policy->node < PAGES_MAX_NODES)
+    {
+        mask[policy->node / (8 * sizeof(unsigned long))] = 1ul << (policy->node % (8 * sizeof(unsigned long)));
+        mode = PAGES_MPOL_BIND;
+    }
+    else
+    {
+        return;
+    }
+    syscall(SYS_mbind, block, length, mode, mask, (unsigned long)PAGES_MAX_NODES, 0u);
+#else
+    (void)policy;
+    (void)block;
+    (void)length;
+#endif
+}
+
+/**
+ * @brief maps `length` bytes of anonymous memory aligned to a huge page,
+ * over-mapping by one huge page and trimming both ends, since only
+ * aligned huge page ranges can be backed by transparent huge pages
+ * */
+static void *pages_map_aligned(const size_t length)
+{
+    char *raw = mmap(NULL, length + HT_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return NULL;
+    char *block = (char *)(((uintptr_t)raw + HT_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HT_HUGE_PAGE_SIZE - 1));
+    if (block > raw)
+        munmap(raw, (size_t)(block - raw));
+    const size_t tail = (size_t)(raw + length + HT_HUGE_PAGE_SIZE - (block + length));
+    if (tail > 0)
+        munmap(block + length, tail);
+    return block;
+}
+
+void *pages_alloc(const struct page_policy *policy, const size_t bytes)
+{
+    if (!pages_mapped(policy, bytes))
+    {
+        void *block = calloc(1, bytes);
+        if (block == NULL)
+            exit(EXIT_FAILURE);
+        return block;
+    }
+    const size_t length = pages_round(bytes);
+    void *block = NULL;
+#ifdef MAP_HUGETLB
+    if (policy->pages == HT_PAGES_HUGETLB)
+    {
+        // fails when the reserved pool has too few free pages
+        block = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block == MAP_FAILED)
+            block = NULL;
+    }
+#endif
+    if (block == NULL)
+    {
+        block = pages_map_aligned(length);
+        if (block == NULL)
+            exit(EXIT_FAILURE);
+#ifdef MADV_HUGEPAGE
+        // refused when transparent huge pages are off, 4 KB pages remain
+        if (policy->pages != HT_PAGES_DEFAULT)
+            madvise(block, length, MADV_HUGEPAGE);
+#endif
+    }
+    pages_place(policy, block, length);
+    // anonymous mappings come zeroed
+    return block;
+}
+
+void pages_free(const struct page_policy *policy, void *block, const size_t bytes)
+{
+    if (block == NULL)
+        return;
+    if (!pages_mapped(policy, bytes))
+    {
+        free(block);
+        return;
+    }
+    munmap(block, pages_round(bytes));
+}
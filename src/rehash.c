@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../lib/ht-engine.h"
+
+/**
+ * @brief an item to move: its old slot and the first slot of its probe
+ * in the new array, kept so placing it reads no item node
+ * */
+struct rehash_entry
+{
+    int slot;
+    int home;
+};
+
+/**
+ * @brief growable array of entries, always in increasing old slot order
+ * */
+struct rehash_list
+{
+    struct rehash_entry *entries;
+    size_t count;
+    size_t capacity;
+};
+
+struct rehash;
+
+/**
+ * @brief state of one worker thread
+ * */
+struct rehash_worker
+{
+    struct rehash *rehash;
+    int id;
+    // items of the chunk of this worker, one list per range of new slots
+    // their probe starts in
+    struct rehash_list *ranges;
+    // items whose probe ran past the end of the range of this worker,
+    // they continue at the start of the next range
+    struct rehash_list overflow;
+    // items of the overflow of the previous range this range holds
+    size_t incoming;
+};
+
+/**
+ * @brief state shared by the workers of one rehash
+ * */
+struct rehash
+{
+    Table *table;
+    int threads;
+    struct rehash_worker *workers;
+};
+
+/**
+ * @brief first slot of the range of new slots a worker owns, ranges
+ * split the slot array evenly and the last one ends at its end
+ * */
+static inline int rehash_range_start(const int size, const int range, const int threads)
+{
+    return (int)(((int64_t)size * range + threads - 1) / threads);
+}
+
+static inline void rehash_push(struct rehash_list *list, const struct rehash_entry entry)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->entries = realloc(list->entries, list->capacity * sizeof(struct rehash_entry));
+        if (list->entries == NULL)
+            exit(EXIT_FAILURE);
+    }
+    list->entries[list->count++] = entry;
+}
+
+/**
+ * @brief phase one: sorts the items of one chunk of the old slot array
+ * by the range of new slots their probe starts in, keeping slot order
+ * */
+static void *rehash_split(void *arg)
+{
+    struct rehash_worker *worker = arg;
+    const struct rehash *rehash = worker->rehash;
+    const Table *table = rehash->table;
+    const int from = rehash_range_start(table->old_size, worker->id, rehash->threads);
+    const int to = rehash_range_start(table->old_size, worker->id + 1, rehash->threads);
+    for (int slot = from; slot < to; slot++)
+    {
+        const Item *item = table->old_items[slot];
+        if (!ht_item_live(item))
+            continue;
+        const struct rehash_entry entry = {.slot = slot, .home = ht_home_slot(table, item->hash)};
+        rehash_push(&worker->ranges[(int64_t)entry.home * rehash->threads / table->size], entry);
+    }
+    return NULL;
+}
+
+/**
+ * @brief linear probe from `idx` up to the end of a range, without
+ * wrapping around: past it the probe belongs to the next range
+ * @return bool false when every slot up to `hi` is taken
+ * */
+static inline bool rehash_place(Item **items, Item *item, int idx, const int hi)
+{
+    for (; idx < hi; idx++)
+    {
+        if (items[idx] == NULL)
+        {
+            items[idx] = item;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief fills the range of one worker with the items whose probe starts
+ * in it and the first `incoming` items of the overflow of the previous
+ * range, in old slot order as a serial rehash would place them. Items
+ * running past the end of the range make up its overflow.
+ * */
+static void rehash_fill(struct rehash_worker *worker, const size_t incoming)
+{
+    const struct rehash *rehash = worker->rehash;
+    const Table *table = rehash->table;
+    const int lo = rehash_range_start(table->size, worker->id, rehash->threads);
+    const int hi = rehash_range_start(table->size, worker->id + 1, rehash->threads);
+    const struct rehash_list *previous = &rehash->workers[(worker->id + rehash->threads - 1) % rehash->threads].overflow;
+    Item **items = table->items;
+    size_t next = 0;
+    for (int w = 0; w < rehash->threads; w++)
+    {
+        const struct rehash_list *list = &rehash->workers[w].ranges[worker->id];
+        for (size_t i = 0; i < list->count; i++)
+        {
+            const struct rehash_entry entry = list->entries[i];
+            // items from the previous range come in at its first slot
+            for (; next < incoming && previous->entries[next].slot < entry.slot; next++)
+            {
+                if (!rehash_place(items, table->old_items[previous->entries[next].slot], lo, hi))
+                    rehash_push(&worker->overflow, previous->entries[next]);
+            }
+            if (!rehash_place(items, table->old_items[entry.slot], entry.home, hi))
+                rehash_push(&worker->overflow, entry);
+        }
+    }
+    for (; next < incoming; next++)
+    {
+        if (!rehash_place(items, table->old_items[previous->entries[next].slot], lo, hi))
+            rehash_push(&worker->overflow, previous->entries[next]);
+    }
+    worker->incoming = incoming;
+}
+
+/**
+ * @brief phase two: fills the range of this worker on its own, no other
+ * thread writes to it
+ * */
+static void *rehash_fill_alone(void *arg)
+{
+    rehash_fill(arg, 0);
+    return NULL;
+}
+
+/**
+ * @brief runs a phase on every worker, the calling thread taking the first one
+ * */
+static void rehash_run(struct rehash *rehash, void *(*phase)(void *))
+{
+    pthread_t threads[HT_REHASH_MAX_THREADS];
+    for (int i = 1; i < rehash->threads; i++)
+    {
+        if (pthread_create(&threads[i], NULL, phase, &rehash->workers[i]) != 0)
+            exit(EXIT_FAILURE);
+    }
+    phase(&rehash->workers[0]);
+    for (int i = 1; i < rehash->threads; i++)
+        pthread_join(threads[i], NULL);
+}
+
+/**
+ * @brief The old array is cut in one chunk per thread and the new one in
+ * one range of slots per thread. Every thread first sorts the items of
+ * its chunk by the range their probe starts in, then fills one range
+ * with the items of every chunk, in old slot order. With linear probing
+ * an item only competes for slots of its range with the items placed
+ * there before it, so a range ends up as a serial rehash leaves it
+ * unless items of the previous range ran past its end. Those ranges are
+ * filled again on the calling thread with that overflow merged in, until
+ * no overflow changes: an overflow only grows as more items come in, and
+ * the slot array keeps free slots, so it settles on the serial layout.
+ * */
+void ht_rehash_parallel(Table *table)
+{
+    struct rehash rehash = {.table = table, .threads = table->rehash_threads};
+    rehash.workers = calloc((size_t)rehash.threads, sizeof(struct rehash_worker));
+    if (rehash.workers == NULL)
+        exit(EXIT_FAILURE);
+    for (int w = 0; w < rehash.threads; w++)
+    {
+        rehash.workers[w].rehash = &rehash;
+        rehash.workers[w].id = w;
+        rehash.workers[w].ranges = calloc((size_t)rehash.threads, sizeof(struct rehash_list));
+        if (rehash.workers[w].ranges == NULL)
+            exit(EXIT_FAILURE);
+    }
+    rehash_run(&rehash, rehash_split);
+    rehash_run(&rehash, rehash_fill_alone);
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (int w = 0; w < rehash.threads; w++)
+        {
+            struct rehash_worker *worker = &rehash.workers[w];
+            const size_t incoming = rehash.workers[(w + rehash.threads - 1) % rehash.threads].overflow.count;
+            if (incoming == worker->incoming)
+                continue;
+            const int lo = rehash_range_start(table->size, w, rehash.threads);
+            const int hi = rehash_range_start(table->size, w + 1, rehash.threads);
+            memset(table->items + lo, 0, (size_t)(hi - lo) * sizeof(Item *));
+            worker->overflow.count = 0;
+            rehash_fill(worker, incoming);
+            changed = true;
+        }
+    }
+    for (int w = 0; w < rehash.threads; w++)
+    {
+        for (int r = 0; r < rehash.threads; r++)
+            free(rehash.workers[w].ranges[r].entries);
+        free(rehash.workers[w].ranges);
+        free(rehash.workers[w].overflow.entries);
+    }
+    free(rehash.workers);
+    table->rehash_idx = table->old_size;
+    table->layout_version++;
+}
@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/ht-engine.h"
+
+// items kept per 8 slots before the store doubles
+#define ROBIN_HOOD_MAX_LOAD 7
+
+/**
+ * @brief Structural definition for the robin hood storage: a power-of-two
+ * array of inline items probed linearly from `hash & mask`, and a parallel
+ * array with the probe distance of every slot
+ * */
+struct robin_hood_store
+{
+    // 1 + distance of the item from its home slot, 0 for an empty slot
+    uint32_t *dist;
+    // inline items, slot i is described by dist[i]
+    Item *slots;
+    // slots - 1, the slot count is a power of two
+    size_t mask;
+};
+
+/**
+ * @brief allocates `capacity` empty slots
+ * @param structrobin_hood_store* store to fill
+ * @param size_t number of slots, a power of two
+ * */
+static void robin_hood_alloc(struct robin_hood_store *store, size_t capacity)
+{
+    store->dist = calloc(capacity, sizeof(uint32_t));
+    store->slots = malloc(capacity * sizeof(Item));
+    if (store->dist == NULL || store->slots == NULL)
+        exit(EXIT_FAILURE);
+    store->mask = capacity - 1;
+}
+
+/**
+ * @brief places an item whose strings are already stored. Walking from
+ * its home slot, the item takes the place of the first resident that is
+ * closer to its own home ("richer"), and that resident carries on probing,
+ * so probe lengths stay close to the average.
+ * @param structrobin_hood_store* store with at least one empty slot
+ * @param Item item to place, copied by value
+ * */
+static void robin_hood_place(struct robin_hood_store *store, Item item)
+{
+    size_t idx = (size_t)item.hash & store->mask;
+    uint32_t dist = 1;
+    for (;;)
+    {
+        if (store->dist[idx] == 0)
+        {
+            store->dist[idx] = dist;
+            store->slots[idx] = item;
+            return;
+        }
+        if (store->dist[idx] < dist)
+        {
+            const Item resident = store->slots[idx];
+            const uint32_t resident_dist = store->dist[idx];
+            store->slots[idx] = item;
+            store->dist[idx] = dist;
+            item = resident;
+            dist = resident_dist;
+        }
+        idx = (idx + 1) & store->mask;
+        dist++;
+    }
+}
+
+/**
+ * @brief rebuilds the store with `capacity` slots, moving every item by
+ * value; keys and values are not copied
+ * @param Table* table owning the store
+ * @param size_t new number of slots, a power of two
+ * */
+static void robin_hood_rehash(Table *table, size_t capacity)
+{
+    HT_STATS_ONLY(const uint64_t resize_start = ht_stats_clock();)
+    struct robin_hood_store *store = table->store;
+    struct robin_hood_store old = *store;
+    robin_hood_alloc(store, capacity);
+    for (size_t i = 0; i <= old.mask; i++)
+    {
+        if (old.dist[i] != 0)
+            robin_hood_place(store, old.slots[i]);
+    }
+    table->size = (int)capacity;
+    table->base_size = table->size;
+    free(old.dist);
+    free(old.slots);
+    HT_STATS_ONLY(ht_stats_record_resize(table, resize_start);)
+}
+
+static void robin_hood_init(Table *table, const int min_items)
+{
+    struct robin_hood_store *store = malloc(sizeof(struct robin_hood_store));
+    if (store == NULL)
+        exit(EXIT_FAILURE);
+    size_t capacity = 16;
+    while (capacity * ROBIN_HOOD_MAX_LOAD / 8 < (size_t)min_items)
+        capacity *= 2;
+    robin_hood_alloc(store, capacity);
+    table->store = store;
+    table->items = NULL;
+    table->size = (int)capacity;
+    table->base_size = table->size;
+    table->count = 0;
+}
+
+static void robin_hood_destroy(Table *table)
+{
+    struct robin_hood_store *store = table->store;
+    free(store->dist);
+    free(store->slots);
+    free(store);
+    table->store = NULL;
+}
+
+static void robin_hood_insert(Table *table, const void *key, const size_t key_len, const void *value, const size_t value_len, const uint64_t hash)
+{
+    struct robin_hood_store *store = table->store;
+    if ((size_t)(table->count + 1) > (store->mask + 1) * ROBIN_HOOD_MAX_LOAD / 8)
+        robin_hood_rehash(table, (store->mask + 1) * 2);
+    Item item;
+    ht_store_item_strings(table, &item, key, key_len, value, value_len);
+    item.hash = hash;
+    robin_hood_place(table->store, item);
+    table->count++;
+}
+
+/**
+ * @brief returns the slot holding key or -1. A miss ends as soon as the
+ * probe is further from home than the resident of the slot, since robin
+ * hood placement would have put the key there.
+ * */
+static long robin_hood_lookup(const struct robin_hood_store *store, const void *key, const size_t key_len, const uint64_t hash)
+{
+    size_t idx = (size_t)hash & store->mask;
+    for (uint32_t dist = 1; dist <= store->dist[idx]; dist++)
+    {
+        if (ht_item_matches(&store->slots[idx], key, key_len, hash))
+            return (long)idx;
+        idx = (idx + 1) & store->mask;
+    }
+    return -1;
+}
+
+#ifdef HT_STATS
+/**
+ * @brief slots a miss examines: every slot whose resident is at least as
+ * far from home as the probe, and the one that ends it
+ * */
+static int robin_hood_miss_probes(const struct robin_hood_store *store, const uint64_t hash)
+{
+    size_t idx = (size_t)hash & store->mask;
+    int probes = 1;
+    for (uint32_t dist = 1; dist <= store->dist[idx]; dist++, probes++)
+        idx = (idx + 1) & store->mask;
+    return probes;
+}
+#endif
+
+static Item *robin_hood_find(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    struct robin_hood_store *store = table->store;
+    const long slot = robin_hood_lookup(store, key, key_len, hash);
+    // a hit examined as many slots as its distance, a miss one more than it skipped
+    HT_STATS_ONLY(ht_stats_record_probe(table, slot >= 0, slot >= 0 ? (int)store->dist[slot] : robin_hood_miss_probes(store, hash));)
+    return slot < 0 ? NULL : &store->slots[slot];
+}
+
+/**
+ * @brief removes every item stored under key. Each removal shifts the
+ * following items of the cluster back by one slot until an empty slot or
+ * an item already at home, so no tombstone is ever left behind.
+ * */
+static void robin_hood_remove(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    struct robin_hood_store *store = table->store;
+    long slot;
+    while ((slot = robin_hood_lookup(store, key, key_len, hash)) >= 0)
+    {
+        ht_release_item_strings(table, &store->slots[slot]);
+        size_t idx = (size_t)slot;
+        size_t next = (idx + 1) & store->mask;
+        while (store->dist[next] > 1)
+        {
+            store->slots[idx] = store->slots[next];
+            store->dist[idx] = store->dist[next] - 1;
+            idx = next;
+            next = (next + 1) & store->mask;
+        }
+        store->dist[idx] = 0;
+        table->count--;
+    }
+}
+
+static void robin_hood_reserve(Table *table, const int items)
+{
+    const struct robin_hood_store *store = table->store;
+    size_t capacity = store->mask + 1;
+    while (capacity * ROBIN_HOOD_MAX_LOAD / 8 < (size_t)items)
+        capacity *= 2;
+    if (capacity > store->mask + 1)
+        robin_hood_rehash(table, capacity);
+}
+
+/**
+ * @brief scans home slots: the items of a home sit together in the run
+ * that starts there, at the distance of their position from it
+ * */
+static uint64_t robin_hood_scan(Table *table, uint64_t cursor, struct ht_scan_batch *batch, int budget)
+{
+    const struct robin_hood_store *store = table->store;
+    int examined = 0;
+    do
+    {
+        size_t idx = (size_t)cursor & store->mask;
+        for (uint32_t dist = 1; dist <= store->dist[idx]; dist++)
+        {
+            examined++;
+            if (store->dist[idx] == dist)
+                ht_scan_push(batch, &store->slots[idx]);
+            idx = (idx + 1) & store->mask;
+        }
+        examined++;
+        cursor = ht_scan_next(cursor, store->mask);
+    } while (cursor != 0 && examined < budget);
+    return cursor;
+}
+
+static void robin_hood_stats(Table *table, TableStats *stats)
+{
+    const struct robin_hood_store *store = table->store;
+    // deletes shift back, there is never a tombstone
+    stats->tombstones = 0;
+    stats->slot_bytes = (store->mask + 1) * (sizeof(Item) + sizeof(uint32_t));
+}
+
+static void robin_hood_each(Table *table, HtItemFn fn, void *ctx)
+{
+    const struct robin_hood_store *store = table->store;
+    for (size_t i = 0; i <= store->mask; i++)
+    {
+        if (store->dist[i] != 0)
+            fn(&store->slots[i], ctx);
+    }
+}
+
+const struct ht_engine HT_ROBIN_HOOD_ENGINE = {
+    .init = robin_hood_init,
+    .destroy = robin_hood_destroy,
+    .insert = robin_hood_insert,
+    .find = robin_hood_find,
+    .remove = robin_hood_remove,
+    .each = robin_hood_each,
+    .reserve = robin_hood_reserve,
+    .stats = robin_hood_stats,
+    .scan = robin_hood_scan,
+};
@@ -0,0 +1,495 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../lib/snapshot.h"
+#include "../lib/ht-engine.h"
+#include "../lib/arena.h"
+
+// offsets 0 and 1 fall inside the header, so they can mark free slots
+#define SNAPSHOT_EMPTY 0
+#define SNAPSHOT_DELETED 1
+// copy-on-write stores keep at most 7 used slots out of 8
+#define SNAPSHOT_MAX_LOAD 7
+
+/**
+ * @brief Structural definition for the storage of a mapped table: the
+ * mapping itself and the slot array, which stays in the mapping until a
+ * copy-on-write table outgrows it
+ * */
+struct mmap_store
+{
+    // first byte of the mapping, slot offsets are relative to it
+    char *base;
+    // bytes mapped
+    size_t length;
+    // slot array, inside the mapping or owned once grown
+    struct ht_snapshot_slot *slots;
+    // slots - 1, the slot count is a power of two
+    uint64_t mask;
+    // slots marked SNAPSHOT_DELETED
+    uint64_t deleted;
+    // the mapping is private and writable
+    bool writable;
+    // `slots` was malloc'ed by a rehash
+    bool own_slots;
+};
+
+/**
+ * @brief names the hash function of a table for the image header
+ * @return uint32_t one of `enum hash_table_snapshot_hash`, 0 when unknown
+ * */
+static uint32_t snapshot_hash_id(const HashFn hash)
+{
+    if (hash == ht_hash_wy)
+        return HT_SNAPSHOT_HASH_WY;
+    if (hash == ht_hash_fnv1a)
+        return HT_SNAPSHOT_HASH_FNV1A;
+    return 0;
+}
+
+static uint64_t snapshot_header_checksum(const struct ht_snapshot_header *header)
+{
+    return ht_hash_wy(header, offsetof(struct ht_snapshot_header, header_checksum), HT_SNAPSHOT_VERSION);
+}
+
+/**
+ * @brief item collection state of `ht_save`
+ * */
+struct snapshot_items
+{
+    const Item **items;
+    size_t count;
+    size_t capacity;
+    size_t data_bytes;
+};
+
+static void snapshot_collect(const Item *item, void *ctx)
+{
+    struct snapshot_items *collected = ctx;
+    if (collected->count == collected->capacity)
+    {
+        collected->capacity = collected->capacity ? collected->capacity * 2 : 1024;
+        collected->items = realloc(collected->items, collected->capacity * sizeof(Item *));
+        if (collected->items == NULL)
+            exit(EXIT_FAILURE);
+    }
+    collected->items[collected->count++] = item;
+    // item lengths fit the 32-bit lengths of the slots, HT_ITEM_MAX_KEY
+    // and HT_ITEM_MAX_VALUE keep them within UINT32_MAX
+    collected->data_bytes += (size_t)item->key_len + item->value_len + 2;
+}
+
+/**
+ * @brief stores a slot in the first free slot of its probe sequence
+ * @param structht_snapshot_slot* slot array with at least one free slot
+ * @param uint64_t slots - 1
+ * @param conststructht_snapshot_slot* slot to copy
+ * @return uint64_t index of the slot it was stored in
+ * */
+static uint64_t snapshot_place(struct ht_snapshot_slot *slots, const uint64_t mask, const struct ht_snapshot_slot *slot)
+{
+    uint64_t idx = slot->hash & mask;
+    while (slots[idx].offset != SNAPSHOT_EMPTY && slots[idx].offset != SNAPSHOT_DELETED)
+        idx = (idx + 1) & mask;
+    slots[idx] = *slot;
+    return idx;
+}
+
+int ht_save(Table *table, const char *path)
+{
+    const uint32_t hash_id = snapshot_hash_id(table->hash);
+    if (hash_id == 0)
+        return -1;
+    struct snapshot_items collected = {0};
+    ht_for_each_item(table, snapshot_collect, &collected);
+
+    // half the slots stay free, so probes are short and a copy-on-write
+    // mapping can take inserts before it has to grow
+    uint64_t slot_count = 16;
+    while (slot_count < collected.count * 2)
+        slot_count *= 2;
+    struct ht_snapshot_slot *slots = calloc(slot_count, sizeof(struct ht_snapshot_slot));
+    char *data = malloc(collected.data_bytes > 0 ? collected.data_bytes : 1);
+    if (slots == NULL || data == NULL)
+        exit(EXIT_FAILURE);
+    const uint64_t data_offset = sizeof(struct ht_snapshot_header) + slot_count * sizeof(struct ht_snapshot_slot);
+    uint64_t cursor = 0;
+    for (size_t i = 0; i < collected.count; i++)
+    {
+        const Item *item = collected.items[i];
+        const struct ht_snapshot_slot slot = {
+            .hash = item->hash,
+            .offset = data_offset + cursor,
+            .key_len = (uint32_t)item->key_len,
+            .value_len = (uint32_t)item->value_len,
+        };
+        snapshot_place(slots, slot_count - 1, &slot);
+        memcpy(data + cursor, ht_item_key(item), item->key_len);
+        data[cursor + item->key_len] = '\0';
+        cursor += item->key_len + 1;
+        memcpy(data + cursor, ht_item_value(item), item->value_len);
+        data[cursor + item->value_len] = '\0';
+        cursor += item->value_len + 1;
+    }
+
+    struct ht_snapshot_header header = {
+        .magic = HT_SNAPSHOT_MAGIC,
+        .version = HT_SNAPSHOT_VERSION,
+        .hash_id = hash_id,
+        .seed = table->seed,
+        .slots = slot_count,
+        .count = collected.count,
+        .data_bytes = collected.data_bytes,
+    };
+    header.payload_checksum = ht_hash_wy(slots, slot_count * sizeof(struct ht_snapshot_slot), HT_SNAPSHOT_VERSION);
+    header.payload_checksum = ht_hash_wy(data, collected.data_bytes, header.payload_checksum);
+    header.header_checksum = snapshot_header_checksum(&header);
+
+    // written next to the target and renamed over it, so a reader never
+    // maps a half written image
+    const size_t path_len = strlen(path);
+    char *tmp_path = malloc(path_len + 5);
+    if (tmp_path == NULL)
+        exit(EXIT_FAILURE);
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
+    int result = -1;
+    FILE *file = fopen(tmp_path, "wb");
+    if (file != NULL)
+    {
+        const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                             fwrite(slots, sizeof(struct ht_snapshot_slot), slot_count, file) == slot_count &&
+                             fwrite(data, 1, collected.data_bytes, file) == collected.data_bytes;
+        if (fclose(file) == 0 && written && rename(tmp_path, path) == 0)
+            result = 0;
+        else
+            remove(tmp_path);
+    }
+    free(tmp_path);
+    free(data);
+    free(slots);
+    free(collected.items);
+    return result;
+}
+
+/**
+ * @brief checks that a mapped image is one this version can use
+ * @param constchar* first byte of the mapping
+ * @param size_t bytes mapped
+ * @param bool also check the payload checksum
+ * */
+static bool snapshot_valid(const char *base, const size_t length, const bool verify)
+{
+    if (length < sizeof(struct ht_snapshot_header))
+        return false;
+    const struct ht_snapshot_header *header = (const struct ht_snapshot_header *)base;
+    if (memcmp(header->magic, HT_SNAPSHOT_MAGIC, sizeof(HT_SNAPSHOT_MAGIC)) != 0 ||
+        header->version != HT_SNAPSHOT_VERSION ||
+        header->header_checksum != snapshot_header_checksum(header))
+        return false;
+    if (header->slots < 16 || (header->slots & (header->slots - 1)) != 0 || header->count >= header->slots ||
+        header->slots > (length - sizeof(struct ht_snapshot_header)) / sizeof(struct ht_snapshot_slot))
+        return false;
+    const uint64_t slot_bytes = header->slots * sizeof(struct ht_snapshot_slot);
+    if (sizeof(struct ht_snapshot_header) + slot_bytes + header->data_bytes != length)
+        return false;
+    if (!verify)
+        return true;
+    const char *slots = base + sizeof(struct ht_snapshot_header);
+    uint64_t checksum = ht_hash_wy(slots, slot_bytes, HT_SNAPSHOT_VERSION);
+    checksum = ht_hash_wy(slots + slot_bytes, header->data_bytes, checksum);
+    return checksum == header->payload_checksum;
+}
+
+Table *ht_open_mmap(const char *path, const int flags)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct ht_snapshot_header))
+    {
+        close(fd);
+        return NULL;
+    }
+    const size_t length = (size_t)st.st_size;
+    const bool writable = (flags & HT_MMAP_COPY_ON_WRITE) != 0;
+    char *base = mmap(NULL, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      writable ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+    const struct ht_snapshot_header *header = (const struct ht_snapshot_header *)base;
+    if (!snapshot_valid(base, length, (flags & HT_MMAP_VERIFY) != 0))
+    {
+        munmap(base, length);
+        return NULL;
+    }
+
+    struct mmap_store *store = malloc(sizeof(struct mmap_store));
+    if (store == NULL)
+        exit(EXIT_FAILURE);
+    store->base = base;
+    store->length = length;
+    store->slots = (struct ht_snapshot_slot *)(base + sizeof(struct ht_snapshot_header));
+    store->mask = header->slots - 1;
+    store->deleted = 0;
+    store->writable = writable;
+    store->own_slots = false;
+
+    const TableConfig config = {
+        .hash = header->hash_id == HT_SNAPSHOT_HASH_FNV1A ? ht_hash_fnv1a : ht_hash_wy,
+        .seed = header->seed,
+    };
+    Table *table = ht_new_with_config(&config);
+    pages_free(&table->pages, table->items, (size_t)table->size * sizeof(Item *));
+    table->items = NULL;
+    table->engine = &HT_MMAP_ENGINE;
+    table->store = store;
+    table->size = (int)header->slots;
+    table->base_size = table->size;
+    table->count = (int)header->count;
+    return table;
+}
+
+/**
+ * @brief key bytes of a slot, in the mapping or, for keys inserted into
+ * a copy-on-write table, in the table arena
+ * */
+static inline char *mmap_key(const struct mmap_store *store, const struct ht_snapshot_slot *slot)
+{
+    return (char *)((uintptr_t)store->base + slot->offset);
+}
+
+/**
+ * @brief fills an item with the pointers and lengths of a slot
+ * */
+static inline void mmap_item(const struct mmap_store *store, const struct ht_snapshot_slot *slot, Item *item)
+{
+    item->key = mmap_key(store, slot);
+    item->value = item->key + slot->key_len + 1;
+    item->is_inline = 0;
+    item->is_timed = 0;
+    item->hash = slot->hash;
+    item->key_len = slot->key_len;
+    item->value_len = slot->value_len;
+}
+
+/**
+ * @brief whether the bytes of a stored slot lie in the mapping, so images
+ * opened without HT_MMAP_VERIFY never send a lookup outside it. Keys
+ * inserted into a copy-on-write table live in the arena, past the image.
+ * */
+static inline bool mmap_slot_fits(const struct mmap_store *store, const struct ht_snapshot_slot *slot)
+{
+    if (slot->offset >= store->length)
+        return store->writable;
+    return (uint64_t)slot->key_len + slot->value_len + 2 <= store->length - slot->offset;
+}
+
+/**
+ * @brief returns the slot holding key or -1, a miss ends on the first
+ * empty slot, or after every slot in a corrupt image without one.
+ * HT_STATS builds add the slots examined to `*probes`.
+ * */
+static long mmap_lookup(const struct mmap_store *store, const void *key, const size_t key_len, const uint64_t hash, int *probes)
+{
+    (void)probes;
+    uint64_t idx = hash & store->mask;
+    for (uint64_t n = 0; n <= store->mask; n++, idx = (idx + 1) & store->mask)
+    {
+        HT_STATS_ONLY(++*probes;)
+        const struct ht_snapshot_slot *slot = &store->slots[idx];
+        if (slot->offset == SNAPSHOT_EMPTY)
+            return -1;
+        if (slot->offset != SNAPSHOT_DELETED && slot->hash == hash && slot->key_len == key_len &&
+            mmap_slot_fits(store, slot) && memcmp(mmap_key(store, slot), key, key_len) == 0)
+            return (long)idx;
+    }
+    return -1;
+}
+
+/**
+ * @brief rebuilds the slot array of a copy-on-write table in memory with
+ * `capacity` slots, dropping tombstones; key/value bytes do not move
+ * @param Table* table owning the store
+ * @param uint64_t new number of slots, a power of two
+ * */
+static void mmap_rehash(Table *table, const uint64_t capacity)
+{
+    HT_STATS_ONLY(const uint64_t resize_start = ht_stats_clock();)
+    struct mmap_store *store = table->store;
+    struct ht_snapshot_slot *slots = calloc(capacity, sizeof(struct ht_snapshot_slot));
+    if (slots == NULL)
+        exit(EXIT_FAILURE);
+    for (uint64_t i = 0; i <= store->mask; i++)
+    {
+        if (store->slots[i].offset != SNAPSHOT_EMPTY && store->slots[i].offset != SNAPSHOT_DELETED)
+            snapshot_place(slots, capacity - 1, &store->slots[i]);
+    }
+    if (store->own_slots)
+        free(store->slots);
+    store->slots = slots;
+    store->own_slots = true;
+    store->mask = capacity - 1;
+    store->deleted = 0;
+    table->size = (int)capacity;
+    table->base_size = table->size;
+    HT_STATS_ONLY(ht_stats_record_resize(table, resize_start);)
+}
+
+static void mmap_destroy(Table *table)
+{
+    struct mmap_store *store = table->store;
+    if (store->own_slots)
+        free(store->slots);
+    munmap(store->base, store->length);
+    free(store);
+    table->store = NULL;
+}
+
+/**
+ * @brief stores key/value in a copy-on-write table, the bytes go to the
+ * table arena and the slot refers to them relative to the mapping.
+ * Read-only tables and keys or values of 4 GB or more are ignored.
+ * */
+static void mmap_insert(Table *table, const void *key, const size_t key_len, const void *value, const size_t value_len, const uint64_t hash)
+{
+    struct mmap_store *store = table->store;
+    if (!store->writable || key_len > UINT32_MAX || value_len > UINT32_MAX)
+        return;
+    const uint64_t capacity = store->mask + 1;
+    if ((uint64_t)table->count + store->deleted + 1 > capacity * SNAPSHOT_MAX_LOAD / 8)
+        mmap_rehash(table, store->deleted > capacity / 4 ? capacity : capacity * 2);
+    Item item;
+    ht_store_item_strings(table, &item, key, key_len, value, value_len);
+    const struct ht_snapshot_slot slot = {
+        .hash = hash,
+        .offset = (uint64_t)((uintptr_t)item.key - (uintptr_t)store->base),
+        .key_len = (uint32_t)key_len,
+        .value_len = (uint32_t)value_len,
+    };
+    if (store->slots[snapshot_place(store->slots, store->mask, &slot)].offset == SNAPSHOT_DELETED)
+        store->deleted--;
+    table->count++;
+}
+
+static Item *mmap_find(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    // slots hold offsets, not pointers, so each thread gets an item to fill
+    static _Thread_local Item found;
+    const struct mmap_store *store = table->store;
+    int probes = 0;
+    const long slot = mmap_lookup(store, key, key_len, hash, &probes);
+    HT_STATS_ONLY(ht_stats_record_probe(table, slot >= 0, probes);)
+    if (slot < 0)
+        return NULL;
+    mmap_item(store, &store->slots[slot], &found);
+    return &found;
+}
+
+/**
+ * @brief removes every item stored under key from a copy-on-write table,
+ * read-only tables are left unchanged
+ * */
+static void mmap_remove(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    struct mmap_store *store = table->store;
+    if (!store->writable)
+        return;
+    long slot;
+    int probes = 0;
+    while ((slot = mmap_lookup(store, key, key_len, hash, &probes)) >= 0)
+    {
+        Item item;
+        mmap_item(store, &store->slots[slot], &item);
+        // bytes inserted after the table was mapped live in the arena
+        if (store->slots[slot].offset >= store->length)
+            ht_release_item_strings(table, &item);
+        store->slots[slot].offset = SNAPSHOT_DELETED;
+        store->deleted++;
+        table->count--;
+    }
+}
+
+static void mmap_each(Table *table, HtItemFn fn, void *ctx)
+{
+    const struct mmap_store *store = table->store;
+    for (uint64_t i = 0; i <= store->mask; i++)
+    {
+        if (store->slots[i].offset == SNAPSHOT_EMPTY || store->slots[i].offset == SNAPSHOT_DELETED ||
+            !mmap_slot_fits(store, &store->slots[i]))
+            continue;
+        Item item;
+        mmap_item(store, &store->slots[i], &item);
+        fn(&item, ctx);
+    }
+}
+
+/**
+ * @brief moves the slot array of a copy-on-write table to the heap with
+ * room for `items`, read-only tables are left unchanged
+ * */
+static void mmap_reserve(Table *table, const int items)
+{
+    const struct mmap_store *store = table->store;
+    uint64_t capacity = store->mask + 1;
+    while (capacity * SNAPSHOT_MAX_LOAD / 8 < (uint64_t)items)
+        capacity *= 2;
+    if (store->writable && capacity > store->mask + 1)
+        mmap_rehash(table, capacity);
+}
+
+/**
+ * @brief scans home slots, the slots of a home lie in the linear probe
+ * run from it to the first empty slot
+ * */
+static uint64_t mmap_scan(Table *table, uint64_t cursor, struct ht_scan_batch *batch, int budget)
+{
+    const struct mmap_store *store = table->store;
+    int examined = 0;
+    do
+    {
+        const uint64_t home = cursor & store->mask;
+        uint64_t idx = home;
+        for (uint64_t n = 0; n <= store->mask; n++, idx = (idx + 1) & store->mask)
+        {
+            const struct ht_snapshot_slot *slot = &store->slots[idx];
+            examined++;
+            if (slot->offset == SNAPSHOT_EMPTY)
+                break;
+            if (slot->offset != SNAPSHOT_DELETED && (slot->hash & store->mask) == home && mmap_slot_fits(store, slot))
+            {
+                Item item;
+                mmap_item(store, slot, &item);
+                ht_scan_push(batch, &item);
+            }
+        }
+        cursor = ht_scan_next(cursor, store->mask);
+    } while (cursor != 0 && examined < budget);
+    return cursor;
+}
+
+static void mmap_stats(Table *table, TableStats *stats)
+{
+    const struct mmap_store *store = table->store;
+    stats->tombstones = (int)store->deleted;
+    stats->slot_bytes = (store->mask + 1) * sizeof(struct ht_snapshot_slot);
+}
+
+// mapped tables only come from `ht_open_mmap`, there is no `init`
+const struct ht_engine HT_MMAP_ENGINE = {
+    .destroy = mmap_destroy,
+    .insert = mmap_insert,
+    .find = mmap_find,
+    .remove = mmap_remove,
+    .each = mmap_each,
+    .reserve = mmap_reserve,
+    .stats = mmap_stats,
+    .scan = mmap_scan,
+};
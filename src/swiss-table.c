@@ -0,0 +1,324 @@
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "../lib/ht-engine.h"
+
+/**
+ * Control byte values. A full slot stores the low 7 bits of its hash,
+ * so every special value has the top bit set.
+ * */
+#define SWISS_EMPTY ((uint8_t)0x80)
+#define SWISS_DELETED ((uint8_t)0xFE)
+#define SWISS_GROUP_WIDTH 16
+
+/**
+ * @brief Structural definition for the swiss table storage: one control
+ * byte per slot and the slots themselves stored inline, both split in
+ * groups of SWISS_GROUP_WIDTH that are probed together
+ * */
+struct swiss_store
+{
+    // control bytes, one per slot, 16 byte aligned
+    uint8_t *ctrl;
+    // inline items, slot i is described by ctrl[i]
+    Item *slots;
+    // number of groups, always a power of two
+    size_t groups;
+    // inserts left before the store has to grow or drop tombstones
+    size_t growth_left;
+    // slots marked SWISS_DELETED
+    size_t deleted;
+};
+
+static inline uint8_t swiss_h2(const uint64_t hash)
+{
+    return (uint8_t)(hash & 0x7f);
+}
+
+static inline size_t swiss_h1(const uint64_t hash)
+{
+    return (size_t)(hash >> 7);
+}
+
+/**
+ * @brief returns a bit mask of the slots of a group whose control byte
+ * equals `value` (bit i set for slot i)
+ * @param constuint8_t* first control byte of the group
+ * @param uint8_t control byte to look for
+ * */
+static inline uint32_t swiss_match(const uint8_t *group, uint8_t value)
+{
+#if defined(__SSE2__)
+    const __m128i ctrl = _mm_load_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < SWISS_GROUP_WIDTH; i++)
+        mask |= (uint32_t)(group[i] == value) << i;
+    return mask;
+#endif
+}
+
+/**
+ * @brief returns a bit mask of the slots of a group that are empty or deleted
+ * @param constuint8_t* first control byte of the group
+ * */
+static inline uint32_t swiss_match_free(const uint8_t *group)
+{
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < SWISS_GROUP_WIDTH; i++)
+        mask |= (uint32_t)(group[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+/**
+ * @brief allocates empty control bytes and slots for `groups` groups
+ * @param structswiss_store* store to fill
+ * @param size_t number of groups, a power of two
+ * */
+static void swiss_alloc(struct swiss_store *store, size_t groups)
+{
+    const size_t capacity = groups * SWISS_GROUP_WIDTH;
+    store->ctrl = aligned_alloc(SWISS_GROUP_WIDTH, capacity);
+    store->slots = malloc(capacity * sizeof(Item));
+    if (store->ctrl == NULL || store->slots == NULL)
+        exit(EXIT_FAILURE);
+    memset(store->ctrl, SWISS_EMPTY, capacity);
+    store->groups = groups;
+    store->growth_left = capacity - capacity / 8;
+    store->deleted = 0;
+}
+
+/**
+ * @brief finds a free slot for hash, probing group by group with
+ * triangular steps so every group is visited once
+ * @param structswiss_store* store to probe
+ * @param constuint64_t hash of the key
+ * */
+static size_t swiss_find_free(const struct swiss_store *store, const uint64_t hash)
+{
+    size_t group = swiss_h1(hash) & (store->groups - 1);
+    for (size_t step = 1;; step++)
+    {
+        const uint32_t free_mask = swiss_match_free(store->ctrl + group * SWISS_GROUP_WIDTH);
+        if (free_mask != 0)
+            return group * SWISS_GROUP_WIDTH + (size_t)__builtin_ctz(free_mask);
+        group = (group + step) & (store->groups - 1);
+    }
+}
+
+/**
+ * @brief rebuilds the store with `groups` groups, moving every item by value.
+ * Keys and values are not copied and tombstones are dropped.
+ * @param Table* table owning the store
+ * @param size_t new number of groups
+ * */
+static void swiss_rehash(Table *table, size_t groups)
+{
+    HT_STATS_ONLY(const uint64_t resize_start = ht_stats_clock();)
+    struct swiss_store *store = table->store;
+    struct swiss_store old = *store;
+    swiss_alloc(store, groups);
+    const size_t old_capacity = old.groups * SWISS_GROUP_WIDTH;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old.ctrl[i] & 0x80)
+            continue;
+        const size_t slot = swiss_find_free(store, old.slots[i].hash);
+        store->ctrl[slot] = old.ctrl[i];
+        store->slots[slot] = old.slots[i];
+    }
+    store->growth_left -= (size_t)table->count;
+    table->size = (int)(groups * SWISS_GROUP_WIDTH);
+    table->base_size = table->size;
+    free(old.ctrl);
+    free(old.slots);
+    HT_STATS_ONLY(ht_stats_record_resize(table, resize_start);)
+}
+
+static void swiss_init(Table *table, const int min_items)
+{
+    struct swiss_store *store = malloc(sizeof(struct swiss_store));
+    if (store == NULL)
+        exit(EXIT_FAILURE);
+    size_t groups = 1;
+    while (groups * SWISS_GROUP_WIDTH * 7 / 8 < (size_t)min_items)
+        groups *= 2;
+    swiss_alloc(store, groups);
+    table->store = store;
+    table->items = NULL;
+    table->size = (int)(groups * SWISS_GROUP_WIDTH);
+    table->base_size = table->size;
+    table->count = 0;
+}
+
+static void swiss_destroy(Table *table)
+{
+    struct swiss_store *store = table->store;
+    free(store->ctrl);
+    free(store->slots);
+    free(store);
+    table->store = NULL;
+}
+
+static void swiss_insert(Table *table, const void *key, const size_t key_len, const void *value, const size_t value_len, const uint64_t hash)
+{
+    struct swiss_store *store = table->store;
+    size_t slot = swiss_find_free(store, hash);
+    if (store->growth_left == 0 && store->ctrl[slot] != SWISS_DELETED)
+    {
+        // mostly tombstones: rebuild in place, otherwise double
+        const size_t capacity = store->groups * SWISS_GROUP_WIDTH;
+        swiss_rehash(table, store->deleted > capacity / 4 ? store->groups : store->groups * 2);
+        slot = swiss_find_free(store, hash);
+    }
+    if (store->ctrl[slot] == SWISS_DELETED)
+        store->deleted--;
+    else
+        store->growth_left--;
+    store->ctrl[slot] = swiss_h2(hash);
+    ht_store_item_strings(table, &store->slots[slot], key, key_len, value, value_len);
+    store->slots[slot].hash = hash;
+    table->count++;
+}
+
+/**
+ * @brief returns the slot holding key or -1, scanning whole groups until
+ * one that contains an empty slot. HT_STATS builds add the number of
+ * groups scanned to `*probes`.
+ * */
+static long swiss_lookup(const struct swiss_store *store, const void *key, const size_t key_len, const uint64_t hash, int *probes)
+{
+    (void)probes;
+    const uint8_t h2 = swiss_h2(hash);
+    size_t group = swiss_h1(hash) & (store->groups - 1);
+    for (size_t step = 1; step <= store->groups; step++)
+    {
+        HT_STATS_ONLY(++*probes;)
+        const uint8_t *ctrl = store->ctrl + group * SWISS_GROUP_WIDTH;
+        for (uint32_t match = swiss_match(ctrl, h2); match != 0; match &= match - 1)
+        {
+            const size_t slot = group * SWISS_GROUP_WIDTH + (size_t)__builtin_ctz(match);
+            if (ht_item_matches(&store->slots[slot], key, key_len, hash))
+                return (long)slot;
+        }
+        if (swiss_match(ctrl, SWISS_EMPTY) != 0)
+            return -1;
+        group = (group + step) & (store->groups - 1);
+    }
+    return -1;
+}
+
+static Item *swiss_find(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    const struct swiss_store *store = table->store;
+    int probes = 0;
+    const long slot = swiss_lookup(store, key, key_len, hash, &probes);
+    HT_STATS_ONLY(ht_stats_record_probe(table, slot >= 0, probes);)
+    return slot < 0 ? NULL : &store->slots[slot];
+}
+
+static void swiss_remove(Table *table, const void *key, const size_t key_len, const uint64_t hash)
+{
+    struct swiss_store *store = table->store;
+    long slot;
+    int probes = 0;
+    while ((slot = swiss_lookup(store, key, key_len, hash, &probes)) >= 0)
+    {
+        ht_release_item_strings(table, &store->slots[slot]);
+        // a group that still has an empty slot never ended a probe, so the
+        // slot can go back to empty; otherwise later keys may live past it
+        const uint8_t *group = store->ctrl + ((size_t)slot & ~(size_t)(SWISS_GROUP_WIDTH - 1));
+        if (swiss_match(group, SWISS_EMPTY) != 0)
+        {
+            store->ctrl[slot] = SWISS_EMPTY;
+            store->growth_left++;
+        }
+        else
+        {
+            store->ctrl[slot] = SWISS_DELETED;
+            store->deleted++;
+        }
+        table->count--;
+    }
+}
+
+static void swiss_reserve(Table *table, const int items)
+{
+    const struct swiss_store *store = table->store;
+    size_t groups = store->groups;
+    while (groups * SWISS_GROUP_WIDTH * 7 / 8 < (size_t)items)
+        groups *= 2;
+    if (groups > store->groups)
+        swiss_rehash(table, groups);
+}
+
+/**
+ * @brief scans home groups: the items whose probe starts in a group lie
+ * on its probe sequence up to the first group with an empty slot
+ * */
+static uint64_t swiss_scan(Table *table, uint64_t cursor, struct ht_scan_batch *batch, int budget)
+{
+    const struct swiss_store *store = table->store;
+    const size_t mask = store->groups - 1;
+    int examined = 0;
+    do
+    {
+        const size_t home = (size_t)cursor & mask;
+        size_t group = home;
+        for (size_t step = 1; step <= store->groups; step++)
+        {
+            const uint8_t *ctrl = store->ctrl + group * SWISS_GROUP_WIDTH;
+            for (uint32_t full = ~swiss_match_free(ctrl) & 0xFFFF; full != 0; full &= full - 1)
+            {
+                const Item *item = &store->slots[group * SWISS_GROUP_WIDTH + (size_t)__builtin_ctz(full)];
+                if ((swiss_h1(item->hash) & mask) == home)
+                    ht_scan_push(batch, item);
+            }
+            examined += SWISS_GROUP_WIDTH;
+            if (swiss_match(ctrl, SWISS_EMPTY) != 0)
+                break;
+            group = (group + step) & mask;
+        }
+        cursor = ht_scan_next(cursor, mask);
+    } while (cursor != 0 && examined < budget);
+    return cursor;
+}
+
+static void swiss_stats(Table *table, TableStats *stats)
+{
+    const struct swiss_store *store = table->store;
+    stats->tombstones = (int)store->deleted;
+    stats->slot_bytes = store->groups * SWISS_GROUP_WIDTH * (sizeof(Item) + 1);
+}
+
+static void swiss_each(Table *table, HtItemFn fn, void *ctx)
+{
+    const struct swiss_store *store = table->store;
+    const size_t capacity = store->groups * SWISS_GROUP_WIDTH;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        if (!(store->ctrl[i] & 0x80))
+            fn(&store->slots[i], ctx);
+    }
+}
+
+const struct ht_engine HT_SWISS_ENGINE = {
+    .init = swiss_init,
+    .destroy = swiss_destroy,
+    .insert = swiss_insert,
+    .find = swiss_find,
+    .remove = swiss_remove,
+    .each = swiss_each,
+    .reserve = swiss_reserve,
+    .stats = swiss_stats,
+    .scan = swiss_scan,
+};
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../lib/arena.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+
+static Arena* arena = NULL;
+
+int init_arena_suite(void){
+    arena = arena_new();
+    return arena == NULL ? -1 : 0;
+}
+
+int cleanup_arena_suite(void){
+    arena_destroy(arena);
+    return 0;
+}
+
+void test_alloc_is_aligned(void){
+    for (size_t size = 0; size < 64; size++)
+    {
+        void* block = arena_alloc(arena, size);
+        CU_ASSERT_EQUAL((size_t)block % ARENA_ALIGN, 0);
+    }
+}
+
+void test_free_block_is_reused(void){
+    char* first = arena_alloc(arena, 24);
+    arena_free(arena, first, 24);
+    char* second = arena_alloc(arena, 20);
+    CU_ASSERT_PTR_EQUAL(first, second);
+    arena_free(arena, second, 20);
+}
+
+void test_large_blocks_are_tracked(void){
+    const size_t in_use = arena->bytes_in_use;
+    char* large = arena_alloc(arena, 4 * ARENA_MAX_SMALL);
+    memset(large, 'x', 4 * ARENA_MAX_SMALL);
+    CU_ASSERT_EQUAL(arena->bytes_in_use, in_use + 4 * ARENA_MAX_SMALL);
+    arena_free(arena, large, 4 * ARENA_MAX_SMALL);
+    CU_ASSERT_EQUAL(arena->bytes_in_use, in_use);
+    // left allocated on purpose, arena_destroy must release it
+    arena_alloc(arena, 2 * ARENA_MAX_SMALL);
+}
+
+void test_merge_moves_blocks(void){
+    Arena* other = arena_new();
+    char* small = arena_alloc(other, 40);
+    char* large = arena_alloc(other, 2 * ARENA_MAX_SMALL);
+    char* freed = arena_alloc(other, 16);
+    arena_free(other, freed, 16);
+    const size_t in_use = arena->bytes_in_use;
+    arena_merge(arena, other);
+    CU_ASSERT_EQUAL(arena->bytes_in_use, in_use + 40 + 2 * ARENA_MAX_SMALL);
+    // blocks of the merged arena are freed to, and reused by, the other one
+    arena_free(arena, small, 40);
+    arena_free(arena, large, 2 * ARENA_MAX_SMALL);
+    CU_ASSERT_EQUAL(arena->bytes_in_use, in_use);
+    CU_ASSERT_PTR_EQUAL(arena_alloc(arena, 40), small);
+}
+
+void test_paged_arena_maps_chunks(void){
+    const struct page_policy huge = {.pages = HT_PAGES_TRANSPARENT};
+    Arena* paged = arena_new_paged(&huge);
+    char* first = arena_alloc(paged, 40);
+    // the first block sits right after the header of a huge page aligned chunk
+    CU_ASSERT((uintptr_t)first % HT_HUGE_PAGE_SIZE < 64);
+    CU_ASSERT_EQUAL(paged->bytes_reserved, ARENA_MAX_CHUNK);
+    for (int i = 0; i < 200000; i++)
+        memset(arena_alloc(paged, 40), 'x', 40);
+    // heap chunks merged in are freed to the heap
+    Arena* heap = arena_new();
+    arena_alloc(heap, 40);
+    arena_merge(paged, heap);
+    arena_destroy(paged);
+}
+
+int main(void)
+{
+    CU_pSuite suite = NULL;
+
+    if(CU_initialize_registry()!=CUE_SUCCESS)
+        return CU_get_error();
+
+    suite =  CU_add_suite("Testing the table arena",init_arena_suite,cleanup_arena_suite);
+    if(suite==NULL){
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    if(
+        CU_add_test(suite,"Test AllocIsAligned()",test_alloc_is_aligned)==NULL||
+        CU_add_test(suite,"Test FreeBlockIsReused()",test_free_block_is_reused)==NULL||
+        CU_add_test(suite,"Test LargeBlocksAreTracked()",test_large_blocks_are_tracked)==NULL||
+        CU_add_test(suite,"Test MergeMovesBlocks()",test_merge_moves_blocks)==NULL||
+        CU_add_test(suite,"Test PagedArenaMapsChunks()",test_paged_arena_maps_chunks)==NULL
+    ){
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_NORMAL);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../lib/hash-table.h"
+#include "../lib/bulk-load.h"
+#include "../lib/intern-pool.h"
+
+#define BULK_TEST_KEYS 20000
+#define BULK_TEST_PATH "bulk_load_test.dat"
+
+int initialize_bulk_load_suite(void){
+    return 0;
+}
+
+int cleanup_bulk_load_suite(void){
+    remove(BULK_TEST_PATH);
+    return 0;
+}
+
+static void write_length_prefixed(FILE* file, const void* bytes, const uint32_t len){
+    fwrite(&len, sizeof(len), 1, file);
+    fwrite(bytes, 1, len, file);
+}
+
+void test_load_tsv_in_parallel(){
+    FILE* file = fopen(BULK_TEST_PATH, "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    for (int i = 0; i < BULK_TEST_KEYS; i++)
+        fprintf(file, "key-%d\tvalue-%d\n", i, i);
+    fprintf(file, "\nlonely-key");
+    fclose(file);
+
+    TableConfig configs[3] = {{.capacity_policy=HT_CAPACITY_PRIME}, {.capacity_policy=HT_CAPACITY_POW2},
+                              {.capacity_policy=HT_CAPACITY_POW2, .lookup_filter=true}};
+    for (int c = 0; c < 3; c++)
+    {
+        BulkLoadOptions options = {.format=HT_BULK_TSV, .threads=4};
+        Table* table = ht_bulk_load(BULK_TEST_PATH, &configs[c], &options);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+        CU_ASSERT_EQUAL(table->count, BULK_TEST_KEYS + 1);
+        const int size = table->size;
+        char key[32], value[32];
+        for (int i = 0; i < BULK_TEST_KEYS; i++)
+        {
+            sprintf(key, "key-%d", i);
+            sprintf(value, "value-%d", i);
+            CU_ASSERT_STRING_EQUAL(ht_find(table, key), value);
+        }
+        CU_ASSERT_STRING_EQUAL(ht_find(table, "lonely-key"), "");
+        // the table was sized for the file, topping it up does not resize
+        for (int i = 0; i < BULK_TEST_KEYS / 4; i++)
+        {
+            sprintf(key, "key-%d", i);
+            ht_delete(table, key);
+            table = ht_insert(table, key, "again");
+        }
+        CU_ASSERT_EQUAL(table->size, size);
+        CU_ASSERT_STRING_EQUAL(ht_find(table, "key-0"), "again");
+        delete_Table(table);
+    }
+}
+
+void test_load_length_prefixed_into_engines(){
+    FILE* file = fopen(BULK_TEST_PATH, "wb");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    char key[32];
+    for (int i = 0; i < BULK_TEST_KEYS; i++)
+    {
+        const int len = sprintf(key, "k%c%d", '\0', i);
+        write_length_prefixed(file, key, (uint32_t)len);
+        write_length_prefixed(file, &i, sizeof(i));
+    }
+    fclose(file);
+
+    TableConfig configs[3] = {{.engine=HT_ENGINE_DOUBLE_HASH}, {.engine=HT_ENGINE_SWISS}, {.engine=HT_ENGINE_ROBIN_HOOD}};
+    for (int c = 0; c < 3; c++)
+    {
+        BulkLoadOptions options = {.format=HT_BULK_LENGTH_PREFIXED, .threads=3};
+        Table* table = ht_bulk_load(BULK_TEST_PATH, &configs[c], &options);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+        CU_ASSERT_EQUAL(table->count, BULK_TEST_KEYS);
+        for (int i = 0; i < BULK_TEST_KEYS; i++)
+        {
+            const int len = sprintf(key, "k%c%d", '\0', i);
+            size_t value_len = 0;
+            char* found = ht_find_bytes(table, key, (size_t)len, &value_len);
+            CU_ASSERT_PTR_NOT_NULL(found);
+            if (found != NULL){
+                CU_ASSERT_EQUAL(value_len, sizeof(i));
+                CU_ASSERT(memcmp(found, &i, sizeof(i)) == 0);
+            }
+        }
+        delete_Table(table);
+    }
+}
+
+void test_load_into_interning_table(){
+    FILE* file = fopen(BULK_TEST_PATH, "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    for (int i = 0; i < BULK_TEST_KEYS; i++)
+        fprintf(file, "customer-%d\t%s\n", i, i % 3 ? "region-europe-west-central" : "region-us-east-north");
+    fclose(file);
+
+    TableConfig config = {.intern_values=true};
+    BulkLoadOptions options = {.format=HT_BULK_TSV, .threads=4};
+    Table* table = ht_bulk_load(BULK_TEST_PATH, &config, &options);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+    CU_ASSERT_EQUAL(table->count, BULK_TEST_KEYS);
+    CU_ASSERT_EQUAL(table->values->count, 2);
+    CU_ASSERT_PTR_EQUAL(ht_find(table, "customer-1"), ht_find(table, "customer-2"));
+    CU_ASSERT_STRING_EQUAL(ht_find(table, "customer-3"), "region-us-east-north");
+    for (int i = 0; i < BULK_TEST_KEYS; i += 3)
+    {
+        char key[32];
+        sprintf(key, "customer-%d", i);
+        ht_delete(table, key);
+    }
+    CU_ASSERT_EQUAL(table->values->count, 1);
+    delete_Table(table);
+}
+
+void test_reject_truncated_files(){
+    FILE* file = fopen(BULK_TEST_PATH, "wb");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    write_length_prefixed(file, "key", 3);
+    const uint32_t len = 100;
+    fwrite(&len, sizeof(len), 1, file);
+    fwrite("short", 1, 5, file);
+    fclose(file);
+    BulkLoadOptions options = {.format=HT_BULK_LENGTH_PREFIXED};
+    CU_ASSERT_PTR_NULL(ht_bulk_load(BULK_TEST_PATH, NULL, &options));
+    CU_ASSERT_PTR_NULL(ht_bulk_load("missing.dat", NULL, NULL));
+
+    file = fopen(BULK_TEST_PATH, "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    fclose(file);
+    Table* empty = ht_bulk_load(BULK_TEST_PATH, NULL, NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(empty);
+    CU_ASSERT_EQUAL(empty->count, 0);
+    delete_Table(empty);
+}
+
+int main(){
+    if(CU_initialize_registry()==CUE_NOMEMORY){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_pSuite bulk_load_suite = CU_add_suite("TestSuite::Bulk_Load",initialize_bulk_load_suite,cleanup_bulk_load_suite);
+    if(bulk_load_suite==NULL){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if(
+        CU_add_test(bulk_load_suite,"Should load a TSV file with several threads",test_load_tsv_in_parallel)==NULL||
+        CU_add_test(bulk_load_suite,"Should load length prefixed records into every engine",test_load_length_prefixed_into_engines)==NULL||
+        CU_add_test(bulk_load_suite,"Should load into a table interning its values",test_load_into_interning_table)==NULL||
+        CU_add_test(bulk_load_suite,"Should reject truncated and missing files",test_reject_truncated_files)==NULL
+    ){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}
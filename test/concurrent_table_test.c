@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../lib/concurrent-table.h"
+
+#define CT_TEST_THREADS 8
+#define CT_TEST_KEYS 2000
+
+static ConcurrentTable* table;
+
+struct worker_args{
+    ConcurrentTable* table;
+    int id;
+};
+
+int initialize_concurrent_table_suite(void){
+    if((table=ct_new(16, CT_LOCK_RWLOCK, NULL))==NULL){
+        return 1;
+    }
+    return 0;
+}
+
+int cleanup_concurrent_table_suite(void){
+    if(table==NULL)
+        return 1;
+    delete_ConcurrentTable(table);
+    return 0;
+}
+
+static void* insert_worker(void* arg){
+    struct worker_args* args = arg;
+    char key[32];
+    for (int i = 0; i < CT_TEST_KEYS; i++)
+    {
+        sprintf(key, "t%d-key-%d", args->id, i);
+        ct_insert(args->table, key, key);
+    }
+    // delete every other key while the other threads still insert
+    for (int i = 0; i < CT_TEST_KEYS; i += 2)
+    {
+        sprintf(key, "t%d-key-%d", args->id, i);
+        ct_delete(args->table, key);
+    }
+    return NULL;
+}
+
+static void run_workers(ConcurrentTable* target){
+    pthread_t threads[CT_TEST_THREADS];
+    struct worker_args args[CT_TEST_THREADS];
+    for (int t = 0; t < CT_TEST_THREADS; t++)
+    {
+        args[t].table = target;
+        args[t].id = t;
+        pthread_create(&threads[t], NULL, insert_worker, &args[t]);
+    }
+    for (int t = 0; t < CT_TEST_THREADS; t++)
+        pthread_join(threads[t], NULL);
+}
+
+static void check_contents(ConcurrentTable* target){
+    char key[32], value[32];
+    CU_ASSERT_EQUAL(ct_count(target), CT_TEST_THREADS * CT_TEST_KEYS / 2);
+    for (int t = 0; t < CT_TEST_THREADS; t++)
+    {
+        for (int i = 0; i < CT_TEST_KEYS; i++)
+        {
+            sprintf(key, "t%d-key-%d", t, i);
+            const bool found = ct_find(target, key, value, sizeof(value));
+            CU_ASSERT_EQUAL(found, i % 2 == 1);
+            if (found)
+                CU_ASSERT_STRING_EQUAL(value, key);
+        }
+    }
+}
+
+void test_parallel_insert_and_delete(){
+    run_workers(table);
+    check_contents(table);
+}
+
+void test_spinlock_shards(){
+    TableConfig config = {.capacity_policy=HT_CAPACITY_POW2};
+    ConcurrentTable* spin = ct_new(4, CT_LOCK_SPIN, &config);
+    CU_ASSERT_PTR_NOT_NULL(spin);
+    run_workers(spin);
+    check_contents(spin);
+    delete_ConcurrentTable(spin);
+}
+
+static void* find_worker(void* arg){
+    struct worker_args* args = arg;
+    char key[32], value[32];
+    for (int n = 0; n < 4; n++)
+    {
+        for (int i = 0; i < CT_TEST_KEYS; i++)
+        {
+            sprintf(key, "key-%d", i);
+            if (ct_find(args->table, key, value, sizeof(value)))
+                CU_ASSERT_STRING_EQUAL(value, key);
+        }
+    }
+    return NULL;
+}
+
+static void run_finders(ConcurrentTable* target){
+    pthread_t threads[CT_TEST_THREADS];
+    struct worker_args args[CT_TEST_THREADS];
+    for (int t = 0; t < CT_TEST_THREADS; t++)
+    {
+        args[t].table = target;
+        args[t].id = t;
+        pthread_create(&threads[t], NULL, find_worker, &args[t]);
+    }
+    for (int t = 0; t < CT_TEST_THREADS; t++)
+        pthread_join(threads[t], NULL);
+}
+
+void test_cache_shards(){
+    // cache hits mark entries, lookups of a shard must not run together
+    TableConfig config = {.eviction=HT_EVICT_SAMPLED_LRU, .max_entries=CT_TEST_KEYS / 8};
+    ConcurrentTable* cache = ct_new(2, CT_LOCK_RWLOCK, &config);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cache);
+    char key[32];
+    for (int i = 0; i < CT_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ct_insert(cache, key, key);
+    }
+    run_finders(cache);
+    CU_ASSERT(ct_count(cache) <= CT_TEST_KEYS / 4);
+    delete_ConcurrentTable(cache);
+}
+
+void test_lookup_counters(){
+    // readers of a shard share its read lock, none of their counts may be lost
+    ConcurrentTable* counted = ct_new(2, CT_LOCK_RWLOCK, NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(counted);
+    char key[32];
+    for (int i = 0; i < CT_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ct_insert(counted, key, key);
+    }
+    for (int s = 0; s < counted->shard_count; s++)
+        ht_stats_reset(counted->shards[s].table);
+    run_finders(counted);
+    uint64_t lookups = 0;
+    TableStats stats;
+    for (int s = 0; s < counted->shard_count; s++)
+    {
+        ht_stats(counted->shards[s].table, &stats);
+        for (int b = 0; b < HT_STATS_PROBE_BUCKETS; b++)
+            lookups += stats.hit_probes[b] + stats.miss_probes[b];
+    }
+    if (stats.counters_enabled)
+        CU_ASSERT_EQUAL(lookups, (uint64_t)CT_TEST_THREADS * 4 * CT_TEST_KEYS);
+    delete_ConcurrentTable(counted);
+}
+
+void test_filtered_shards(){
+    // the shard is picked by the top bits of the hash, the filter blocks
+    // of a shard must still spread over all of them
+    TableConfig config = {.lookup_filter=true};
+    ConcurrentTable* filtered = ct_new(64, CT_LOCK_RWLOCK, &config);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(filtered);
+    char key[32], value[32];
+    for (int i = 0; i < CT_TEST_KEYS * 8; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ct_insert(filtered, key, key);
+    }
+    for (int s = 0; s < filtered->shard_count; s++)
+        ht_stats_reset(filtered->shards[s].table);
+    for (int i = 0; i < CT_TEST_KEYS * 8; i++)
+    {
+        sprintf(key, "absent-%d", i);
+        CU_ASSERT_FALSE(ct_find(filtered, key, value, sizeof(value)));
+    }
+    uint64_t rejects = 0, false_positives = 0;
+    TableStats stats;
+    for (int s = 0; s < filtered->shard_count; s++)
+    {
+        ht_stats(filtered->shards[s].table, &stats);
+        rejects += stats.filter_rejects;
+        false_positives += stats.filter_false_positives;
+    }
+#ifdef HT_STATS
+    CU_ASSERT_EQUAL(rejects + false_positives, CT_TEST_KEYS * 8);
+    CU_ASSERT(false_positives < CT_TEST_KEYS * 8 * 0.05);
+#endif
+    delete_ConcurrentTable(filtered);
+}
+
+static uint64_t fake_now;
+
+static uint64_t fake_clock(void){
+    return fake_now;
+}
+
+void test_ttl_shards(){
+    // lookups reclaim expired entries, readers of a shard must not free
+    // the same entry
+    TableConfig config = {.clock=fake_clock};
+    ConcurrentTable* timed = ct_new(2, CT_LOCK_RWLOCK, &config);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(timed);
+    char key[32];
+    for (int i = 0; i < CT_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ct_insert_with_ttl(timed, key, key, 100);
+    }
+    CU_ASSERT_EQUAL(ct_count(timed), CT_TEST_KEYS);
+    fake_now += 100;
+    run_finders(timed);
+    CU_ASSERT_EQUAL(ct_count(timed), 0);
+    delete_ConcurrentTable(timed);
+
+    // shards of other engines store the entries without a TTL
+    TableConfig swiss = {.engine=HT_ENGINE_SWISS, .clock=fake_clock};
+    ConcurrentTable* untimed = ct_new(2, CT_LOCK_RWLOCK, &swiss);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(untimed);
+    ct_insert_with_ttl(untimed, "session", "alice", 100);
+    fake_now += 200;
+    char value[32];
+    CU_ASSERT_TRUE(ct_find(untimed, "session", value, sizeof(value)));
+    CU_ASSERT_STRING_EQUAL(value, "alice");
+    delete_ConcurrentTable(untimed);
+}
+
+int main(){
+    if(CU_initialize_registry()==CUE_NOMEMORY){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_pSuite concurrent_table_suite = CU_add_suite("TestSuite::Concurrent_Table",initialize_concurrent_table_suite,cleanup_concurrent_table_suite);
+    if(concurrent_table_suite==NULL){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if(
+        CU_add_test(concurrent_table_suite,"Should insert and delete from many threads",test_parallel_insert_and_delete)==NULL||
+        CU_add_test(concurrent_table_suite,"Should work with spinlocked shards",test_spinlock_shards)==NULL||
+        CU_add_test(concurrent_table_suite,"Should look up cache shards from many threads",test_cache_shards)==NULL||
+        CU_add_test(concurrent_table_suite,"Should count lookups from many threads",test_lookup_counters)==NULL||
+        CU_add_test(concurrent_table_suite,"Should filter absent keys of every shard",test_filtered_shards)==NULL||
+        CU_add_test(concurrent_table_suite,"Should reclaim expired entries from many threads",test_ttl_shards)==NULL
+    ){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}
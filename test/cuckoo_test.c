@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../lib/hash-table.h"
+
+#define CUCKOO_TEST_KEYS 50000
+
+static Table* table;
+
+int initialize_cuckoo_suite(void){
+    TableConfig config = {.engine=HT_ENGINE_CUCKOO};
+    if((table=ht_new_with_config(&config))==NULL){
+        return 1;
+    }
+    return 0;
+}
+
+int cleanup_cuckoo_suite(void){
+    if(table==NULL)
+        return 1;
+    delete_Table(table);
+    return 0;
+}
+
+void test_insert_and_find_with_growth(){
+    char key[32], value[32];
+    double fullest = 0;
+    for (int i = 0; i < CUCKOO_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        const int size = table->size;
+        ht_insert(table, key, value);
+        // load just before each growth
+        if (table->size != size && (double)(table->count - 1) / size > fullest)
+            fullest = (double)(table->count - 1) / size;
+    }
+    CU_ASSERT_EQUAL(table->count, CUCKOO_TEST_KEYS);
+    CU_ASSERT(fullest > 0.9);
+    for (int i = 0; i < CUCKOO_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        CU_ASSERT_STRING_EQUAL(ht_find(table, key), value);
+    }
+    CU_ASSERT_PTR_NULL(ht_find(table, "missing"));
+}
+
+void test_insert_replaces_value(){
+    const int count = table->count;
+    // past the four ways of both buckets of the key
+    for (int i = 0; i < 20; i++)
+        ht_insert(table, "key-7", i % 2 ? "a much longer value than fits in the node" : "short");
+    CU_ASSERT_EQUAL(table->count, count);
+    CU_ASSERT_STRING_EQUAL(ht_find(table, "key-7"), "a much longer value than fits in the node");
+}
+
+void test_delete_and_reinsert(){
+    char key[32];
+    for (int i = 0; i < CUCKOO_TEST_KEYS; i += 2)
+    {
+        sprintf(key, "key-%d", i);
+        ht_delete(table, key);
+    }
+    CU_ASSERT_EQUAL(table->count, CUCKOO_TEST_KEYS / 2);
+    for (int i = 0; i < CUCKOO_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        if (i % 2 == 0){
+            CU_ASSERT_PTR_NULL(ht_find(table, key));
+        }else{
+            CU_ASSERT_PTR_NOT_NULL(ht_find(table, key));
+        }
+    }
+    // deletes free their way, so churn never grows the table or loses keys
+    const int size = table->size;
+    for (int round = 0; round < 5; round++)
+    {
+        for (int i = 0; i < CUCKOO_TEST_KEYS; i += 2)
+        {
+            sprintf(key, "key-%d", i);
+            ht_insert(table, key, "again");
+        }
+        for (int i = 0; i < CUCKOO_TEST_KEYS; i += 2)
+        {
+            sprintf(key, "key-%d", i);
+            ht_delete(table, key);
+        }
+    }
+    CU_ASSERT_EQUAL(table->size, size);
+    CU_ASSERT_EQUAL(table->count, CUCKOO_TEST_KEYS / 2);
+    TableStats stats;
+    ht_stats(table, &stats);
+    CU_ASSERT_EQUAL(stats.tombstones, 0);
+    for (int i = 1; i < CUCKOO_TEST_KEYS; i += 2)
+    {
+        char value[32];
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        if (i == 7)
+            continue;
+        CU_ASSERT_STRING_EQUAL(ht_find(table, key), value);
+    }
+}
+
+void test_lookups_read_two_buckets_at_most(){
+#ifdef HT_STATS
+    char key[32];
+    ht_stats_reset(table);
+    for (int i = 0; i < CUCKOO_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ht_find(table, key);
+    }
+    TableStats stats;
+    ht_stats(table, &stats);
+    uint64_t lookups = 0;
+    // histogram bucket 0 counts lookups of one bucket, 1 of two
+    for (int b = 0; b < 2; b++)
+        lookups += stats.hit_probes[b] + stats.miss_probes[b];
+    CU_ASSERT_EQUAL(lookups, CUCKOO_TEST_KEYS);
+    CU_ASSERT_EQUAL(stats.miss_probes[0], 0);
+#endif
+}
+
+struct scan_state{
+    Table* table;
+    char* seen;
+    int reported;
+    int extras;
+};
+
+static void scan_and_insert(const Item* item, void* ctx){
+    struct scan_state* state = ctx;
+    const char* key = ht_item_key(item);
+    if (strncmp(key, "scan-", 5) == 0)
+        state->seen[atoi(key + 5)] = 1;
+    // inserts from the callback displace entries at this load
+    if (++state->reported % 32 == 0)
+    {
+        char extra[32];
+        sprintf(extra, "extra-%d", state->extras++);
+        ht_insert(state->table, extra, "v");
+    }
+}
+
+void test_scan_across_displacements(){
+    TableConfig config = {.engine=HT_ENGINE_CUCKOO};
+    Table* cuckoo = ht_new_with_config(&config);
+    char key[32];
+    int keys = 0;
+    // fill to 90%, growth comes at 95%
+    do
+    {
+        sprintf(key, "scan-%d", keys++);
+        ht_insert(cuckoo, key, "v");
+    } while (cuckoo->count * 10 < cuckoo->size * 9 || cuckoo->size < 4096);
+    const int size = cuckoo->size;
+    struct scan_state state = {.table=cuckoo, .seen=calloc((size_t)keys, 1)};
+    const int budget = 64;
+    int calls = 0;
+    uint64_t cursor = 0;
+    do
+    {
+        cursor = ht_scan(cuckoo, cursor, scan_and_insert, &state, budget);
+        calls++;
+    } while (cursor != 0 && calls < 100 * size / budget);
+    CU_ASSERT_EQUAL(cursor, 0);
+    CU_ASSERT(state.extras > 0);
+    CU_ASSERT_EQUAL(cuckoo->size, size);
+    // a scan that started over would take many more calls
+    CU_ASSERT(calls <= 2 * size / budget);
+    int missed = 0;
+    for (int i = 0; i < keys; i++)
+        missed += !state.seen[i];
+    CU_ASSERT_EQUAL(missed, 0);
+    free(state.seen);
+    delete_Table(cuckoo);
+}
+
+int main(){
+    if(CU_initialize_registry()==CUE_NOMEMORY){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_pSuite cuckoo_suite = CU_add_suite("TestSuite::Cuckoo",initialize_cuckoo_suite,cleanup_cuckoo_suite);
+    if(cuckoo_suite==NULL){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if(
+        CU_add_test(cuckoo_suite,"Should insert and find across growth past 90% load",test_insert_and_find_with_growth)==NULL||
+        CU_add_test(cuckoo_suite,"Should keep one entry per key",test_insert_replaces_value)==NULL||
+        CU_add_test(cuckoo_suite,"Should delete without tombstones under churn",test_delete_and_reinsert)==NULL||
+        CU_add_test(cuckoo_suite,"Should compare two buckets at most per lookup",test_lookups_read_two_buckets_at_most)==NULL||
+        CU_add_test(cuckoo_suite,"Should scan every key while inserts displace entries",test_scan_across_displacements)==NULL
+    ){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../lib/hash-function.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+
+void test_hash_is_deterministic(void){
+    const char* key = "devon-hash-table";
+    CU_ASSERT_EQUAL(ht_hash_wy(key, strlen(key), 0), ht_hash_wy(key, strlen(key), 0));
+    CU_ASSERT_EQUAL(ht_hash_fnv1a(key, strlen(key), 0), ht_hash_fnv1a(key, strlen(key), 0));
+}
+
+void test_hash_depends_on_seed(void){
+    const char* key = "devon-hash-table";
+    CU_ASSERT_NOT_EQUAL(ht_hash_wy(key, strlen(key), 1), ht_hash_wy(key, strlen(key), 2));
+    CU_ASSERT_NOT_EQUAL(ht_hash_fnv1a(key, strlen(key), 1), ht_hash_fnv1a(key, strlen(key), 2));
+}
+
+void test_hash_covers_every_length(void){
+    // every length class (0, 1-3, 4-16, 17-48, >48) must see every byte
+    char buffer[128];
+    memset(buffer, 'a', sizeof(buffer));
+    for (size_t len = 1; len < sizeof(buffer); len++)
+    {
+        const uint64_t before = ht_hash_wy(buffer, len, 0);
+        for (size_t i = 0; i < len; i++)
+        {
+            buffer[i] = 'b';
+            CU_ASSERT_NOT_EQUAL(before, ht_hash_wy(buffer, len, 0));
+            buffer[i] = 'a';
+        }
+    }
+    CU_ASSERT_NOT_EQUAL(ht_hash_wy(buffer, 0, 0), ht_hash_wy(buffer, 1, 0));
+}
+
+int main(void)
+{
+    CU_pSuite suite = NULL;
+
+    if(CU_initialize_registry()!=CUE_SUCCESS)
+        return CU_get_error();
+
+    suite =  CU_add_suite("Testing key hash functions",NULL,NULL);
+    if(suite==NULL){
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    if(
+        CU_add_test(suite,"Test HashIsDeterministic()",test_hash_is_deterministic)==NULL||
+        CU_add_test(suite,"Test HashDependsOnSeed()",test_hash_depends_on_seed)==NULL||
+        CU_add_test(suite,"Test HashCoversEveryLength()",test_hash_covers_every_length)==NULL
+    ){
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_NORMAL);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return 0;
+}
@@ -1,7 +1,10 @@
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 #include "../lib/hash-table.h"
+#include "../lib/arena.h"
 
 struct Entry{
     char* key;
@@ -52,6 +55,986 @@ void test_find_key_in_table(){
     }
 }
 
+void test_seeded_table_with_resize(){
+    TableConfig config = {.hash=ht_hash_fnv1a, .seed=ht_random_seed()};
+    Table* seeded = ht_new_with_config(&config);
+    char key[32], value[32];
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        seeded = ht_insert(seeded, key, value);
+    }
+    CU_ASSERT_EQUAL(seeded->count, 1000);
+    CU_ASSERT_PTR_EQUAL(seeded->hash, ht_hash_fnv1a);
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        CU_ASSERT_STRING_EQUAL(ht_find(seeded, key), value);
+    }
+    ht_delete(seeded, "key-7");
+    CU_ASSERT_PTR_NULL(ht_find(seeded, "key-7"));
+    CU_ASSERT_EQUAL(seeded->count, 999);
+    delete_Table(seeded);
+}
+
+void test_resize_keeps_table_pointer(){
+    Table* resized = ht_new();
+    char key[32];
+    for (int i = 0; i < 2000; i++)
+    {
+        sprintf(key, "key-%d", i);
+        CU_ASSERT_PTR_EQUAL(ht_insert(resized, key, key), resized);
+    }
+    const int grown = resized->size;
+    const char* before = ht_find(resized, "key-42");
+    // shrinking from ht_delete must not leave the caller with a freed table
+    for (int i = 0; i < 2000; i++)
+    {
+        if (i == 42)
+            continue;
+        sprintf(key, "key-%d", i);
+        ht_delete(resized, key);
+    }
+    CU_ASSERT(resized->size < grown);
+    CU_ASSERT_EQUAL(resized->count, 1);
+    CU_ASSERT_PTR_EQUAL(ht_find(resized, "key-42"), before);
+    delete_Table(resized);
+}
+
+void test_power_of_two_policy(){
+    TableConfig config = {.capacity_policy=HT_CAPACITY_POW2};
+    Table* pow2 = ht_new_with_config(&config);
+    char key[32];
+    CU_ASSERT_EQUAL(pow2->size, 64);
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ht_insert(pow2, key, key);
+    }
+    CU_ASSERT_EQUAL(pow2->size & (pow2->size - 1), 0);
+    for (int i = 0; i < 1000; i += 3)
+    {
+        sprintf(key, "key-%d", i);
+        ht_delete(pow2, key);
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(key, "key-%d", i);
+        if (i % 3 == 0){
+            CU_ASSERT_PTR_NULL(ht_find(pow2, key));
+        }else{
+            CU_ASSERT_STRING_EQUAL(ht_find(pow2, key), key);
+        }
+    }
+    delete_Table(pow2);
+}
+
+void test_incremental_resize(){
+    TableConfig config = {.incremental_resize=true};
+    Table* incremental = ht_new_with_config(&config);
+    char key[32];
+    int saw_migration = 0;
+    for (int i = 0; i < 3000; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ht_insert(incremental, key, key);
+        if (incremental->old_items != NULL)
+        {
+            saw_migration = 1;
+            // keys inserted before the resize started must stay visible
+            CU_ASSERT_STRING_EQUAL(ht_find(incremental, "key-0"), "key-0");
+        }
+    }
+    CU_ASSERT(saw_migration);
+    for (int i = 0; i < 3000; i += 2)
+    {
+        sprintf(key, "key-%d", i);
+        ht_delete(incremental, key);
+    }
+    while (ht_rehash_step(incremental, 1));
+    CU_ASSERT_PTR_NULL(incremental->old_items);
+    CU_ASSERT_EQUAL(incremental->count, 1500);
+    for (int i = 0; i < 3000; i++)
+    {
+        sprintf(key, "key-%d", i);
+        if (i % 2 == 0){
+            CU_ASSERT_PTR_NULL(ht_find(incremental, key));
+        }else{
+            CU_ASSERT_STRING_EQUAL(ht_find(incremental, key), key);
+        }
+    }
+    delete_Table(incremental);
+}
+
+void test_batch_find_and_insert(){
+    TableConfig configs[2] = {{.capacity_policy=HT_CAPACITY_PRIME}, {.capacity_policy=HT_CAPACITY_POW2}};
+    for (int c = 0; c < 2; c++)
+    {
+        Table* batch = ht_new_with_config(&configs[c]);
+        static char names[1000][32];
+        const char* keys[1000];
+        char* values[1000];
+        for (int i = 0; i < 1000; i++)
+        {
+            sprintf(names[i], "batch-%d", i);
+            keys[i] = names[i];
+        }
+        // insert the even keys in one batch, look up all of them in another
+        const char* even[500];
+        for (int i = 0; i < 500; i++)
+            even[i] = keys[i * 2];
+        batch = ht_insert_batch(batch, even, even, 500);
+        CU_ASSERT_EQUAL(batch->count, 500);
+        ht_find_batch(batch, keys, 1000, values);
+        for (int i = 0; i < 1000; i++)
+        {
+            if (i % 2 == 0){
+                CU_ASSERT_STRING_EQUAL(values[i], keys[i]);
+            }else{
+                CU_ASSERT_PTR_NULL(values[i]);
+            }
+        }
+        delete_Table(batch);
+    }
+    // a cache evicts down to its budget, growing it for the whole batch
+    // would only be undone by the deletes of the evictions
+    TableConfig cache_config = {.eviction=HT_EVICT_CLOCK, .max_entries=100};
+    Table* single = ht_new_with_config(&cache_config);
+    Table* cache = ht_new_with_config(&cache_config);
+    static char cache_names[1000][32];
+    const char* cache_keys[1000];
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(cache_names[i], "cached-%d", i);
+        cache_keys[i] = cache_names[i];
+        single = ht_insert(single, cache_keys[i], cache_keys[i]);
+    }
+    cache = ht_insert_batch(cache, cache_keys, cache_keys, 1000);
+    CU_ASSERT(cache->count <= 100);
+    TableStats single_stats, cache_stats;
+    ht_stats(single, &single_stats);
+    ht_stats(cache, &cache_stats);
+    CU_ASSERT_EQUAL(cache_stats.resizes, single_stats.resizes);
+    delete_Table(single);
+    delete_Table(cache);
+}
+
+void test_binary_keys_and_values(){
+    TableConfig configs[4] = {{.engine=HT_ENGINE_DOUBLE_HASH}, {.engine=HT_ENGINE_SWISS}, {.engine=HT_ENGINE_ROBIN_HOOD}, {.engine=HT_ENGINE_CUCKOO}};
+    // keys that only differ after an embedded NUL or in their length
+    const char a[3] = {'k', '\0', 'a'};
+    const char b[3] = {'k', '\0', 'b'};
+    const char value[4] = {'v', '\0', 'x', 'y'};
+    for (int c = 0; c < 4; c++)
+    {
+        Table* binary = ht_new_with_config(&configs[c]);
+        binary = ht_insert_bytes(binary, a, sizeof(a), value, sizeof(value));
+        binary = ht_insert_bytes(binary, b, sizeof(b), "b", 1);
+        binary = ht_insert(binary, "k", "short");
+        size_t value_len = 0;
+        char* found = ht_find_bytes(binary, a, sizeof(a), &value_len);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(found);
+        CU_ASSERT_EQUAL(value_len, sizeof(value));
+        CU_ASSERT(memcmp(found, value, sizeof(value)) == 0);
+        CU_ASSERT_STRING_EQUAL(ht_find_bytes(binary, b, sizeof(b), NULL), "b");
+        CU_ASSERT_STRING_EQUAL(ht_find(binary, "k"), "short");
+        ht_delete_bytes(binary, a, sizeof(a));
+        CU_ASSERT_PTR_NULL(ht_find_bytes(binary, a, sizeof(a), NULL));
+        CU_ASSERT_STRING_EQUAL(ht_find_bytes(binary, b, sizeof(b), NULL), "b");
+        CU_ASSERT_EQUAL(binary->count, 2);
+        delete_Table(binary);
+    }
+}
+
+void test_borrowed_keys(){
+    TableConfig config = {.borrowed_keys=true};
+    Table* borrowed = ht_new_with_config(&config);
+    static char names[200][32];
+    for (int i = 0; i < 200; i++)
+    {
+        sprintf(names[i], "borrowed-%d", i);
+        borrowed = ht_insert_bytes(borrowed, names[i], strlen(names[i]), "value", 5);
+    }
+    char* found = NULL;
+    for (int i = 0; i < 200; i++)
+    {
+        char key[32];
+        sprintf(key, "borrowed-%d", i);
+        found = ht_find(borrowed, key);
+        CU_ASSERT_STRING_EQUAL(found, "value");
+    }
+    for (int i = 0; i < borrowed->size; i++)
+    {
+        Item* item = borrowed->items[i];
+        if (item != NULL && item->key_len > 0){
+            CU_ASSERT(item->key >= names[0] && item->key < names[200]);
+        }
+    }
+    for (int i = 0; i < 200; i += 2)
+        ht_delete_bytes(borrowed, names[i], strlen(names[i]));
+    CU_ASSERT_EQUAL(borrowed->count, 100);
+    delete_Table(borrowed);
+}
+
+void test_capacity_and_reserve(){
+    Table* sized = ht_new_with_capacity(10000);
+    const int size = sized->size;
+    CU_ASSERT(size >= 10000);
+    char key[32];
+    for (int i = 0; i < 10000; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sized = ht_insert(sized, key, key);
+    }
+    CU_ASSERT_EQUAL(sized->size, size);
+    // deletes do not shrink below the reservation
+    for (int i = 0; i < 9990; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ht_delete(sized, key);
+    }
+    CU_ASSERT_EQUAL(sized->size, size);
+    delete_Table(sized);
+
+    TableConfig configs[3] = {{.engine=HT_ENGINE_DOUBLE_HASH}, {.engine=HT_ENGINE_SWISS}, {.engine=HT_ENGINE_ROBIN_HOOD}};
+    for (int c = 0; c < 3; c++)
+    {
+        Table* reserved = ht_new_with_config(&configs[c]);
+        reserved = ht_insert(reserved, "before", "reserve");
+        reserved = ht_reserve(reserved, 5000);
+        const int reserved_size = reserved->size;
+        for (int i = 0; i < 5000 - 1; i++)
+        {
+            sprintf(key, "key-%d", i);
+            reserved = ht_insert(reserved, key, key);
+        }
+        CU_ASSERT_EQUAL(reserved->size, reserved_size);
+        CU_ASSERT_STRING_EQUAL(ht_find(reserved, "before"), "reserve");
+        CU_ASSERT_STRING_EQUAL(ht_find(reserved, "key-4000"), "key-4000");
+        delete_Table(reserved);
+    }
+}
+
+void test_inline_small_strings(){
+    Table* table = ht_new();
+    char key[64], value[64];
+    for (int i = 0; i < 2000; i++)
+    {
+        // every other entry is too long to fit in the node
+        sprintf(key, i % 2 ? "key-%d" : "a-key-too-long-to-inline-%d", i);
+        sprintf(value, "v%d", i);
+        table = ht_insert(table, key, value);
+    }
+    const char short_value[] = {'x', 0, 'y'};
+    table = ht_insert_bytes(table, "nul", 3, short_value, sizeof(short_value));
+    for (int i = 0; i < 2000; i++)
+    {
+        sprintf(key, i % 2 ? "key-%d" : "a-key-too-long-to-inline-%d", i);
+        sprintf(value, "v%d", i);
+        CU_ASSERT_STRING_EQUAL(ht_find(table, key), value);
+    }
+    int inline_items = 0;
+    for (int i = 0; i < table->size; i++)
+    {
+        Item* item = table->items[i];
+        if (item == NULL || item->key_len == 0)
+            continue;
+        CU_ASSERT_EQUAL(item->is_inline, item->key_len + item->value_len + 2 <= HT_ITEM_INLINE);
+        if (item->is_inline)
+        {
+            inline_items++;
+            // the value of an inline entry is read from the node itself
+            CU_ASSERT_PTR_EQUAL(ht_find_bytes(table, ht_item_key(item), item->key_len, NULL), item->inline_bytes + item->key_len + 1);
+        }
+    }
+    CU_ASSERT_EQUAL(inline_items, 1001);
+    size_t len = 0;
+    CU_ASSERT_EQUAL(memcmp(ht_find_bytes(table, "nul", 3, &len), short_value, sizeof(short_value)), 0);
+    CU_ASSERT_EQUAL(len, sizeof(short_value));
+    for (int i = 0; i < 2000; i += 3)
+    {
+        sprintf(key, i % 2 ? "key-%d" : "a-key-too-long-to-inline-%d", i);
+        ht_delete(table, key);
+        CU_ASSERT_PTR_NULL(ht_find(table, key));
+    }
+    CU_ASSERT_EQUAL(table->count, 2001 - 667);
+    delete_Table(table);
+}
+
+static void mark_scanned(const Item* item, void* ctx){
+    int id;
+    if (sscanf(ht_item_key(item), "scan-%d", &id) == 1)
+        ((int*)ctx)[id]++;
+}
+
+void test_scan_across_resizes(){
+    TableConfig configs[7] = {
+        {0}, {.capacity_policy=HT_CAPACITY_POW2}, {.incremental_resize=true},
+        {.capacity_policy=HT_CAPACITY_POW2, .incremental_resize=true},
+        {.engine=HT_ENGINE_SWISS}, {.engine=HT_ENGINE_ROBIN_HOOD}, {.engine=HT_ENGINE_CUCKOO},
+    };
+    static int seen[6000];
+    char key[32];
+    for (int c = 0; c < 7; c++)
+    {
+        Table* table = ht_new_with_config(&configs[c]);
+        // keys 0-1999 stay for the whole scan, 2000-2999 are deleted
+        // during it and 3000-5999 are inserted during it
+        for (int i = 0; i < 3000; i++)
+        {
+            sprintf(key, "scan-%d", i);
+            table = ht_insert(table, key, "v");
+        }
+        memset(seen, 0, sizeof(seen));
+        uint64_t cursor = 0;
+        int calls = 0, next = 3000, doomed = 2000;
+        bool shrunk = false;
+        do
+        {
+            cursor = ht_scan(table, cursor, mark_scanned, seen, 32);
+            calls++;
+            // grow for the first part of the scan, then shrink
+            for (int i = 0; i < 40 && next < 6000; i++, next++)
+            {
+                sprintf(key, "scan-%d", next);
+                table = ht_insert(table, key, "v");
+            }
+            for (int i = 0; i < 20 && next == 6000 && doomed < 3000; i++, doomed++)
+            {
+                sprintf(key, "scan-%d", doomed);
+                ht_delete(table, key);
+            }
+            if (doomed == 3000 && !shrunk)
+            {
+                for (int i = 3000; i < 6000; i++)
+                {
+                    sprintf(key, "scan-%d", i);
+                    ht_delete(table, key);
+                }
+                shrunk = true;
+            }
+        } while (cursor != 0 && calls < 100000);
+        CU_ASSERT_EQUAL(cursor, 0);
+        for (int i = 0; i < 2000; i++)
+            CU_ASSERT(seen[i] >= 1);
+        delete_Table(table);
+    }
+}
+
+/**
+ * @brief a full scan of an unchanged table reports each item once
+ * */
+void test_scan_unchanged_table_once(){
+    TableConfig configs[4] = {{.capacity_policy=HT_CAPACITY_POW2}, {.engine=HT_ENGINE_SWISS}, {.engine=HT_ENGINE_ROBIN_HOOD}, {.engine=HT_ENGINE_CUCKOO}};
+    static int seen[6000];
+    char key[32];
+    for (int c = 0; c < 4; c++)
+    {
+        Table* table = ht_new_with_config(&configs[c]);
+        for (int i = 0; i < 5000; i++)
+        {
+            sprintf(key, "scan-%d", i);
+            table = ht_insert(table, key, "v");
+        }
+        memset(seen, 0, sizeof(seen));
+        uint64_t cursor = 0;
+        do
+            cursor = ht_scan(table, cursor, mark_scanned, seen, 100);
+        while (cursor != 0);
+        for (int i = 0; i < 5000; i++)
+            CU_ASSERT_EQUAL(seen[i], 1);
+        delete_Table(table);
+    }
+}
+
+void test_stats(){
+    TableConfig configs[3] = {{.engine=HT_ENGINE_DOUBLE_HASH}, {.engine=HT_ENGINE_SWISS}, {.engine=HT_ENGINE_ROBIN_HOOD}};
+    char key[32];
+    for (int c = 0; c < 3; c++)
+    {
+        Table* table = ht_new_with_config(&configs[c]);
+        for (int i = 0; i < 1000; i++)
+        {
+            sprintf(key, "key-%04d", i);
+            table = ht_insert(table, key, "value");
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            sprintf(key, "key-%04d", i);
+            ht_delete(table, key);
+        }
+        TableStats stats;
+#ifdef HT_STATS
+        ht_stats(table, &stats);
+        CU_ASSERT(stats.resizes > 0);
+        CU_ASSERT(stats.resize_max_ms <= stats.resize_total_ms);
+#endif
+        ht_stats_reset(table);
+        for (int i = 0; i < 200; i++)
+        {
+            sprintf(key, "key-%04d", i);
+            ht_find(table, key);
+        }
+        ht_stats(table, &stats);
+        CU_ASSERT_EQUAL(stats.count, 900);
+        CU_ASSERT_EQUAL(stats.size, table->size);
+        CU_ASSERT_DOUBLE_EQUAL(stats.load_factor, 900.0 / table->size, 1e-9);
+        // short entries of the default engine live in their nodes
+        const size_t out_of_line = configs[c].engine == HT_ENGINE_DOUBLE_HASH ? 0 : 900;
+        CU_ASSERT_EQUAL(stats.key_bytes, out_of_line * 9);
+        CU_ASSERT_EQUAL(stats.value_bytes, out_of_line * 6);
+        CU_ASSERT(stats.slot_bytes >= (size_t)table->size * sizeof(Item*));
+        CU_ASSERT(stats.arena_bytes > 0);
+        // robin hood shifts back on delete, the others leave tombstones
+        if (configs[c].engine == HT_ENGINE_ROBIN_HOOD)
+        {
+            CU_ASSERT_EQUAL(stats.tombstones, 0);
+        }
+        else
+        {
+            CU_ASSERT(stats.tombstones > 0 && stats.tombstones <= 100);
+        }
+#ifdef HT_STATS
+        CU_ASSERT_TRUE(stats.counters_enabled);
+        uint64_t hits = 0, misses = 0;
+        for (int b = 0; b < HT_STATS_PROBE_BUCKETS; b++)
+        {
+            hits += stats.hit_probes[b];
+            misses += stats.miss_probes[b];
+        }
+        CU_ASSERT_EQUAL(hits, 100);
+        CU_ASSERT_EQUAL(misses, 100);
+        CU_ASSERT_EQUAL(stats.resizes, 0);
+#else
+        CU_ASSERT_FALSE(stats.counters_enabled);
+#endif
+        delete_Table(table);
+    }
+}
+
+static void count_evicted(const Item* item, void* ctx){
+    (void)item;
+    (*(int*)ctx)++;
+}
+
+void test_cache_entry_budget(void){
+    const int policies[2] = {HT_EVICT_CLOCK, HT_EVICT_SAMPLED_LRU};
+    char key[32];
+    for (int p = 0; p < 2; p++)
+    {
+        int evicted = 0;
+        TableConfig config = {.eviction=policies[p], .max_entries=100, .on_evict=count_evicted, .evict_ctx=&evicted};
+        Table* cache = ht_new_with_config(&config);
+        const int size = cache->size;
+        for (int i = 0; i < 20; i++)
+        {
+            sprintf(key, "hot-%d", i);
+            cache = ht_insert(cache, key, "hot");
+        }
+        // hot keys are hit between every insert of a stream of cold keys,
+        // and put back when they were evicted after all
+        int hot_misses = 0;
+        for (int i = 0; i < 100000; i++)
+        {
+            sprintf(key, "cold-%d", i);
+            cache = ht_insert(cache, key, "a value too long to live in the node");
+            sprintf(key, "hot-%d", i % 20);
+            if (ht_find(cache, key) == NULL)
+            {
+                hot_misses++;
+                cache = ht_insert(cache, key, "hot");
+            }
+        }
+        // both policies are approximate, but keep hot keys almost always
+        CU_ASSERT(hot_misses < 100000 / 50);
+        CU_ASSERT_EQUAL(cache->count, 100);
+        CU_ASSERT_EQUAL(cache->size, size);
+        TableStats stats;
+        ht_stats(cache, &stats);
+        CU_ASSERT_EQUAL(stats.evictions, (uint64_t)(100020 + hot_misses - 100));
+        CU_ASSERT_EQUAL(evicted, 100020 + hot_misses - 100);
+        // evictions never pile up tombstones in the fixed slot array
+        CU_ASSERT(stats.tombstones <= size / 4);
+        CU_ASSERT_STRING_EQUAL(ht_find(cache, "cold-99999"), "a value too long to live in the node");
+        ht_delete(cache, "cold-99999");
+        CU_ASSERT_PTR_NULL(ht_find(cache, "cold-99999"));
+        CU_ASSERT_EQUAL(cache->count, 99);
+        delete_Table(cache);
+    }
+}
+
+void test_cache_byte_budget(void){
+    const size_t budget = 64 * 1024;
+    TableConfig config = {.eviction=HT_EVICT_CLOCK, .max_bytes=budget};
+    Table* cache = ht_new_with_config(&config);
+    char key[32], value[200];
+    memset(value, 'v', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+    for (int i = 0; i < 5000; i++)
+    {
+        sprintf(key, "page-%d", i);
+        cache = ht_insert(cache, key, i % 2 ? "small" : value);
+        TableStats stats;
+        ht_stats(cache, &stats);
+        CU_ASSERT(stats.node_bytes + stats.key_bytes + stats.value_bytes <= budget);
+    }
+    CU_ASSERT(cache->count > 0);
+    // a cached key keeps one entry, a new value replaces the old one
+    const int count = cache->count;
+    cache = ht_insert(cache, "page-4999", "replaced");
+    CU_ASSERT_EQUAL(cache->count, count);
+    CU_ASSERT_STRING_EQUAL(ht_find(cache, "page-4999"), "replaced");
+    // an entry larger than the budget is not cached
+    char* huge = malloc(budget + 1);
+    memset(huge, 'h', budget);
+    huge[budget] = '\0';
+    cache = ht_insert(cache, "huge", huge);
+    CU_ASSERT_PTR_NULL(ht_find(cache, "huge"));
+    CU_ASSERT_EQUAL(cache->count, count);
+    free(huge);
+    delete_Table(cache);
+}
+
+void test_cache_config(void){
+    TableConfig swiss = {.engine=HT_ENGINE_SWISS, .eviction=HT_EVICT_CLOCK, .max_entries=10};
+    TableConfig unbounded = {.eviction=HT_EVICT_SAMPLED_LRU};
+    TableConfig unknown = {.eviction=7, .max_entries=10};
+    CU_ASSERT_PTR_NULL(ht_new_with_config(&swiss));
+    CU_ASSERT_PTR_NULL(ht_new_with_config(&unbounded));
+    CU_ASSERT_PTR_NULL(ht_new_with_config(&unknown));
+}
+
+static uint64_t fake_now = 1000;
+
+static uint64_t fake_clock(void){
+    return fake_now;
+}
+
+void test_ttl_lazy_expiry(void){
+    TableConfig config = {.clock=fake_clock};
+    Table* timed = ht_new_with_config(&config);
+    timed = ht_insert_with_ttl(timed, "session", "alice", 100);
+    timed = ht_insert(timed, "config", "kept");
+    fake_now += 99;
+    CU_ASSERT_STRING_EQUAL(ht_find(timed, "session"), "alice");
+    fake_now += 1;
+    // expired entries are absent before any sweep and go with the lookup
+    CU_ASSERT_PTR_NULL(ht_find(timed, "session"));
+    CU_ASSERT_STRING_EQUAL(ht_find(timed, "config"), "kept");
+    CU_ASSERT_EQUAL(timed->count, 1);
+    TableStats stats;
+    ht_stats(timed, &stats);
+    CU_ASSERT_EQUAL(stats.expiring, 0);
+    CU_ASSERT_EQUAL(stats.expired, 1);
+    // deleted and replaced timers leave the wheel with their entries
+    timed = ht_insert_with_ttl(timed, "gone", "x", 10);
+    ht_delete(timed, "gone");
+    fake_now += 20;
+    CU_ASSERT_EQUAL(ht_expire(timed, 1000), 0);
+    CU_ASSERT_EQUAL(timed->count, 1);
+    delete_Table(timed);
+
+    // other engines keep the entry without a timer instead of dropping it
+    const int engines[3] = {HT_ENGINE_SWISS, HT_ENGINE_ROBIN_HOOD, HT_ENGINE_CUCKOO};
+    for (int e = 0; e < 3; e++)
+    {
+        TableConfig engine = {.engine=engines[e], .clock=fake_clock};
+        Table* other = ht_new_with_config(&engine);
+        other = ht_insert_with_ttl(other, "session", "alice", 100);
+        fake_now += 200;
+        CU_ASSERT_STRING_EQUAL(ht_find(other, "session"), "alice");
+        CU_ASSERT_EQUAL(other->count, 1);
+        CU_ASSERT_PTR_NULL(other->expiry);
+        delete_Table(other);
+    }
+}
+
+void test_ttl_wheel_expires_on_time(void){
+    enum { KEYS = 20000 };
+    static uint64_t expires[KEYS];
+    TableConfig config = {.clock=fake_clock};
+    Table* timed = ht_new_with_config(&config);
+    char key[32];
+    for (int i = 0; i < KEYS; i++)
+    {
+        // spread over every level of the wheel, and past its top
+        uint64_t ttl = (uint64_t)(i * 7919) % 300000;
+        if (i % 100 == 0)
+            ttl = (uint64_t)i * 3000000;
+        if (i % 1000 == 1)
+            ttl = 100000000000ull + (uint64_t)i;
+        expires[i] = fake_now + ttl;
+        sprintf(key, "session-%d", i);
+        timed = ht_insert_with_ttl(timed, key, "data", ttl);
+    }
+    const uint64_t steps[] = {1, 63, 64, 1000, 4096, 50000, 262144, 300000, 16777216, 100000000, 1000000000, 70000000000ull, 40000000000ull};
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++)
+    {
+        fake_now += steps[s];
+        int left = 0;
+        for (int i = 0; i < KEYS; i++)
+            left += expires[i] > fake_now;
+        // slices stay within their budget and never reclaim early
+        for (int call = 0; call < 10000 && timed->count > left; call++)
+            CU_ASSERT(ht_expire(timed, 500) <= 500);
+        for (int call = 0; call < 100; call++)
+            ht_expire(timed, 500);
+        CU_ASSERT_EQUAL(timed->count, left);
+    }
+    CU_ASSERT_EQUAL(timed->count, 0);
+    TableStats stats;
+    ht_stats(timed, &stats);
+    CU_ASSERT_EQUAL(stats.expired, KEYS);
+    delete_Table(timed);
+}
+
+void test_parallel_rehash_matches_serial(void){
+    enum { KEYS = 120000 };
+    const int threads[] = {2, 3, 8, 64};
+    TableConfig serial_config = {.capacity_policy=HT_CAPACITY_POW2, .seed=7};
+    Table* serial = ht_new_with_config(&serial_config);
+    char key[32];
+    for (int i = 0; i < KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        serial = ht_insert(serial, key, key);
+    }
+    serial = ht_reserve(serial, KEYS * 3);
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+    {
+        TableConfig config = {.capacity_policy=HT_CAPACITY_POW2, .seed=7, .rehash_threads=threads[t]};
+        Table* parallel = ht_new_with_config(&config);
+        for (int i = 0; i < KEYS; i++)
+        {
+            sprintf(key, "key-%d", i);
+            parallel = ht_insert(parallel, key, key);
+        }
+        // growing past HT_REHASH_PARALLEL_MIN slots and reserving both rehash in parallel
+        parallel = ht_reserve(parallel, KEYS * 3);
+        CU_ASSERT_EQUAL(parallel->size, serial->size);
+        CU_ASSERT_EQUAL(parallel->count, KEYS);
+        int same = 0;
+        for (int idx = 0; idx < serial->size; idx++)
+        {
+            const Item* a = serial->items[idx];
+            const Item* b = parallel->items[idx];
+            same += (a == NULL && b == NULL) || (a != NULL && b != NULL && strcmp(ht_item_key(a), ht_item_key(b)) == 0);
+        }
+        CU_ASSERT_EQUAL(same, serial->size);
+        CU_ASSERT_STRING_EQUAL(ht_find(parallel, "key-4242"), "key-4242");
+        delete_Table(parallel);
+    }
+    delete_Table(serial);
+}
+
+void test_huge_page_slot_arrays(void){
+    // hugetlb falls back to transparent huge pages without a reserved pool
+    const TableConfig configs[] = {
+        {.pages=HT_PAGES_TRANSPARENT},
+        {.pages=HT_PAGES_HUGETLB, .capacity_policy=HT_CAPACITY_POW2},
+        {.pages=HT_PAGES_TRANSPARENT, .numa=HT_NUMA_INTERLEAVE, .incremental_resize=true},
+        {.numa=HT_NUMA_BIND, .numa_node=0},
+    };
+    char key[32];
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+    {
+        Table* table = ht_new_with_config(&configs[c]);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+        // grows from heap slot arrays to mapped ones and back down
+        for (int i = 0; i < 300000; i++)
+        {
+            sprintf(key, "key-%d", i);
+            table = ht_insert(table, key, key);
+        }
+        CU_ASSERT(table->size * sizeof(Item*) >= HT_HUGE_PAGE_SIZE);
+        CU_ASSERT_STRING_EQUAL(ht_find(table, "key-123456"), "key-123456");
+        for (int i = 0; i < 299990; i++)
+        {
+            sprintf(key, "key-%d", i);
+            ht_delete(table, key);
+        }
+        CU_ASSERT_STRING_EQUAL(ht_find(table, "key-299995"), "key-299995");
+        CU_ASSERT_EQUAL(table->count, 10);
+        delete_Table(table);
+    }
+    const TableConfig bad = {.pages=HT_PAGES_HUGETLB + 1};
+    CU_ASSERT_PTR_NULL(ht_new_with_config(&bad));
+}
+
+void test_lookup_filter(void){
+    const TableConfig configs[] = {
+        {.lookup_filter=true},
+        {.lookup_filter=true, .capacity_policy=HT_CAPACITY_POW2},
+        {.lookup_filter=true, .incremental_resize=true},
+        {.lookup_filter=true, .eviction=HT_EVICT_CLOCK, .max_entries=5000},
+    };
+    char key[32];
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+    {
+        const bool cache = configs[c].eviction != HT_EVICT_NONE;
+        Table* table = ht_new_with_config(&configs[c]);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+        for (int i = 0; i < 20000; i++)
+        {
+            sprintf(key, "key-%d", i);
+            table = ht_insert(table, key, key);
+        }
+        // deletes and reinserts take their counters out and put them back
+        for (int round = 0; round < 3; round++)
+        {
+            for (int i = 0; i < 20000; i += 2)
+            {
+                sprintf(key, "key-%d", i);
+                ht_delete(table, key);
+            }
+            for (int i = 0; i < 20000; i += 4)
+            {
+                sprintf(key, "key-%d", i);
+                table = ht_insert(table, key, key);
+            }
+        }
+        // no false negatives: every stored key is still found
+        int found = 0;
+        for (int i = 0; i < 20000; i++)
+        {
+            sprintf(key, "key-%d", i);
+            const char* value = ht_find(table, key);
+            found += value != NULL;
+            if (!cache)
+            {
+                if (i % 2 == 0 && i % 4 != 0){
+                    CU_ASSERT_PTR_NULL(value);
+                }else{
+                    CU_ASSERT_PTR_NOT_NULL(value);
+                }
+            }
+        }
+        CU_ASSERT_EQUAL(found, table->count);
+        const char* batch_keys[4] = {"key-1", "absent-1", "key-4", "absent-2"};
+        char* batch_values[4];
+        ht_find_batch(table, batch_keys, 4, batch_values);
+        CU_ASSERT_PTR_NULL(batch_values[1]);
+        CU_ASSERT_PTR_NULL(batch_values[3]);
+        // the cache evicted the first keys
+        if (!cache)
+        {
+            CU_ASSERT_STRING_EQUAL(batch_values[0], "key-1");
+            CU_ASSERT_STRING_EQUAL(batch_values[2], "key-4");
+        }
+
+        ht_stats_reset(table);
+        for (int i = 0; i < 20000; i++)
+        {
+            sprintf(key, "absent-%d", i);
+            CU_ASSERT_PTR_NULL(ht_find(table, key));
+        }
+        TableStats stats;
+        ht_stats(table, &stats);
+        CU_ASSERT(stats.filter_bytes >= (size_t)table->size * HT_FILTER_COUNTERS_PER_SLOT / 2);
+        CU_ASSERT(stats.filter_fp_rate > 0 && stats.filter_fp_rate < 0.05);
+#ifdef HT_STATS
+        CU_ASSERT_EQUAL(stats.filter_rejects + stats.filter_false_positives, 20000);
+        CU_ASSERT(stats.filter_false_positives < 20000 * 0.05);
+#endif
+        delete_Table(table);
+    }
+    const TableConfig swiss = {.lookup_filter=true, .engine=HT_ENGINE_SWISS};
+    CU_ASSERT_PTR_NULL(ht_new_with_config(&swiss));
+    Table* plain = ht_new();
+    TableStats stats;
+    ht_stats(plain, &stats);
+    CU_ASSERT_EQUAL(stats.filter_bytes, 0);
+    delete_Table(plain);
+}
+
+void test_upsert_and_get_or_insert(void){
+    const TableConfig configs[] = {
+        {0},
+        {.capacity_policy=HT_CAPACITY_POW2},
+        {.incremental_resize=true},
+        {.intern_values=true},
+        {.lookup_filter=true},
+        {.eviction=HT_EVICT_SAMPLED_LRU, .max_entries=100000},
+        {.engine=HT_ENGINE_SWISS},
+        {.engine=HT_ENGINE_ROBIN_HOOD},
+        {.engine=HT_ENGINE_CUCKOO},
+    };
+    char key[32], value[64];
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+    {
+        Table* table = ht_new_with_config(&configs[c]);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+        // values that stay inline, grow out of the node and shrink back
+        const char* formats[3] = {"v%d", "a value too long for the node %d", "w%d"};
+        for (int round = 0; round < 3; round++)
+        {
+            for (int i = 0; i < 5000; i++)
+            {
+                sprintf(key, "key-%d", i);
+                sprintf(value, formats[round], i);
+                table = ht_upsert(table, key, value);
+            }
+            CU_ASSERT_EQUAL(table->count, 5000);
+        }
+        for (int i = 0; i < 5000; i++)
+        {
+            sprintf(key, "key-%d", i);
+            sprintf(value, "w%d", i);
+            CU_ASSERT_STRING_EQUAL(ht_find(table, key), value);
+            // a stored key keeps its value
+            CU_ASSERT_STRING_EQUAL(ht_get_or_insert(table, key, "other"), value);
+        }
+        CU_ASSERT_STRING_EQUAL(ht_get_or_insert(table, "fresh", "new"), "new");
+        CU_ASSERT_STRING_EQUAL(ht_get_or_insert(table, "fresh", "newer"), "new");
+        CU_ASSERT_EQUAL(table->count, 5001);
+        ht_delete(table, "fresh");
+        CU_ASSERT_PTR_NULL(ht_find(table, "fresh"));
+        CU_ASSERT_EQUAL(table->count, 5000);
+        delete_Table(table);
+    }
+    // borrowed keys point at the key the vacant entry was looked up with
+    TableConfig borrowed = {.borrowed_keys=true};
+    Table* table = ht_new_with_config(&borrowed);
+    static const char* names[3] = {"alpha", "beta", "gamma"};
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < 3; i++)
+            table = ht_upsert(table, names[i], round ? "a longer value stored apart" : "v");
+    }
+    CU_ASSERT_EQUAL(table->count, 3);
+    CU_ASSERT_STRING_EQUAL(ht_find(table, "beta"), "a longer value stored apart");
+    delete_Table(table);
+}
+
+void test_entry_counters_in_place(void){
+    Table* table = ht_new();
+    char key[32];
+    // read-modify-write counters built in place in a zeroed value
+    for (int n = 0; n < 20; n++)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            sprintf(key, "counter-%d", i);
+            TableEntry entry = ht_entry(table, key);
+            char* count = entry.item != NULL ? ht_item_value(entry.item) : ht_entry_set(&entry, NULL, 4);
+            CU_ASSERT_PTR_NOT_NULL_FATAL(count);
+            CU_ASSERT_PTR_NOT_NULL(entry.item);
+            count[0]++;
+        }
+    }
+    CU_ASSERT_EQUAL(table->count, 1000);
+    CU_ASSERT_EQUAL(ht_find(table, "counter-7")[0], 20);
+
+    // a value of the same block size is written over the old bytes, a
+    // longer one moves the entry to a new block and frees the old one
+    const char* long_key = "a key too long to be stored in the node";
+    table = ht_insert(table, long_key, "0123456789");
+    const char* stored = ht_find(table, long_key);
+    const size_t in_use = table->arena->bytes_in_use;
+    table = ht_upsert(table, long_key, "987654321");
+    CU_ASSERT_PTR_EQUAL(ht_find(table, long_key), stored);
+    CU_ASSERT_EQUAL(table->arena->bytes_in_use, in_use);
+    table = ht_upsert(table, long_key, "a value that needs a larger block");
+    CU_ASSERT_STRING_EQUAL(ht_find(table, long_key), "a value that needs a larger block");
+    CU_ASSERT(table->arena->bytes_in_use > in_use);
+    table = ht_upsert(table, long_key, "0123456789");
+    CU_ASSERT_EQUAL(table->arena->bytes_in_use, in_use);
+    CU_ASSERT_EQUAL(table->count, 1001);
+
+    // swiss and robin hood slots belong to the table as well
+    const TableConfig engines[2] = {{.engine=HT_ENGINE_SWISS}, {.engine=HT_ENGINE_ROBIN_HOOD}};
+    for (int e = 0; e < 2; e++)
+    {
+        Table* slots = ht_new_with_config(&engines[e]);
+        for (int i = 0; i < 100; i++)
+        {
+            sprintf(key, "slot-%d", i);
+            slots = ht_insert(slots, key, key);
+        }
+        slots = ht_insert(slots, long_key, "0123456789");
+        const char* slot_value = ht_find(slots, long_key);
+        const size_t slot_bytes = slots->arena->bytes_in_use;
+        ht_stats_reset(slots);
+        slots = ht_upsert(slots, long_key, "987654321");
+        // the replace is one lookup, not a removal and a new insert
+        TableStats slot_stats;
+        ht_stats(slots, &slot_stats);
+        uint64_t lookups = 0;
+        for (int b = 0; b < HT_STATS_PROBE_BUCKETS; b++)
+            lookups += slot_stats.hit_probes[b] + slot_stats.miss_probes[b];
+        if (slot_stats.counters_enabled)
+            CU_ASSERT_EQUAL(lookups, 1);
+        CU_ASSERT_PTR_EQUAL(ht_find(slots, long_key), slot_value);
+        CU_ASSERT_EQUAL(slots->arena->bytes_in_use, slot_bytes);
+        CU_ASSERT_EQUAL(slots->count, 101);
+        delete_Table(slots);
+    }
+
+    // the entry of a key is found in one probe pass, hit or miss
+#ifdef HT_STATS
+    ht_stats_reset(table);
+    table = ht_upsert(table, "counter-3", "x");
+    table = ht_upsert(table, "absent", "y");
+    TableStats stats;
+    ht_stats(table, &stats);
+    uint64_t hits = 0, misses = 0;
+    for (int b = 0; b < HT_STATS_PROBE_BUCKETS; b++)
+    {
+        hits += stats.hit_probes[b];
+        misses += stats.miss_probes[b];
+    }
+    CU_ASSERT_EQUAL(hits, 1);
+    CU_ASSERT_EQUAL(misses, 1);
+#endif
+    delete_Table(table);
+
+    // a replaced value keeps the TTL of its entry
+    TableConfig config = {.clock=fake_clock};
+    Table* timed = ht_new_with_config(&config);
+    timed = ht_insert_with_ttl(timed, "session", "alice", 100);
+    timed = ht_upsert(timed, "session", "a value longer than the node holds");
+    CU_ASSERT_EQUAL(timed->count, 1);
+    fake_now += 100;
+    CU_ASSERT_PTR_NULL(ht_find(timed, "session"));
+    TableEntry entry = ht_entry(timed, "session");
+    CU_ASSERT_PTR_NULL(entry.item);
+    CU_ASSERT_STRING_EQUAL(ht_entry_set(&entry, "bob", 3), "bob");
+    fake_now += 1000;
+    CU_ASSERT_STRING_EQUAL(ht_find(timed, "session"), "bob");
+    delete_Table(timed);
+}
+
+void test_load_past_int_range(void){
+    Table* table = ht_new();
+    char key[32];
+    for (int i = 0; i < 200; i++)
+    {
+        sprintf(key, "key-%d", i);
+        table = ht_insert(table, key, "v");
+    }
+    // a reservation whose load in percent leaves int range, a wrapped
+    // load would keep the table at its current size
+    const int items = INT_MAX / 100 + 1000;
+    table = ht_reserve(table, items);
+    CU_ASSERT((int64_t)table->size * 70 >= (int64_t)items * 100);
+    for (int i = 0; i < 200; i++)
+    {
+        sprintf(key, "key-%d", i);
+        CU_ASSERT_PTR_NOT_NULL(ht_find(table, key));
+    }
+    // deletes do not shrink below the reservation
+    const int size = table->size;
+    for (int i = 0; i < 200; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ht_delete(table, key);
+    }
+    CU_ASSERT_EQUAL(table->size, size);
+    delete_Table(table);
+}
+
 int main(){
     // creating registry
     if(CU_initialize_registry()==CUE_NOMEMORY){
@@ -70,7 +1053,30 @@ int main(){
     if(
         CU_add_test(hash_table_suite,"Should be able to create an table",test_create_table)==NULL||
         CU_add_test(hash_table_suite,"Should be able to insert data into table",test_insert_into_table)==NULL||
-        CU_add_test(hash_table_suite,"Should be able to find data into table",test_find_key_in_table)==NULL
+        CU_add_test(hash_table_suite,"Should be able to find data into table",test_find_key_in_table)==NULL||
+        CU_add_test(hash_table_suite,"Should keep keys across resizes of a seeded table",test_seeded_table_with_resize)==NULL||
+        CU_add_test(hash_table_suite,"Should move items by pointer when resizing",test_resize_keeps_table_pointer)==NULL||
+        CU_add_test(hash_table_suite,"Should size and probe power-of-two tables",test_power_of_two_policy)==NULL||
+        CU_add_test(hash_table_suite,"Should resize incrementally",test_incremental_resize)==NULL||
+        CU_add_test(hash_table_suite,"Should find and insert keys in batches",test_batch_find_and_insert)==NULL||
+        CU_add_test(hash_table_suite,"Should store keys and values with embedded NULs",test_binary_keys_and_values)==NULL||
+        CU_add_test(hash_table_suite,"Should point at borrowed keys",test_borrowed_keys)==NULL||
+        CU_add_test(hash_table_suite,"Should size tables up front",test_capacity_and_reserve)==NULL||
+        CU_add_test(hash_table_suite,"Should keep short keys and values in the node",test_inline_small_strings)==NULL||
+        CU_add_test(hash_table_suite,"Should report table statistics",test_stats)==NULL||
+        CU_add_test(hash_table_suite,"Should scan every key across resizes",test_scan_across_resizes)==NULL||
+        CU_add_test(hash_table_suite,"Should scan an unchanged table once",test_scan_unchanged_table_once)==NULL||
+        CU_add_test(hash_table_suite,"Should evict to an entry budget",test_cache_entry_budget)==NULL||
+        CU_add_test(hash_table_suite,"Should evict to a byte budget",test_cache_byte_budget)==NULL||
+        CU_add_test(hash_table_suite,"Should reject unusable cache configs",test_cache_config)==NULL||
+        CU_add_test(hash_table_suite,"Should hide expired entries from lookups",test_ttl_lazy_expiry)==NULL||
+        CU_add_test(hash_table_suite,"Should reclaim expired entries on time",test_ttl_wheel_expires_on_time)==NULL||
+        CU_add_test(hash_table_suite,"Should rehash in parallel to the serial layout",test_parallel_rehash_matches_serial)==NULL||
+        CU_add_test(hash_table_suite,"Should map slot arrays on huge pages",test_huge_page_slot_arrays)==NULL||
+        CU_add_test(hash_table_suite,"Should reject absent keys with the lookup filter",test_lookup_filter)==NULL||
+        CU_add_test(hash_table_suite,"Should upsert and get or insert with one entry per key",test_upsert_and_get_or_insert)==NULL||
+        CU_add_test(hash_table_suite,"Should update entries in place",test_entry_counters_in_place)==NULL||
+        CU_add_test(hash_table_suite,"Should compute loads past int range",test_load_past_int_range)==NULL
     ){
         printf("ERROR: {%s} \n",CU_get_error_msg());
         CU_cleanup_registry();
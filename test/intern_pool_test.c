@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../lib/arena.h"
+#include "../lib/hash-table.h"
+#include "../lib/intern-pool.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+
+static Arena* arena = NULL;
+static InternPool* pool = NULL;
+
+int init_intern_suite(void){
+    arena = arena_new();
+    pool = intern_pool_new(arena, ht_hash_wy, 0);
+    return pool == NULL ? -1 : 0;
+}
+
+int cleanup_intern_suite(void){
+    intern_pool_destroy(pool);
+    arena_destroy(arena);
+    return 0;
+}
+
+void test_equal_strings_share_bytes(void){
+    char* first = intern_acquire(pool, "active", 6);
+    char* second = intern_acquire(pool, "active", 6);
+    CU_ASSERT_PTR_EQUAL(first, second);
+    CU_ASSERT_STRING_EQUAL(first, "active");
+    CU_ASSERT_EQUAL(intern_refs(first), 2);
+    CU_ASSERT_PTR_NOT_EQUAL(intern_acquire(pool, "activ", 5), first);
+    CU_ASSERT_EQUAL(pool->count, 2);
+    intern_release(pool, first);
+    intern_release(pool, second);
+    CU_ASSERT_EQUAL(pool->count, 1);
+    char* other = intern_acquire(pool, "activ", 5);
+    intern_release(pool, other);
+    intern_release(pool, other);
+    CU_ASSERT_EQUAL(pool->count, 0);
+}
+
+void test_release_keeps_clusters_reachable(void){
+    char name[32];
+    char* held[4000];
+    for (int i = 0; i < 4000; i++)
+    {
+        sprintf(name, "region-%d", i);
+        held[i] = intern_acquire(pool, name, strlen(name));
+    }
+    // every other entry goes, the rest must still be found by probing
+    for (int i = 0; i < 4000; i += 2)
+        intern_release(pool, held[i]);
+    for (int i = 1; i < 4000; i += 2)
+    {
+        sprintf(name, "region-%d", i);
+        char* again = intern_acquire(pool, name, strlen(name));
+        CU_ASSERT_PTR_EQUAL(again, held[i]);
+        intern_release(pool, again);
+        intern_release(pool, held[i]);
+    }
+    CU_ASSERT_EQUAL(pool->count, 0);
+}
+
+void test_table_interns_values(void){
+    TableConfig configs[2] = {{.intern_values=true}, {.engine=HT_ENGINE_SWISS, .intern_values=true}};
+    const char* status = "awaiting-payment-confirmation";
+    char key[32];
+    for (int c = 0; c < 2; c++)
+    {
+        Table* table = ht_new_with_config(&configs[c]);
+        for (int i = 0; i < 1000; i++)
+        {
+            sprintf(key, "order-%d", i);
+            table = ht_insert(table, key, i % 10 ? status : "shipped-to-the-customer-address");
+        }
+        CU_ASSERT_EQUAL(table->values->count, 2);
+        char* first = ht_find(table, "order-1");
+        CU_ASSERT_STRING_EQUAL(first, status);
+        CU_ASSERT_PTR_EQUAL(ht_find(table, "order-2"), first);
+        CU_ASSERT_EQUAL(intern_refs(first), 900);
+        // short values stay in the node of default engine items
+        table = ht_insert(table, "short", "ok");
+        CU_ASSERT_EQUAL(table->values->count, c == 0 ? 2 : 3);
+        for (int i = 0; i < 1000; i += 10)
+        {
+            sprintf(key, "order-%d", i);
+            ht_delete(table, key);
+        }
+        CU_ASSERT_EQUAL(table->values->count, c == 0 ? 1 : 2);
+        CU_ASSERT_EQUAL(intern_refs(first), 900);
+        TableStats stats;
+        ht_stats(table, &stats);
+        CU_ASSERT_EQUAL(stats.value_bytes, table->values->bytes);
+        delete_Table(table);
+    }
+}
+
+int main(void)
+{
+    CU_pSuite suite = NULL;
+
+    if(CU_initialize_registry()!=CUE_SUCCESS)
+        return CU_get_error();
+
+    suite =  CU_add_suite("Testing the intern pool",init_intern_suite,cleanup_intern_suite);
+    if(suite==NULL){
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    if(
+        CU_add_test(suite,"Test EqualStringsShareBytes()",test_equal_strings_share_bytes)==NULL||
+        CU_add_test(suite,"Test ReleaseKeepsClustersReachable()",test_release_keeps_clusters_reachable)==NULL||
+        CU_add_test(suite,"Test TableInternsValues()",test_table_interns_values)==NULL
+    ){
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_NORMAL);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../lib/lockfree-table.h"
+
+#define LF_TEST_READERS 4
+#define LF_TEST_STABLE_KEYS 500
+#define LF_TEST_WRITES 20000
+
+static LockFreeTable* table;
+static int writer_done;
+static int reader_errors;
+
+int initialize_lockfree_table_suite(void){
+    if((table=lf_new(NULL, 0))==NULL){
+        return 1;
+    }
+    return 0;
+}
+
+int cleanup_lockfree_table_suite(void){
+    if(table==NULL)
+        return 1;
+    delete_LockFreeTable(table);
+    return 0;
+}
+
+void test_insert_replace_delete(){
+    LfReader* reader = lf_register_reader(table);
+    CU_ASSERT_PTR_NOT_NULL(reader);
+    lf_insert(table, "status", "open");
+    lf_insert(table, "status", "closed");
+    lf_read_lock(table, reader);
+    CU_ASSERT_STRING_EQUAL(lf_find(table, "status"), "closed");
+    lf_read_unlock(reader);
+    CU_ASSERT_EQUAL(table->count, 1);
+    lf_delete(table, "status");
+    lf_read_lock(table, reader);
+    CU_ASSERT_PTR_NULL(lf_find(table, "status"));
+    lf_read_unlock(reader);
+    CU_ASSERT_EQUAL(table->count, 0);
+    lf_unregister_reader(reader);
+}
+
+static void* reader_thread(void* arg){
+    (void)arg;
+    LfReader* reader = lf_register_reader(table);
+    char key[32];
+    int errors = 0;
+    for (int round = 0; !__atomic_load_n(&writer_done, __ATOMIC_ACQUIRE) || round < 3; round++)
+    {
+        for (int i = 0; i < LF_TEST_STABLE_KEYS; i++)
+        {
+            sprintf(key, "stable-%d", i);
+            lf_read_lock(table, reader);
+            const char* value = lf_find(table, key);
+            if (value == NULL || strcmp(value, key) != 0)
+                errors++;
+            lf_read_unlock(reader);
+        }
+    }
+    lf_unregister_reader(reader);
+    __atomic_add_fetch(&reader_errors, errors, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+void test_readers_during_writes(){
+    char key[32];
+    for (int i = 0; i < LF_TEST_STABLE_KEYS; i++)
+    {
+        sprintf(key, "stable-%d", i);
+        lf_insert(table, key, key);
+    }
+    pthread_t readers[LF_TEST_READERS];
+    writer_done = 0;
+    for (int t = 0; t < LF_TEST_READERS; t++)
+        pthread_create(&readers[t], NULL, reader_thread, NULL);
+    // churn other keys so the writer resizes, replaces and retires nodes
+    for (int i = 0; i < LF_TEST_WRITES; i++)
+    {
+        sprintf(key, "churn-%d", i % 3000);
+        if (i % 3 == 2)
+            lf_delete(table, key);
+        else
+            lf_insert(table, key, "churn");
+    }
+    __atomic_store_n(&writer_done, 1, __ATOMIC_RELEASE);
+    for (int t = 0; t < LF_TEST_READERS; t++)
+        pthread_join(readers[t], NULL);
+    CU_ASSERT_EQUAL(reader_errors, 0);
+}
+
+int main(){
+    if(CU_initialize_registry()==CUE_NOMEMORY){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_pSuite lockfree_table_suite = CU_add_suite("TestSuite::LockFree_Table",initialize_lockfree_table_suite,cleanup_lockfree_table_suite);
+    if(lockfree_table_suite==NULL){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if(
+        CU_add_test(lockfree_table_suite,"Should insert, replace and delete",test_insert_replace_delete)==NULL||
+        CU_add_test(lockfree_table_suite,"Should serve readers while a writer churns",test_readers_during_writes)==NULL
+    ){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../lib/hash-table.h"
+
+#define ROBIN_HOOD_TEST_KEYS 5000
+
+static Table* table;
+
+int initialize_robin_hood_suite(void){
+    TableConfig config = {.engine=HT_ENGINE_ROBIN_HOOD};
+    if((table=ht_new_with_config(&config))==NULL){
+        return 1;
+    }
+    return 0;
+}
+
+int cleanup_robin_hood_suite(void){
+    if(table==NULL)
+        return 1;
+    delete_Table(table);
+    return 0;
+}
+
+void test_insert_and_find_with_growth(){
+    char key[32], value[32];
+    for (int i = 0; i < ROBIN_HOOD_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        ht_insert(table, key, value);
+    }
+    CU_ASSERT_EQUAL(table->count, ROBIN_HOOD_TEST_KEYS);
+    CU_ASSERT(table->size >= ROBIN_HOOD_TEST_KEYS);
+    for (int i = 0; i < ROBIN_HOOD_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        CU_ASSERT_STRING_EQUAL(ht_find(table, key), value);
+    }
+    CU_ASSERT_PTR_NULL(ht_find(table, "missing"));
+}
+
+void test_delete_and_reinsert(){
+    char key[32];
+    for (int i = 0; i < ROBIN_HOOD_TEST_KEYS; i += 2)
+    {
+        sprintf(key, "key-%d", i);
+        ht_delete(table, key);
+    }
+    CU_ASSERT_EQUAL(table->count, ROBIN_HOOD_TEST_KEYS / 2);
+    for (int i = 0; i < ROBIN_HOOD_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        if (i % 2 == 0){
+            CU_ASSERT_PTR_NULL(ht_find(table, key));
+        }else{
+            CU_ASSERT_PTR_NOT_NULL(ht_find(table, key));
+        }
+    }
+    // deletes shift the cluster back, so churn never grows the table or loses keys
+    const int size = table->size;
+    for (int round = 0; round < 20; round++)
+    {
+        for (int i = 0; i < ROBIN_HOOD_TEST_KEYS; i += 2)
+        {
+            sprintf(key, "key-%d", i);
+            ht_insert(table, key, "again");
+        }
+        for (int i = 0; i < ROBIN_HOOD_TEST_KEYS; i += 2)
+        {
+            sprintf(key, "key-%d", i);
+            ht_delete(table, key);
+        }
+    }
+    CU_ASSERT_EQUAL(table->size, size);
+    CU_ASSERT_EQUAL(table->count, ROBIN_HOOD_TEST_KEYS / 2);
+    for (int i = 1; i < ROBIN_HOOD_TEST_KEYS; i += 2)
+    {
+        char value[32];
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        CU_ASSERT_STRING_EQUAL(ht_find(table, key), value);
+    }
+}
+
+int main(){
+    if(CU_initialize_registry()==CUE_NOMEMORY){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_pSuite robin_hood_suite = CU_add_suite("TestSuite::Robin_Hood",initialize_robin_hood_suite,cleanup_robin_hood_suite);
+    if(robin_hood_suite==NULL){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if(
+        CU_add_test(robin_hood_suite,"Should insert and find across growth",test_insert_and_find_with_growth)==NULL||
+        CU_add_test(robin_hood_suite,"Should delete by backward shift under churn",test_delete_and_reinsert)==NULL
+    ){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}
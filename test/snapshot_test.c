@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../lib/hash-table.h"
+#include "../lib/snapshot.h"
+
+#define SNAPSHOT_TEST_KEYS 3000
+#define SNAPSHOT_TEST_PATH "snapshot_test.img"
+
+static Table* table;
+
+int initialize_snapshot_suite(void){
+    if((table=ht_new())==NULL){
+        return 1;
+    }
+    char key[32], value[32];
+    for (int i = 0; i < SNAPSHOT_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        ht_insert(table, key, value);
+    }
+    return 0;
+}
+
+int cleanup_snapshot_suite(void){
+    if(table==NULL)
+        return 1;
+    delete_Table(table);
+    remove(SNAPSHOT_TEST_PATH);
+    return 0;
+}
+
+void test_save_and_map_read_only(){
+    CU_ASSERT_EQUAL(ht_save(table, SNAPSHOT_TEST_PATH), 0);
+    Table* mapped = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_VERIFY);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mapped);
+    CU_ASSERT_EQUAL(mapped->count, SNAPSHOT_TEST_KEYS);
+    char key[32], value[32];
+    for (int i = 0; i < SNAPSHOT_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        CU_ASSERT_STRING_EQUAL(ht_find(mapped, key), value);
+    }
+    CU_ASSERT_PTR_NULL(ht_find(mapped, "missing"));
+    // a read-only mapping ignores writes
+    ht_insert(mapped, "new", "value");
+    ht_delete(mapped, "key-1");
+    CU_ASSERT_PTR_NULL(ht_find(mapped, "new"));
+    CU_ASSERT_STRING_EQUAL(ht_find(mapped, "key-1"), "value-1");
+    CU_ASSERT_EQUAL(mapped->count, SNAPSHOT_TEST_KEYS);
+    delete_Table(mapped);
+}
+
+void test_copy_on_write_leaves_file_unchanged(){
+    Table* mapped = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_COPY_ON_WRITE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mapped);
+    char key[32];
+    for (int i = 0; i < SNAPSHOT_TEST_KEYS; i += 2)
+    {
+        sprintf(key, "key-%d", i);
+        ht_delete(mapped, key);
+    }
+    // enough inserts to move the slot array out of the mapping
+    for (int i = SNAPSHOT_TEST_KEYS; i < SNAPSHOT_TEST_KEYS * 3; i++)
+    {
+        sprintf(key, "key-%d", i);
+        ht_insert(mapped, key, "cow");
+    }
+    CU_ASSERT_EQUAL(mapped->count, SNAPSHOT_TEST_KEYS / 2 + SNAPSHOT_TEST_KEYS * 2);
+    CU_ASSERT_PTR_NULL(ht_find(mapped, "key-0"));
+    CU_ASSERT_STRING_EQUAL(ht_find(mapped, "key-1"), "value-1");
+    CU_ASSERT_STRING_EQUAL(ht_find(mapped, "key-5000"), "cow");
+    ht_delete(mapped, "key-5000");
+    CU_ASSERT_PTR_NULL(ht_find(mapped, "key-5000"));
+    delete_Table(mapped);
+
+    Table* original = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_VERIFY);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(original);
+    CU_ASSERT_EQUAL(original->count, SNAPSHOT_TEST_KEYS);
+    CU_ASSERT_STRING_EQUAL(ht_find(original, "key-0"), "value-0");
+    CU_ASSERT_PTR_NULL(ht_find(original, "key-5000"));
+    delete_Table(original);
+}
+
+void test_upsert_mapped_images(){
+    CU_ASSERT_EQUAL(ht_save(table, SNAPSHOT_TEST_PATH), 0);
+    // a read-only mapping stores nothing and never writes to its pages
+    Table* mapped = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_READ_ONLY);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mapped);
+    ht_upsert(mapped, "key-1", "value-X");
+    ht_upsert(mapped, "key-2", "a value longer than the saved one");
+    CU_ASSERT_STRING_EQUAL(ht_find(mapped, "key-1"), "value-1");
+    CU_ASSERT_STRING_EQUAL(ht_find(mapped, "key-2"), "value-2");
+    CU_ASSERT_PTR_NULL(ht_get_or_insert(mapped, "new", "value"));
+    CU_ASSERT_PTR_NULL(ht_find(mapped, "new"));
+    CU_ASSERT_STRING_EQUAL(ht_get_or_insert(mapped, "key-3", "other"), "value-3");
+    TableEntry entry = ht_entry(mapped, "key-4");
+    CU_ASSERT_PTR_NULL(ht_entry_set(&entry, "x", 1));
+    CU_ASSERT_EQUAL(mapped->count, SNAPSHOT_TEST_KEYS);
+    delete_Table(mapped);
+
+    // a copy-on-write mapping stores the new values apart from the file
+    mapped = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_COPY_ON_WRITE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mapped);
+    ht_upsert(mapped, "key-1", "value-X");
+    ht_upsert(mapped, "key-2", "a value longer than the saved one");
+    CU_ASSERT_STRING_EQUAL(ht_find(mapped, "key-1"), "value-X");
+    CU_ASSERT_STRING_EQUAL(ht_find(mapped, "key-2"), "a value longer than the saved one");
+    CU_ASSERT_STRING_EQUAL(ht_get_or_insert(mapped, "new", "value"), "value");
+    CU_ASSERT_STRING_EQUAL(ht_get_or_insert(mapped, "new", "other"), "value");
+    CU_ASSERT_STRING_EQUAL(ht_get_or_insert(mapped, "key-3", "other"), "value-3");
+    ht_upsert(mapped, "new", "newer");
+    CU_ASSERT_STRING_EQUAL(ht_find(mapped, "new"), "newer");
+    CU_ASSERT_EQUAL(mapped->count, SNAPSHOT_TEST_KEYS + 1);
+    delete_Table(mapped);
+
+    Table* original = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_VERIFY);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(original);
+    CU_ASSERT_STRING_EQUAL(ht_find(original, "key-1"), "value-1");
+    CU_ASSERT_STRING_EQUAL(ht_find(original, "key-2"), "value-2");
+    CU_ASSERT_PTR_NULL(ht_find(original, "new"));
+    delete_Table(original);
+}
+
+void test_save_every_engine_with_binary_keys(){
+    TableConfig configs[3] = {{.engine=HT_ENGINE_SWISS, .hash=ht_hash_fnv1a, .seed=7}, {.engine=HT_ENGINE_ROBIN_HOOD}, {.incremental_resize=true}};
+    const char binary[3] = {'k', '\0', 'b'};
+    for (int c = 0; c < 3; c++)
+    {
+        Table* source = ht_new_with_config(&configs[c]);
+        char key[32];
+        for (int i = 0; i < 500; i++)
+        {
+            sprintf(key, "key-%d", i);
+            source = ht_insert(source, key, key);
+        }
+        source = ht_insert_bytes(source, binary, sizeof(binary), binary, sizeof(binary));
+        CU_ASSERT_EQUAL(ht_save(source, SNAPSHOT_TEST_PATH), 0);
+        Table* mapped = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_READ_ONLY);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(mapped);
+        CU_ASSERT_EQUAL(mapped->count, source->count);
+        CU_ASSERT_PTR_EQUAL(mapped->hash, source->hash);
+        for (int i = 0; i < 500; i++)
+        {
+            sprintf(key, "key-%d", i);
+            CU_ASSERT_STRING_EQUAL(ht_find(mapped, key), key);
+        }
+        size_t value_len = 0;
+        char* found = ht_find_bytes(mapped, binary, sizeof(binary), &value_len);
+        CU_ASSERT_PTR_NOT_NULL(found);
+        CU_ASSERT_EQUAL(value_len, sizeof(binary));
+        delete_Table(mapped);
+        delete_Table(source);
+    }
+}
+
+void test_reject_corrupt_images(){
+    CU_ASSERT_EQUAL(ht_save(table, SNAPSHOT_TEST_PATH), 0);
+    FILE* file = fopen(SNAPSHOT_TEST_PATH, "r+b");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    // flip one byte of the key/value data at the end of the image
+    fseek(file, -2, SEEK_END);
+    const int byte = fgetc(file);
+    fseek(file, -2, SEEK_END);
+    fputc(byte ^ 0xff, file);
+    fclose(file);
+    CU_ASSERT_PTR_NULL(ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_VERIFY));
+    Table* unchecked = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_READ_ONLY);
+    CU_ASSERT_PTR_NOT_NULL(unchecked);
+    if (unchecked != NULL)
+        delete_Table(unchecked);
+    CU_ASSERT_PTR_NULL(ht_open_mmap("missing.img", HT_MMAP_READ_ONLY));
+}
+
+static void count_item(const Item* item, void* ctx){
+    (void)item;
+    ++*(int*)ctx;
+}
+
+void test_unverified_slots_stay_in_the_image(){
+    CU_ASSERT_EQUAL(ht_save(table, SNAPSHOT_TEST_PATH), 0);
+    FILE* file = fopen(SNAPSHOT_TEST_PATH, "r+b");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    struct ht_snapshot_header header;
+    CU_ASSERT_EQUAL(fread(&header, sizeof(header), 1, file), 1);
+    const uint64_t hashes[2] = {ht_hash_wy("key-5", 5, header.seed), ht_hash_wy("key-6", 5, header.seed)};
+    // one slot points near the end of the image, one far past it
+    const uint64_t offsets[2] = {sizeof(header) + header.slots * sizeof(struct ht_snapshot_slot) + header.data_bytes - 4, 1ull << 40};
+    int corrupted = 0;
+    for (uint64_t i = 0; i < header.slots; i++)
+    {
+        struct ht_snapshot_slot slot;
+        const long at = (long)(sizeof(header) + i * sizeof(slot));
+        fseek(file, at, SEEK_SET);
+        if (fread(&slot, sizeof(slot), 1, file) != 1)
+            break;
+        for (int k = 0; k < 2; k++)
+        {
+            if (slot.offset != 0 && slot.hash == hashes[k])
+            {
+                slot.offset = offsets[k];
+                fseek(file, at, SEEK_SET);
+                fwrite(&slot, sizeof(slot), 1, file);
+                corrupted++;
+            }
+        }
+    }
+    fclose(file);
+    CU_ASSERT_EQUAL(corrupted, 2);
+    CU_ASSERT_PTR_NULL(ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_VERIFY));
+    Table* unchecked = ht_open_mmap(SNAPSHOT_TEST_PATH, HT_MMAP_READ_ONLY);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unchecked);
+    CU_ASSERT_PTR_NULL(ht_find(unchecked, "key-5"));
+    CU_ASSERT_PTR_NULL(ht_find(unchecked, "key-6"));
+    CU_ASSERT_STRING_EQUAL(ht_find(unchecked, "key-7"), "value-7");
+    int items = 0;
+    uint64_t cursor = 0;
+    do
+        cursor = ht_scan(unchecked, cursor, count_item, &items, 1024);
+    while (cursor != 0);
+    CU_ASSERT_EQUAL(items, SNAPSHOT_TEST_KEYS - 2);
+    delete_Table(unchecked);
+}
+
+int main(){
+    if(CU_initialize_registry()==CUE_NOMEMORY){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_pSuite snapshot_suite = CU_add_suite("TestSuite::Snapshot",initialize_snapshot_suite,cleanup_snapshot_suite);
+    if(snapshot_suite==NULL){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if(
+        CU_add_test(snapshot_suite,"Should save and map a table read-only",test_save_and_map_read_only)==NULL||
+        CU_add_test(snapshot_suite,"Should write a private copy of the mapping",test_copy_on_write_leaves_file_unchanged)==NULL||
+        CU_add_test(snapshot_suite,"Should upsert into mapped images",test_upsert_mapped_images)==NULL||
+        CU_add_test(snapshot_suite,"Should save tables of every engine",test_save_every_engine_with_binary_keys)==NULL||
+        CU_add_test(snapshot_suite,"Should reject corrupt images",test_reject_corrupt_images)==NULL||
+        CU_add_test(snapshot_suite,"Should keep unverified lookups inside the image",test_unverified_slots_stay_in_the_image)==NULL
+    ){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}
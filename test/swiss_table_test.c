@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../lib/hash-table.h"
+
+#define SWISS_TEST_KEYS 5000
+
+static Table* table;
+
+int initialize_swiss_table_suite(void){
+    TableConfig config = {.engine=HT_ENGINE_SWISS};
+    if((table=ht_new_with_config(&config))==NULL){
+        return 1;
+    }
+    return 0;
+}
+
+int cleanup_swiss_table_suite(void){
+    if(table==NULL)
+        return 1;
+    delete_Table(table);
+    return 0;
+}
+
+void test_insert_and_find_with_growth(){
+    char key[32], value[32];
+    for (int i = 0; i < SWISS_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        ht_insert(table, key, value);
+    }
+    CU_ASSERT_EQUAL(table->count, SWISS_TEST_KEYS);
+    CU_ASSERT(table->size >= SWISS_TEST_KEYS);
+    for (int i = 0; i < SWISS_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        sprintf(value, "value-%d", i);
+        CU_ASSERT_STRING_EQUAL(ht_find(table, key), value);
+    }
+    CU_ASSERT_PTR_NULL(ht_find(table, "missing"));
+}
+
+void test_delete_and_reinsert(){
+    char key[32];
+    for (int i = 0; i < SWISS_TEST_KEYS; i += 2)
+    {
+        sprintf(key, "key-%d", i);
+        ht_delete(table, key);
+    }
+    CU_ASSERT_EQUAL(table->count, SWISS_TEST_KEYS / 2);
+    for (int i = 0; i < SWISS_TEST_KEYS; i++)
+    {
+        sprintf(key, "key-%d", i);
+        if (i % 2 == 0){
+            CU_ASSERT_PTR_NULL(ht_find(table, key));
+        }else{
+            CU_ASSERT_PTR_NOT_NULL(ht_find(table, key));
+        }
+    }
+    // churn through the tombstones without growing past what the live keys need
+    const int size = table->size;
+    for (int round = 0; round < 20; round++)
+    {
+        for (int i = 0; i < SWISS_TEST_KEYS; i += 2)
+        {
+            sprintf(key, "key-%d", i);
+            ht_insert(table, key, "again");
+        }
+        for (int i = 0; i < SWISS_TEST_KEYS; i += 2)
+        {
+            sprintf(key, "key-%d", i);
+            ht_delete(table, key);
+        }
+    }
+    CU_ASSERT_EQUAL(table->size, size);
+    CU_ASSERT_STRING_EQUAL(ht_find(table, "key-1"), "value-1");
+}
+
+int main(){
+    if(CU_initialize_registry()==CUE_NOMEMORY){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_pSuite swiss_table_suite = CU_add_suite("TestSuite::Swiss_Table",initialize_swiss_table_suite,cleanup_swiss_table_suite);
+    if(swiss_table_suite==NULL){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if(
+        CU_add_test(swiss_table_suite,"Should insert and find across growth",test_insert_and_find_with_growth)==NULL||
+        CU_add_test(swiss_table_suite,"Should delete and reuse tombstones",test_delete_and_reinsert)==NULL
+    ){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}
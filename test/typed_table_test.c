@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../lib/typed-table.h"
+
+#define TYPED_TEST_KEYS 50000
+
+struct account
+{
+    uint64_t id;
+    int64_t balance;
+    uint32_t flags;
+};
+
+struct pair_key
+{
+    uint32_t shard;
+    uint32_t id;
+};
+
+HT_TYPED_TABLE(AccountTable, uint64_t, struct account, ht_typed_hash_u64, ht_typed_eq_scalar)
+HT_TYPED_TABLE(PairTable, struct pair_key, int, ht_typed_hash_bytes, ht_typed_eq_bytes)
+
+static void sum_balances(const uint64_t *key, struct account *value, void *ctx){
+    CU_ASSERT_EQUAL(*key, value->id);
+    *(int64_t *)ctx += value->balance;
+}
+
+void test_insert_find_and_grow(){
+    AccountTable* table = AccountTable_new(0);
+    for (uint64_t i = 0; i < TYPED_TEST_KEYS; i++)
+    {
+        struct account account = {.id=i, .balance=(int64_t)i * 10, .flags=1};
+        CU_ASSERT_TRUE(AccountTable_insert(table, i, account));
+    }
+    CU_ASSERT_EQUAL(table->count, TYPED_TEST_KEYS);
+    for (uint64_t i = 0; i < TYPED_TEST_KEYS; i++)
+    {
+        struct account* found = AccountTable_find(table, i);
+        CU_ASSERT_PTR_NOT_NULL(found);
+        if (found != NULL)
+            CU_ASSERT_EQUAL(found->balance, (int64_t)i * 10);
+    }
+    CU_ASSERT_PTR_NULL(AccountTable_find(table, TYPED_TEST_KEYS));
+    // an existing key keeps its slot and gets the new value
+    struct account updated = {.id=7, .balance=-1};
+    CU_ASSERT_FALSE(AccountTable_insert(table, 7, updated));
+    CU_ASSERT_EQUAL(table->count, TYPED_TEST_KEYS);
+    CU_ASSERT_EQUAL(AccountTable_find(table, 7)->balance, -1);
+    // values are stored in place and can be updated through find
+    AccountTable_find(table, 8)->balance += 5;
+    CU_ASSERT_EQUAL(AccountTable_find(table, 8)->balance, 85);
+
+    int64_t total = 0;
+    AccountTable_each(table, sum_balances, &total);
+    CU_ASSERT_EQUAL(total, (int64_t)TYPED_TEST_KEYS * (TYPED_TEST_KEYS - 1) * 5 - 70 - 1 + 5);
+    AccountTable_free(table);
+}
+
+void test_remove_and_churn(){
+    AccountTable* table = AccountTable_new(1000);
+    const size_t capacity = table->mask + 1;
+    for (uint64_t i = 0; i < 1000; i++)
+        AccountTable_insert(table, i, (struct account){.id=i});
+    CU_ASSERT_EQUAL(table->mask + 1, capacity);
+    struct account removed = {0};
+    CU_ASSERT_TRUE(AccountTable_remove(table, 10, &removed));
+    CU_ASSERT_EQUAL(removed.id, 10);
+    CU_ASSERT_FALSE(AccountTable_remove(table, 10, NULL));
+    CU_ASSERT_PTR_NULL(AccountTable_find(table, 10));
+    // tombstones are dropped in place, churn at a steady count never grows the table
+    for (uint64_t round = 1; round <= 50; round++)
+    {
+        for (uint64_t i = 0; i < 1000; i++)
+            AccountTable_remove(table, round * 1000 - 1000 + i, NULL);
+        for (uint64_t i = 0; i < 1000; i++)
+            AccountTable_insert(table, round * 1000 + i, (struct account){.id=round * 1000 + i});
+    }
+    CU_ASSERT_EQUAL(table->count, 1000);
+    CU_ASSERT_EQUAL(table->mask + 1, capacity);
+    for (uint64_t i = 0; i < 1000; i++)
+        CU_ASSERT_PTR_NOT_NULL(AccountTable_find(table, 50000 + i));
+    CU_ASSERT_PTR_NULL(AccountTable_find(table, 49999));
+    AccountTable_free(table);
+}
+
+void test_struct_keys_and_reserve(){
+    PairTable* table = PairTable_new(0);
+    PairTable_reserve(table, 4096);
+    const size_t capacity = table->mask + 1;
+    for (uint32_t shard = 0; shard < 4; shard++)
+        for (uint32_t id = 0; id < 1024; id++)
+            PairTable_insert(table, (struct pair_key){shard, id}, (int)(shard * 1024 + id));
+    CU_ASSERT_EQUAL(table->count, 4096);
+    CU_ASSERT_EQUAL(table->mask + 1, capacity);
+    CU_ASSERT_EQUAL(*PairTable_find(table, (struct pair_key){3, 5}), 3 * 1024 + 5);
+    CU_ASSERT_PTR_NULL(PairTable_find(table, (struct pair_key){4, 5}));
+    PairTable_free(table);
+}
+
+int main(){
+    if(CU_initialize_registry()==CUE_NOMEMORY){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_pSuite typed_table_suite = CU_add_suite("TestSuite::Typed_Table",NULL,NULL);
+    if(typed_table_suite==NULL){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if(
+        CU_add_test(typed_table_suite,"Should insert and find across growth",test_insert_find_and_grow)==NULL||
+        CU_add_test(typed_table_suite,"Should remove and reuse slots under churn",test_remove_and_churn)==NULL||
+        CU_add_test(typed_table_suite,"Should key by struct and reserve up front",test_struct_keys_and_reserve)==NULL
+    ){
+        printf("ERROR: {%s} \n",CU_get_error_msg());
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}